@@ -0,0 +1,54 @@
+#include "config.h"
+#include "devices.h"
+#include "logging.h"
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Stand-ins for the few driver functions the sources under test reference, so a benchmark only has to link
+// what it's measuring. Logging goes to stderr instead of the driver log.
+
+const char* state_files_directory = "/dev/shm";
+
+static void do_log(const char* prefix, const char* format, va_list args) {
+    fputs(prefix, stderr);
+    vfprintf(stderr, format, args);
+}
+
+void log_init() {}
+
+void log_message(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    do_log("", format, args);
+    va_end(args);
+}
+
+void log_error(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    do_log("[ERROR] ", format, args);
+    va_end(args);
+}
+
+void log_debug(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    do_log("[DEBUG] ", format, args);
+    va_end(args);
+}
+
+bool device_equal(device_properties_type* device, device_properties_type* device2) {
+    return device != NULL && device2 != NULL &&
+           device->hid_product_id == device2->hid_product_id &&
+           device->hid_vendor_id == device2->hid_vendor_id;
+}
+
+void free_config(driver_config_type *config) {
+    if (config == NULL) return;
+
+    free(config->output_mode);
+    free(config);
+}
@@ -0,0 +1,107 @@
+#include "epoch.h"
+#include "hazard_pointer.h"
+#include "runtime_context.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Cost of one device_checkout/device_checkin pair, the pattern the pose path runs several times per sample,
+// for 1 to MAX_THREADS threads doing it at once. The mutex-counted scheme the driver used before is measured
+// alongside it for comparison.
+
+#define ITERATIONS 2000000
+#define MAX_THREADS 8
+
+static pthread_mutex_t mutex_ref_count_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int mutex_ref_count = 0;
+static device_properties_type* mutex_device = NULL;
+
+static device_properties_type* mutex_device_checkout() {
+    device_properties_type* device = NULL;
+
+    pthread_mutex_lock(&mutex_ref_count_mutex);
+    if (mutex_device != NULL) {
+        mutex_ref_count++;
+        device = mutex_device;
+    }
+    pthread_mutex_unlock(&mutex_ref_count_mutex);
+
+    return device;
+}
+
+static void mutex_device_checkin(device_properties_type* device) {
+    pthread_mutex_lock(&mutex_ref_count_mutex);
+    if (mutex_ref_count > 0 && device_equal(device, mutex_device)) mutex_ref_count--;
+    pthread_mutex_unlock(&mutex_ref_count_mutex);
+}
+
+struct worker_t {
+    bool use_mutex;
+    pthread_barrier_t* start;
+    double ns_per_pair;
+};
+
+static void* worker_func(void* arg) {
+    struct worker_t* worker = (struct worker_t*)arg;
+    pthread_barrier_wait(worker->start);
+
+    uint64_t start_ns = get_monotonic_time_ns();
+    for (int i = 0; i < ITERATIONS; i++) {
+        if (worker->use_mutex) {
+            mutex_device_checkin(mutex_device_checkout());
+        } else {
+            device_checkin(device_checkout());
+        }
+    }
+    worker->ns_per_pair = (double)(get_monotonic_time_ns() - start_ns) / ITERATIONS;
+
+    return NULL;
+}
+
+static double run(bool use_mutex, int thread_count) {
+    pthread_t threads[MAX_THREADS];
+    struct worker_t workers[MAX_THREADS];
+    pthread_barrier_t start;
+    pthread_barrier_init(&start, NULL, thread_count);
+
+    for (int i = 0; i < thread_count; i++) {
+        workers[i] = (struct worker_t){ .use_mutex = use_mutex, .start = &start };
+        pthread_create(&threads[i], NULL, worker_func, &workers[i]);
+    }
+
+    double total = 0;
+    for (int i = 0; i < thread_count; i++) {
+        pthread_join(threads[i], NULL);
+        total += workers[i].ns_per_pair;
+    }
+    pthread_barrier_destroy(&start);
+
+    return total / thread_count;
+}
+
+int main() {
+    hazard_pointer_init();
+
+    device_properties_type* device = calloc(1, sizeof(device_properties_type));
+    device->hid_vendor_id = 0x3318;
+    device->hid_product_id = 0x0424;
+    set_device_and_checkout(device);
+
+    device_properties_type* legacy_device = calloc(1, sizeof(device_properties_type));
+    *legacy_device = *device;
+    mutex_device = legacy_device;
+    mutex_ref_count = 1;
+
+    printf("%-8s %16s %20s\n", "threads", "mutex (ns/pair)", "lock-free (ns/pair)");
+    for (int thread_count = 1; thread_count <= MAX_THREADS; thread_count *= 2) {
+        double mutex_ns = run(true, thread_count);
+        double lock_free_ns = run(false, thread_count);
+        printf("%-8d %16.1f %20.1f\n", thread_count, mutex_ns, lock_free_ns);
+    }
+
+    device_checkin(device);
+    free(legacy_device);
+
+    return 0;
+}
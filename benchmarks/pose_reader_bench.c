@@ -0,0 +1,186 @@
+#include "epoch.h"
+#include "state.h"
+
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+// the ring lives under this benchmark's own directory, not /dev/shm
+static char history_path[256];
+#define XR_POSE_READER_HISTORY_PATH history_path
+#include "xr_pose_reader.h"
+
+// ns per call of the reader SDK's functions while a writer thread publishes poses and a history ring at
+// 1000Hz, the rate of most glasses. Also checks that a reader opened while there's no history ring picks one
+// up once the driver starts keeping it.
+
+#define WRITER_INTERVAL_NS 1000000ULL
+#define HISTORY_CAPACITY 256
+
+// at 1000Hz, the interpolated lookups go about this many entries back into the ring
+#define LOOK_BACK_NS 50000000ULL
+#define LOOK_AHEAD_NS 16000000ULL
+
+#define CALLS 2000000
+
+// how many calls share one target time, so reading the clock doesn't dominate but the target keeps up with
+// the writer, as a caller's vsync time would
+#define CALLS_PER_TARGET 1024
+
+static _Atomic uint32_t writer_history_capacity = 0;
+static atomic_bool stop = false;
+
+// a steady 1 rad/s yaw
+static void* writer_thread_func(void* arg) {
+    (void)arg;
+
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (!atomic_load_explicit(&stop, memory_order_relaxed)) {
+        uint64_t now_ns = get_monotonic_time_ns();
+        float half_angle = (float)fmod((double)now_ns / NS_PER_SEC, 2.0 * M_PI) / 2.0f;
+        float predicted_half_angle = half_angle + (float)LOOK_AHEAD_NS / NS_PER_SEC / 2.0f;
+
+        pose_shm_sample_type sample = {
+            .timestamp_ns = now_ns,
+            .orientation = { 0.0f, 0.0f, sinf(half_angle), cosf(half_angle) },
+            .predicted_timestamp_ns = now_ns + LOOK_AHEAD_NS,
+            .predicted_orientation = { 0.0f, 0.0f, sinf(predicted_half_angle), cosf(predicted_half_angle) }
+        };
+        pose_shm_publish(&sample);
+
+        pose_history_entry_type entry = { .host_timestamp_ns = now_ns };
+        memcpy(entry.orientation, sample.orientation, sizeof(entry.orientation));
+        pose_history_publish(atomic_load(&writer_history_capacity), &entry);
+        pose_shm_notify();
+
+        next.tv_nsec += WRITER_INTERVAL_NS;
+        if (next.tv_nsec >= (long)NS_PER_SEC) {
+            next.tv_nsec -= NS_PER_SEC;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+
+    return NULL;
+}
+
+enum operation_t {
+    OPERATION_LATEST,
+    OPERATION_INTERPOLATE,
+    OPERATION_EXTRAPOLATE,
+
+    OPERATION_COUNT
+};
+
+static const char* operation_names[OPERATION_COUNT] = {
+    [OPERATION_LATEST] = "xr_pose_reader_latest",
+    [OPERATION_INTERPOLATE] = "xr_pose_reader_pose_at, 50ms back",
+    [OPERATION_EXTRAPOLATE] = "xr_pose_reader_pose_at, 16ms ahead"
+};
+
+// ns per call, and how many calls came back without a pose
+static double time_operation(xr_pose_reader_type* reader, enum operation_t operation, int* misses) {
+    *misses = 0;
+    uint64_t start_ns = get_monotonic_time_ns();
+    uint64_t timestamp_ns = 0;
+    for (int i = 0; i < CALLS; i++) {
+        if (i % CALLS_PER_TARGET == 0) {
+            uint64_t now_ns = get_monotonic_time_ns();
+            timestamp_ns = operation == OPERATION_INTERPOLATE ? now_ns - LOOK_BACK_NS : now_ns + LOOK_AHEAD_NS;
+        }
+
+        bool found;
+        if (operation == OPERATION_LATEST) {
+            pose_shm_sample_type sample;
+            found = xr_pose_reader_latest(reader, &sample);
+        } else {
+            xr_pose_type pose;
+            found = xr_pose_reader_pose_at(reader, timestamp_ns, &pose);
+        }
+        if (!found) (*misses)++;
+    }
+
+    return (double)(get_monotonic_time_ns() - start_ns) / CALLS;
+}
+
+static void print_timings(const char* title, xr_pose_reader_type* reader) {
+    printf("%s\n", title);
+    for (int operation = 0; operation < OPERATION_COUNT; operation++) {
+        int misses;
+        double ns = time_operation(reader, operation, &misses);
+        printf("  %-36s %8.1f ns/call  (%d without a pose)\n", operation_names[operation], ns, misses);
+    }
+}
+
+int main() {
+    // the writer's socket and history ring go under a directory of our own, so a running driver isn't disturbed
+    char base_dir[] = "/tmp/pose_reader_bench.XXXXXX";
+    char driver_dir[sizeof(base_dir) + 16];
+    char socket_path[sizeof(driver_dir) + 32];
+    if (!mkdtemp(base_dir)) {
+        fprintf(stderr, "could not create a runtime directory: %s\n", strerror(errno));
+        return 1;
+    }
+    snprintf(driver_dir, sizeof(driver_dir), "%s/xr_driver", base_dir);
+    mkdir(driver_dir, 0700);
+    setenv("XDG_RUNTIME_DIR", base_dir, 1);
+    snprintf(socket_path, sizeof(socket_path), "%s/%s", driver_dir, pose_shm_socket_filename);
+    state_files_directory = base_dir;
+    snprintf(history_path, sizeof(history_path), "%s/%s", base_dir, pose_history_filename);
+
+    pose_shm_init();
+
+    pthread_t writer;
+    pthread_create(&writer, NULL, writer_thread_func, NULL);
+
+    // opened before there's a ring, so the reader has to find it later
+    xr_pose_reader_type reader;
+    if (!xr_pose_reader_open_at(&reader, socket_path)) {
+        fprintf(stderr, "could not open the pose region at %s\n", socket_path);
+        return 1;
+    }
+
+    // let the writer publish a first pose
+    struct timespec settle = { .tv_nsec = 10 * WRITER_INTERVAL_NS };
+    nanosleep(&settle, NULL);
+    print_timings("without a history ring:", &reader);
+
+    uint64_t history_started_ns = get_monotonic_time_ns();
+    atomic_store(&writer_history_capacity, HISTORY_CAPACITY);
+
+    // pose_at retries opening the ring every XR_POSE_READER_HISTORY_RETRY_NS
+    uint64_t deadline_ns = history_started_ns + 3 * XR_POSE_READER_HISTORY_RETRY_NS;
+    xr_pose_type pose;
+    while (!reader.history && get_monotonic_time_ns() < deadline_ns) {
+        xr_pose_reader_pose_at(&reader, get_monotonic_time_ns(), &pose);
+        nanosleep(&settle, NULL);
+    }
+    if (!reader.history) {
+        fprintf(stderr, "the reader never picked up the history ring\n");
+        return 1;
+    }
+    printf("\nhistory ring picked up %.0f ms after the writer started it\n\n",
+           (double)(get_monotonic_time_ns() - history_started_ns) / NS_PER_MS);
+
+    // fill the ring past the look-back window
+    struct timespec fill = { .tv_nsec = (long)(2 * LOOK_BACK_NS) };
+    nanosleep(&fill, NULL);
+    print_timings("with a 256 pose history ring:", &reader);
+
+    atomic_store(&stop, true);
+    pthread_join(writer, NULL);
+    xr_pose_reader_close(&reader);
+    pose_history_publish(0, NULL);
+
+    unlink(socket_path);
+    rmdir(driver_dir);
+    rmdir(base_dir);
+    return 0;
+}
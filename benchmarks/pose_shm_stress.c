@@ -0,0 +1,219 @@
+#include "epoch.h"
+#include "pose_shm.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// One thread publishes poses as fast as it can while reader threads, each with its own mapping from
+// pose_shm.sock like any client, copy the latest sample in a tight loop and another blocks in pose_shm_wait.
+// Every field of a sample is derived from its timestamp, so a torn copy can't pass for a real one. Fails if a
+// reader ever gets a torn or out-of-order sample, or the waiter is never woken. Also prints what a publish
+// costs with no readers and under the readers' load; with fewer cores than threads the latter is mostly
+// time slicing.
+//
+//     pose_shm_stress [reader threads, default 4] [seconds, default 2]
+
+#define DEFAULT_READERS 4
+#define DEFAULT_SECONDS 2
+#define MAX_READERS 64
+
+// publishes timed together, get_monotonic_time_ns costs about as much as one publish
+#define PUBLISH_BATCH 1000
+
+#define WAIT_TIMEOUT_NS 100000000ULL
+
+static char socket_path[256];
+static atomic_bool stop = false;
+
+struct reader_result_t {
+    uint64_t reads;
+    uint64_t failed_reads;
+    uint64_t torn;
+    uint64_t out_of_order;
+};
+
+struct waiter_result_t {
+    uint64_t wakes;
+    uint64_t timeouts;
+};
+
+static void fill_sample(uint64_t k, pose_shm_sample_type* sample) {
+    sample->timestamp_ns = k;
+    sample->predicted_timestamp_ns = k + 1;
+    sample->flags = (uint32_t)k;
+    sample->reserved = ~(uint32_t)k;
+
+    // small enough integers to be exact as floats
+    for (int i = 0; i < 4; i++) {
+        sample->orientation[i] = (float)((k + i) & 0xFFFF);
+        sample->predicted_orientation[i] = (float)((k + i + 4) & 0xFFFF);
+    }
+    for (int i = 0; i < 3; i++) {
+        sample->position[i] = (float)((k + i + 8) & 0xFFFF);
+        sample->predicted_position[i] = (float)((k + i + 12) & 0xFFFF);
+    }
+}
+
+static bool sample_consistent(const pose_shm_sample_type* sample) {
+    pose_shm_sample_type expected;
+    fill_sample(sample->timestamp_ns, &expected);
+    return memcmp(sample, &expected, sizeof(expected)) == 0;
+}
+
+static void* reader_thread_func(void* arg) {
+    struct reader_result_t* result = (struct reader_result_t*)arg;
+
+    const pose_shm_region_type* region = pose_shm_open(socket_path, NULL);
+    if (!region) {
+        fprintf(stderr, "reader could not open %s\n", socket_path);
+        result->failed_reads = UINT64_MAX;
+        return NULL;
+    }
+
+    uint64_t last_timestamp_ns = 0;
+    while (!atomic_load_explicit(&stop, memory_order_relaxed)) {
+        pose_shm_sample_type sample;
+        if (!pose_shm_read(region, &sample)) {
+            result->failed_reads++;
+            continue;
+        }
+
+        result->reads++;
+        if (!sample_consistent(&sample)) result->torn++;
+        if (sample.timestamp_ns < last_timestamp_ns) result->out_of_order++;
+        last_timestamp_ns = sample.timestamp_ns;
+    }
+
+    munmap((void*)region, sizeof(pose_shm_region_type));
+    return NULL;
+}
+
+static void* waiter_thread_func(void* arg) {
+    struct waiter_result_t* result = (struct waiter_result_t*)arg;
+
+    pose_shm_notify_type* notify = NULL;
+    const pose_shm_region_type* region = pose_shm_open(socket_path, &notify);
+    if (!region) {
+        fprintf(stderr, "waiter could not open %s\n", socket_path);
+        return NULL;
+    }
+
+    uint32_t seen_count = pose_shm_notify_count(notify);
+    while (!atomic_load_explicit(&stop, memory_order_relaxed)) {
+        uint32_t count = pose_shm_wait(notify, seen_count, 1, WAIT_TIMEOUT_NS);
+        if (count == seen_count) result->timeouts++;
+        else result->wakes++;
+        seen_count = count;
+    }
+
+    munmap((void*)region, sizeof(pose_shm_region_type));
+    munmap(notify, sizeof(pose_shm_notify_type));
+    return NULL;
+}
+
+// publishes for duration_ns, returns the mean ns per publish (including the notify)
+static double publish_for(uint64_t* k, uint64_t duration_ns) {
+    uint64_t start_ns = get_monotonic_time_ns();
+    uint64_t end_ns = start_ns + duration_ns;
+    uint64_t publishes = 0;
+    uint64_t now_ns = start_ns;
+    while (now_ns < end_ns) {
+        for (int i = 0; i < PUBLISH_BATCH; i++) {
+            pose_shm_sample_type sample;
+            fill_sample(++*k, &sample);
+            pose_shm_publish(&sample);
+            pose_shm_notify();
+        }
+        publishes += PUBLISH_BATCH;
+        now_ns = get_monotonic_time_ns();
+    }
+
+    return (double)(now_ns - start_ns) / publishes;
+}
+
+int main(int argc, char** argv) {
+    int reader_count = argc > 1 ? atoi(argv[1]) : DEFAULT_READERS;
+    int seconds = argc > 2 ? atoi(argv[2]) : DEFAULT_SECONDS;
+    if (reader_count < 1 || reader_count > MAX_READERS || seconds < 1) {
+        fprintf(stderr, "usage: %s [reader threads, 1-%d] [seconds]\n", argv[0], MAX_READERS);
+        return 2;
+    }
+
+    // the region's socket goes under a runtime directory of our own, so a running driver isn't disturbed
+    char runtime_dir[] = "/tmp/pose_shm_stress.XXXXXX";
+    char driver_dir[sizeof(runtime_dir) + 16];
+    if (!mkdtemp(runtime_dir)) {
+        fprintf(stderr, "could not create a runtime directory: %s\n", strerror(errno));
+        return 2;
+    }
+    snprintf(driver_dir, sizeof(driver_dir), "%s/xr_driver", runtime_dir);
+    mkdir(driver_dir, 0700);
+    setenv("XDG_RUNTIME_DIR", runtime_dir, 1);
+    snprintf(socket_path, sizeof(socket_path), "%s/%s", driver_dir, pose_shm_socket_filename);
+
+    pose_shm_init();
+
+    uint64_t k = 0;
+    double idle_ns = publish_for(&k, NS_PER_SEC / 2);
+
+    struct reader_result_t reader_results[MAX_READERS] = {0};
+    struct waiter_result_t waiter_result = {0};
+    pthread_t readers[MAX_READERS];
+    pthread_t waiter;
+    for (int i = 0; i < reader_count; i++)
+        pthread_create(&readers[i], NULL, reader_thread_func, &reader_results[i]);
+    pthread_create(&waiter, NULL, waiter_thread_func, &waiter_result);
+
+    double loaded_ns = publish_for(&k, (uint64_t)seconds * NS_PER_SEC);
+
+    atomic_store(&stop, true);
+    for (int i = 0; i < reader_count; i++) pthread_join(readers[i], NULL);
+
+    // the waiter may be blocked, one more pose wakes it
+    pose_shm_sample_type sample;
+    fill_sample(++k, &sample);
+    pose_shm_publish(&sample);
+    pose_shm_notify();
+    pthread_join(waiter, NULL);
+
+    unlink(socket_path);
+    rmdir(driver_dir);
+    rmdir(runtime_dir);
+
+    struct reader_result_t total = {0};
+    bool reader_failed = false;
+    for (int i = 0; i < reader_count; i++) {
+        if (reader_results[i].failed_reads == UINT64_MAX) {
+            reader_failed = true;
+            continue;
+        }
+        total.reads += reader_results[i].reads;
+        total.failed_reads += reader_results[i].failed_reads;
+        total.torn += reader_results[i].torn;
+        total.out_of_order += reader_results[i].out_of_order;
+    }
+
+    printf("publish + notify:  %.1f ns with no readers, %.1f ns with %d readers and a waiter\n", idle_ns, loaded_ns,
+           reader_count);
+    printf("poses published:   %llu\n", (unsigned long long)k);
+    printf("reads:             %llu (%.1f M/s per reader)\n", (unsigned long long)total.reads,
+           (double)total.reads / reader_count / seconds / 1e6);
+    printf("gave up:           %llu\n", (unsigned long long)total.failed_reads);
+    printf("torn:              %llu\n", (unsigned long long)total.torn);
+    printf("out of order:      %llu\n", (unsigned long long)total.out_of_order);
+    printf("waiter:            %llu wakes, %llu timeouts\n", (unsigned long long)waiter_result.wakes,
+           (unsigned long long)waiter_result.timeouts);
+
+    bool passed = !reader_failed && total.reads > 0 && total.torn == 0 && total.out_of_order == 0 &&
+                  waiter_result.wakes > 0;
+    printf("%s\n", passed ? "PASSED" : "FAILED");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,173 @@
+#include "epoch.h"
+#include "imu.h"
+#include "quat_kernels.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// ns per quaternion for every kernel set this CPU supports, on batches of BATCH_SIZE and one at a time, and
+// the largest difference from the scalar functions in imu.h over the same inputs.
+
+#define BATCH_SIZE 1024
+#define BATCH_ROUNDS 2000
+#define SINGLE_CALLS 2000000
+
+static imu_quat_type quats_a[BATCH_SIZE];
+static imu_quat_type quats_b[BATCH_SIZE];
+static imu_quat_type drifted[BATCH_SIZE];
+static imu_vec3_type vectors[BATCH_SIZE];
+static float fractions[BATCH_SIZE];
+
+static imu_quat_type expected_quats[BATCH_SIZE];
+static imu_vec3_type expected_vectors[BATCH_SIZE];
+static imu_quat_type out_quats[BATCH_SIZE];
+static imu_vec3_type out_vectors[BATCH_SIZE];
+
+static uint64_t random_state = 0x9E3779B97F4A7C15ULL;
+
+// xorshift64*, uniform in [-1, 1)
+static float random_float() {
+    random_state ^= random_state >> 12;
+    random_state ^= random_state << 25;
+    random_state ^= random_state >> 27;
+    return (float)((random_state * 0x2545F4914F6CDD1DULL) >> 40) / (float)(1 << 23) - 1.0f;
+}
+
+static imu_quat_type random_quat() {
+    imu_quat_type q = { .x = random_float(), .y = random_float(), .z = random_float(), .w = random_float() };
+    return normalize_quaternion(q);
+}
+
+static void fill_inputs() {
+    for (int i = 0; i < BATCH_SIZE; i++) {
+        quats_a[i] = random_quat();
+        quats_b[i] = random_quat();
+        vectors[i] = (imu_vec3_type){ .x = random_float() * 10.0f, .y = random_float() * 10.0f,
+                                      .z = random_float() * 10.0f };
+        fractions[i] = random_float() * 0.75f + 0.5f;
+
+        // a quarter of these have drifted past the renormalizing tolerance
+        float scale = (i % 4 == 0) ? 1.001f : 1.0f + random_float() * 1e-6f;
+        drifted[i] = (imu_quat_type){ .x = quats_a[i].x * scale, .y = quats_a[i].y * scale,
+                                      .z = quats_a[i].z * scale, .w = quats_a[i].w * scale };
+    }
+}
+
+static float quat_error(const imu_quat_type* expected, const imu_quat_type* actual) {
+    float error = 0.0f;
+    for (int i = 0; i < BATCH_SIZE; i++) {
+        error = fmaxf(error, fabsf(expected[i].x - actual[i].x));
+        error = fmaxf(error, fabsf(expected[i].y - actual[i].y));
+        error = fmaxf(error, fabsf(expected[i].z - actual[i].z));
+        error = fmaxf(error, fabsf(expected[i].w - actual[i].w));
+    }
+    return error;
+}
+
+static float vector_error(const imu_vec3_type* expected, const imu_vec3_type* actual) {
+    float error = 0.0f;
+    for (int i = 0; i < BATCH_SIZE; i++) {
+        error = fmaxf(error, fabsf(expected[i].x - actual[i].x));
+        error = fmaxf(error, fabsf(expected[i].y - actual[i].y));
+        error = fmaxf(error, fabsf(expected[i].z - actual[i].z));
+    }
+    return error;
+}
+
+enum operation_t {
+    OPERATION_MULTIPLY,
+    OPERATION_RENORMALIZE_LAZY,
+    OPERATION_NLERP,
+    OPERATION_ROTATE,
+
+    OPERATION_COUNT
+};
+
+static const char* operation_names[OPERATION_COUNT] = {
+    [OPERATION_MULTIPLY] = "multiply",
+    [OPERATION_RENORMALIZE_LAZY] = "renormalize_lazy",
+    [OPERATION_NLERP] = "nlerp",
+    [OPERATION_ROTATE] = "rotate"
+};
+
+static void run(const quat_kernels_type* kernels, enum operation_t operation, int offset, int count) {
+    switch (operation) {
+        case OPERATION_MULTIPLY:
+            kernels->multiply(&quats_a[offset], &quats_b[offset], &out_quats[offset], count);
+            break;
+        case OPERATION_RENORMALIZE_LAZY:
+            // the drifted inputs are rewritten in place, so start from a fresh copy each time
+            for (int i = offset; i < offset + count; i++) out_quats[i] = drifted[i];
+            kernels->renormalize_lazy(&out_quats[offset], count);
+            break;
+        case OPERATION_NLERP:
+            kernels->nlerp(&quats_a[offset], &quats_b[offset], &fractions[offset], &out_quats[offset], count);
+            break;
+        case OPERATION_ROTATE:
+            kernels->rotate(&vectors[offset], &quats_a[offset], &out_vectors[offset], count);
+            break;
+        default:
+            break;
+    }
+}
+
+static float max_error(const quat_kernels_type* kernels, enum operation_t operation) {
+    for (int i = 0; i < BATCH_SIZE; i++) {
+        switch (operation) {
+            case OPERATION_MULTIPLY:
+                expected_quats[i] = multiply_quaternions_unnormalized(quats_a[i], quats_b[i]);
+                break;
+            case OPERATION_RENORMALIZE_LAZY:
+                expected_quats[i] = renormalize_quaternion_lazy(drifted[i]);
+                break;
+            case OPERATION_NLERP:
+                expected_quats[i] = quat_nlerp(quats_a[i], quats_b[i], fractions[i]);
+                break;
+            case OPERATION_ROTATE:
+                expected_vectors[i] = vector_rotate(vectors[i], quats_a[i]);
+                break;
+            default:
+                break;
+        }
+    }
+
+    run(kernels, operation, 0, BATCH_SIZE);
+    if (operation == OPERATION_ROTATE) return vector_error(expected_vectors, out_vectors);
+    return quat_error(expected_quats, out_quats);
+}
+
+static double batch_ns(const quat_kernels_type* kernels, enum operation_t operation) {
+    uint64_t start_ns = get_monotonic_time_ns();
+    for (int round = 0; round < BATCH_ROUNDS; round++) run(kernels, operation, 0, BATCH_SIZE);
+    return (double)(get_monotonic_time_ns() - start_ns) / ((double)BATCH_ROUNDS * BATCH_SIZE);
+}
+
+static double single_ns(const quat_kernels_type* kernels, enum operation_t operation) {
+    uint64_t start_ns = get_monotonic_time_ns();
+    for (int i = 0; i < SINGLE_CALLS; i++) run(kernels, operation, i % BATCH_SIZE, 1);
+    return (double)(get_monotonic_time_ns() - start_ns) / SINGLE_CALLS;
+}
+
+int main() {
+    fill_inputs();
+
+    quat_kernels_init();
+    printf("quat_kernels_init picked: %s\n\n", quat_kernels.name);
+
+    const quat_kernels_type* sets[4];
+    int set_count = quat_kernels_supported(sets, 4);
+
+    printf("%-8s %-18s %14s %14s %12s\n", "kernels", "operation", "batch ns/op", "single ns/op", "max error");
+    for (int i = 0; i < set_count; i++) {
+        for (int operation = 0; operation < OPERATION_COUNT; operation++) {
+            float error = max_error(sets[i], operation);
+            double batch = batch_ns(sets[i], operation);
+            double single = single_ns(sets[i], operation);
+            printf("%-8s %-18s %14.2f %14.2f %12.2e\n", sets[i]->name, operation_names[operation], batch, single,
+                   error);
+        }
+    }
+
+    return 0;
+}
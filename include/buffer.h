@@ -2,8 +2,7 @@
 
 #include <imu.h>
 #include <stdbool.h>
-
-#define GYRO_BUFFERS_COUNT 5 // quat values: x, y, z, w, timestamp
+#include <stdint.h>
 
 struct buffer_t {
     int size;
@@ -14,19 +13,27 @@ struct buffer_t {
 
 typedef struct buffer_t buffer_type;
 
-struct imu_buffer_t {
-    buffer_type **stage_1;
-    buffer_type **stage_2;
-};
+// quat values: x, y, z, w
+#define IMU_BUFFER_QUAT_COLUMNS 4
 
-typedef struct imu_buffer_t imu_buffer_type;
+// current quat, the quats from 1x and 2x the buffer size ago, then the 3 matching timestamps
+#define IMU_BUFFER_PAYLOAD_SIZE 16
 
-struct imu_buffer_response_t {
-    bool ready;
-    float *data;
+// History ring of orientation samples, stored column-wise in the same allocation as the header, so pushing
+// a sample never allocates: one run of nanosecond timestamps, followed by one run of floats per quat
+// component.
+struct imu_buffer_t {
+    // distance, in samples, between each stage of the payload
+    int size;
+
+    // 2 * size + 1: enough history to look back 2 stages from the newest sample
+    int capacity;
+    int index;
+    int count;
+    uint64_t timestamps_ns[];
 };
 
-typedef struct imu_buffer_response_t imu_buffer_response_type;
+typedef struct imu_buffer_t imu_buffer_type;
 
 buffer_type *create_buffer(int size);
 void free_buffer(buffer_type *buffer);
@@ -37,7 +44,11 @@ bool is_full(buffer_type *buffer);
 float push(buffer_type *buffer, float next_value);
 
 imu_buffer_type *create_imu_buffer(int buffer_size);
-void free_imu_buffer(imu_buffer_type *gyro_buffer);
-int imu_buffer_size(imu_buffer_type *gyro_buffer);
-
-imu_buffer_response_type *push_to_imu_buffer(imu_buffer_type *gyro_buffer, imu_quat_type quat, float timestamp_ms);
\ No newline at end of file
+void free_imu_buffer(imu_buffer_type *imu_buffer);
+int imu_buffer_size(imu_buffer_type *imu_buffer);
+
+// Push a new sample. Once enough history has been collected, writes the payload into out_data and returns
+// true, otherwise out_data is left untouched. Payload timestamps are in milliseconds relative to the newest
+// sample (so 0, then two negative values), which keeps them small enough to be exact as floats.
+bool push_to_imu_buffer(imu_buffer_type *imu_buffer, imu_quat_type quat, uint64_t timestamp_ns,
+                        float out_data[IMU_BUFFER_PAYLOAD_SIZE]);
@@ -20,6 +20,9 @@ struct driver_config_t {
     bool metrics_disabled;
     float dead_zone_threshold_deg;
 
+    // number of poses kept in the shared memory pose history ring, 0 disables it
+    int pose_history_size;
+
     bool debug_threads;
     bool debug_joystick;
     bool debug_multi_tap;
@@ -27,6 +30,9 @@ struct driver_config_t {
     bool debug_license;
     bool debug_device;
     bool debug_connections;
+
+    // records the pose pipeline latency histograms, see pose_stats.h
+    bool debug_latency;
 };
 
 typedef struct driver_config_t driver_config_type;
@@ -36,7 +42,7 @@ extern const char *mouse_output_mode;
 extern const char *external_only_output_mode;
 
 driver_config_type *default_config();
-void update_config(driver_config_type *config, driver_config_type *new_config);
+void free_config(driver_config_type *config);
 driver_config_type* parse_config_file(FILE *fp);
 
 void boolean_config(char* key, char *value, bool *config_value);
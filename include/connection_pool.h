@@ -2,6 +2,8 @@
 
 #include "devices.h"
 #include "imu.h"
+#include "pose_ring.h"
+
 #include <pthread.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -13,6 +15,9 @@ typedef struct connection_t {
     bool active;
     pthread_t thread;
     bool thread_running;
+
+    // filled by the device driver's callback thread, drained by the pose pipeline thread
+    pose_ring_type* pose_ring;
 } connection_t;
 
 struct connection_pool_t {
@@ -27,7 +32,8 @@ struct connection_pool_t {
 // Connection pool type that manages multiple device connections.
 typedef struct connection_pool_t connection_pool_type;
 
-// Create/destroy a connection pool instance
+// Create/destroy a connection pool instance. Poses are handed off to a dedicated pose pipeline thread,
+// which is the only thread that invokes the pose handler and reference pose getter.
 typedef void (*pose_handler_t)(imu_pose_type pose);
 typedef bool (*reference_pose_getter_t)(imu_pose_type* out_pose, bool* pose_updated);
 void connection_pool_init(pose_handler_t pose_handler_callback, reference_pose_getter_t reference_pose_getter);
@@ -38,6 +44,7 @@ void connection_pool_init(pose_handler_t pose_handler_callback, reference_pose_g
 void connection_pool_handle_device_added(const device_driver_type* driver, device_properties_type* device);
 
 // Delegate helpers the main driver uses (these generally forward to the primary connection)
+// is_connected is called for every pose, so it reads the pool's published snapshot rather than locking
 bool connection_pool_is_connected();
 bool connection_pool_device_is_sbs_mode();
 bool connection_pool_device_set_sbs_mode(bool enabled);
@@ -67,6 +74,8 @@ void connection_pool_handle_device_removed(const char* driver_id);
 connection_t* connection_pool_find_hid_connection(uint16_t id_vendor, int16_t id_product);
 connection_t* connection_pool_find_driver_connection(const char* driver_id);
 
+// Called from device driver callbacks. Never blocks: the pose is queued on the connection's ring and
+// processed asynchronously by the pose pipeline thread.
 void connection_pool_ingest_pose(const char* driver_id, imu_pose_type pose);
 
 // Returns true if the given driver id is currently the primary connection
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdint.h>
+
+// SOCK_SEQPACKET socket, under the runtime directory, for the same requests as the control flags file, without
+// the round trip through the file system. A client sends control_request_type messages and gets one
+// control_response_type back per request, in order, once the request has taken effect. The control flags
+// file keeps working as before.
+extern const char* control_socket_filename;
+
+#define CONTROL_SOCKET_PROTOCOL_VERSION 1
+#define CONTROL_SOCKET_MAX_CLIENTS 16
+
+// how long a request that takes effect on the pose path is given before it's answered with
+// CONTROL_STATUS_ACCEPTED instead, e.g. no device is connected or it hasn't finished calibrating
+#define CONTROL_SOCKET_ACK_TIMEOUT_MS 500
+
+enum control_command_t {
+    // answered once the next pose has been taken as the new center
+    CONTROL_COMMAND_RECENTER_SCREEN = 1,
+
+    // answered once calibration has been restarted
+    CONTROL_COMMAND_RECALIBRATE,
+
+    // value is one of control_sbs_mode_t, answered once the device has been asked to switch
+    CONTROL_COMMAND_SBS_MODE,
+    CONTROL_COMMAND_FORCE_QUIT
+};
+
+typedef enum control_command_t control_command_type;
+
+enum control_sbs_mode_t {
+    CONTROL_SBS_MODE_DISABLE = 0,
+    CONTROL_SBS_MODE_ENABLE
+};
+
+enum control_status_t {
+    CONTROL_STATUS_OK = 0,
+
+    // queued, but didn't take effect within CONTROL_SOCKET_ACK_TIMEOUT_MS; it will when poses start coming in
+    CONTROL_STATUS_ACCEPTED,
+    CONTROL_STATUS_UNSUPPORTED_VERSION,
+    CONTROL_STATUS_INVALID_REQUEST,
+
+    // e.g. SBS mode requested with no device connected, or one that doesn't support it
+    CONTROL_STATUS_FAILED
+};
+
+typedef enum control_status_t control_status_type;
+
+struct control_request_t {
+    uint32_t version;
+    uint32_t command;
+    uint32_t value;
+
+    // echoed back in the response
+    uint32_t request_id;
+};
+
+typedef struct control_request_t control_request_type;
+
+struct control_response_t {
+    uint32_t version;
+    uint32_t request_id;
+    uint32_t status;
+    uint32_t reserved;
+
+    // CLOCK_MONOTONIC time the request took effect, for RECENTER_SCREEN the timestamp of the pose it used
+    uint64_t applied_timestamp_ns;
+};
+
+typedef struct control_response_t control_response_type;
+
+// Applies a command and returns CONTROL_STATUS_OK, or CONTROL_STATUS_ACCEPTED if it's been handed to another
+// thread that will call control_socket_acknowledge once it's taken effect. Only called from the control socket
+// thread.
+typedef control_status_type (*control_command_handler)(control_command_type command, uint32_t value);
+
+// creates the socket and starts the thread that serves it
+void control_socket_init(control_command_handler handler);
+
+// Answers any requests for command that are waiting on it. Costs one atomic load when there are none, so it's
+// fine to call from the pose path.
+void control_socket_acknowledge(control_command_type command, uint64_t applied_timestamp_ns);
@@ -1,6 +1,7 @@
 #pragma once
 
 
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -47,6 +48,10 @@ struct device_properties_t {
 
     int imu_cycles_per_s;
 
+    // refresh rate of the current display mode, 0 if the driver doesn't know it. Unlike the rest of the struct
+    // this may change after the device is published, so it's only accessed atomically (relaxed is enough).
+    _Atomic int display_refresh_hz;
+
     // how many events to buffer for velocity smoothing
     int imu_buffer_size;
 
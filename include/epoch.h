@@ -2,4 +2,14 @@
 
 #include <stdint.h>
 
-uint64_t get_epoch_time_ms();
\ No newline at end of file
+#define NS_PER_MS 1000000ULL
+#define NS_PER_SEC 1000000000ULL
+
+uint64_t get_epoch_time_ms();
+
+// CLOCK_MONOTONIC in nanoseconds, the timeline every pose is stamped on. Served from the vDSO, so it's cheap
+// enough for device callbacks to read once per sample; everything downstream reuses the pose's timestamp.
+uint64_t get_monotonic_time_ns();
+
+// converts a monotonic timestamp to epoch milliseconds, re-reading the wall clock at most once per second
+uint64_t monotonic_to_epoch_ms(uint64_t monotonic_ns);
@@ -29,3 +29,6 @@ FILE* get_or_create_runtime_file(const char *filename, const char *mode, char **
 
 FILE* get_or_create_config_file(const char *filename, const char *mode, char **full_path, bool *created);
 
+// Creates a listening Unix socket of the given type (SOCK_STREAM, SOCK_SEQPACKET) at the runtime file path,
+// replacing anything left there by a previous run. Returns the socket, or -1 with errno set.
+int listen_on_runtime_socket(const char *filename, int type, int backlog, char **full_path);
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdatomic.h>
+
+// Hazard pointers let hot-path readers use a shared, immutable object without taking a lock, while the
+// (rare) writer that replaces the object waits until no reader still has the old one protected before
+// freeing it.
+//
+// Each thread gets one slot per kind of object, so protections of different kinds can be nested. A slot
+// should only be held for the short time it takes to use the protected object, unless objects of that kind are
+// only ever retired with hazard_pointer_retire, which doesn't wait on readers.
+enum hazard_pointer_slot_t {
+    HAZARD_SLOT_CONNECTION_POOL = 0,
+    HAZARD_SLOT_CONFIG,
+    HAZARD_SLOT_HOT_STATE,
+    HAZARD_SLOT_PLUGIN_CONFIGS,
+
+    HAZARD_SLOTS_PER_THREAD
+};
+
+typedef enum hazard_pointer_slot_t hazard_pointer_slot_type;
+
+// Must be called once before any other threads are started. Where the kernel supports it, the memory
+// barrier a reader needs when protecting a pointer is moved to the writer (via membarrier), so protecting
+// costs readers little more than the load itself.
+void hazard_pointer_init();
+
+// loads the pointer from source and protects it in this thread's slot, returns the protected pointer
+void* hazard_pointer_protect(hazard_pointer_slot_type slot, void * _Atomic *source);
+
+void hazard_pointer_clear(hazard_pointer_slot_type slot);
+
+typedef void (*hazard_pointer_free_func)(void* ptr);
+
+// Like hazard_pointer_wait_for_readers followed by free_func, but never blocks: if a thread still has ptr
+// protected, it's kept on a retired list and freed by a later call to this function once it's no longer
+// protected. The same unpublishing requirement applies.
+void hazard_pointer_retire(void* ptr, hazard_pointer_free_func free_func);
+
+// Blocks until no thread has ptr protected. The caller must have already unpublished ptr from every
+// source that readers protect it from, so it can't become protected again.
+void hazard_pointer_wait_for_readers(void* ptr);
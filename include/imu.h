@@ -28,7 +28,13 @@ struct imu_pose_t {
 	struct imu_euler_t euler;
 	bool has_orientation;
 	bool has_position;
-	uint32_t timestamp_ms;
+
+	// CLOCK_MONOTONIC time the device driver received the sample, see get_monotonic_time_ns()
+	uint64_t timestamp_ns;
+
+	// the sample's timestamp from the device's own clock, in ns, or 0 if the device doesn't provide one; only
+	// useful for spacing between samples, it's not comparable to timestamp_ns
+	uint64_t device_timestamp_ns;
 };
 
 extern const float pose_orientation_reset_data[16];
@@ -42,8 +48,21 @@ typedef struct imu_pose_t imu_pose_type;
 float degree_to_radian(float deg);
 float radian_to_degree(float rad);
 imu_quat_type normalize_quaternion(imu_quat_type q);
+
+// A product of two unit quaternions is off from unit length by float rounding only (~1e-7), this leaves room
+// for a long chain of unnormalized products before we pay for the sqrt and divides.
+#define QUAT_RENORMALIZE_TOLERANCE 1e-5f
+
+// only pays for normalizing when |q|^2 is more than QUAT_RENORMALIZE_TOLERANCE from 1 (or isn't finite)
+imu_quat_type renormalize_quaternion_lazy(imu_quat_type q);
 imu_quat_type conjugate(imu_quat_type q);
+
+// result is lazily renormalized, see multiply_quaternions_unnormalized for chains of products
 imu_quat_type multiply_quaternions(imu_quat_type q1, imu_quat_type q2);
+
+// Hamilton product as-is. Products of unit quaternions stay within float rounding of unit length, so a chain
+// of these only needs a renormalize_quaternion_lazy at the end.
+imu_quat_type multiply_quaternions_unnormalized(imu_quat_type q1, imu_quat_type q2);
 imu_quat_type quaternion_eus_to_nwu(imu_quat_type q);
 imu_quat_type euler_to_quaternion_xyz(imu_euler_type euler);
 imu_quat_type euler_to_quaternion_zyx(imu_euler_type euler);
@@ -68,4 +87,9 @@ static inline void imu_pose_sync_orientation_from_euler(imu_pose_type *p) {
 	}
 }
 
-float quat_small_angle_rad(imu_quat_type q1, imu_quat_type q2);
\ No newline at end of file
+float quat_small_angle_rad(imu_quat_type q1, imu_quat_type q2);
+float quat_dot(imu_quat_type q1, imu_quat_type q2);
+
+// interpolate along the shortest path from "from" to "to", t is clamped to [0, 1]
+imu_quat_type quat_nlerp(imu_quat_type from, imu_quat_type to, float t);
+imu_quat_type quat_slerp(imu_quat_type from, imu_quat_type to, float t);
\ No newline at end of file
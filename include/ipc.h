@@ -14,6 +14,9 @@ extern const char *date_ipc_name;
 extern const char *pose_orientation_ipc_name;
 extern const char *pose_orientation_mutex_ipc_name;
 extern const char *pose_position_data_ipc_name;
+extern const char *pose_orientation_predicted_ipc_name;
+extern const char *pose_position_predicted_ipc_name;
+extern const char *pose_prediction_look_ahead_ms_ipc_name;
 
 // deprecated - can be removed once this version is widely distributed
 extern const char *display_fov_ipc_name;
@@ -27,6 +30,13 @@ struct ipc_values_t {
     float *pose_position;
     pthread_mutex_t *pose_orientation_mutex;
 
+    // the latest pose extrapolated to when it will be on screen, published under pose_orientation_mutex
+    float *pose_orientation_predicted;
+    float *pose_position_predicted;
+
+    // written by consumers: how far past the sample time to predict, 0 uses the device's default look-ahead
+    float *pose_prediction_look_ahead_ms;
+
     float *display_fov;
     float *lens_distance_ratio;
 };
@@ -37,4 +47,11 @@ bool setup_ipc_values(ipc_values_type *ipc_values, bool debug);
 
 void setup_ipc_value(const char *name, void **shmemValue, size_t size, bool debug);
 
-void cleanup_ipc(char* file_prefix, bool debug);
\ No newline at end of file
+void cleanup_ipc(char* file_prefix, bool debug);
+
+// The per-value pose IPC is kept for existing consumers, new ones should read the pose region (see pose_shm.h).
+// Its process-shared mutex is never waited on: if a reader holds it, this returns false and the caller skips
+// updating the pose values for that sample, or retries a reset on the next one. Nothing in the driver reads
+// them back, plugins get the pose from handle_pose_data.
+bool try_lock_pose_ipc_values(ipc_values_type *ipc_values);
+void unlock_pose_ipc_values(ipc_values_type *ipc_values);
\ No newline at end of file
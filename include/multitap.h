@@ -7,4 +7,4 @@
 
 void init_multi_tap(int init_imu_cycles_per_s);
 
-int detect_multi_tap(imu_euler_type velocities, uint32_t timestamp, bool debug);
\ No newline at end of file
+int detect_multi_tap(imu_euler_type velocities, uint64_t timestamp_ms, bool debug);
\ No newline at end of file
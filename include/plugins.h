@@ -1,5 +1,7 @@
 #pragma once
 
+#include "buffer.h"
+#include "hazard_pointer.h"
 #include "imu.h"
 #include "ipc.h"
 
@@ -20,12 +22,28 @@ typedef void (*handle_ipc_change_func)();
 typedef bool (*modify_reference_pose_func)(imu_pose_type pose, imu_pose_type* ref_pose);
 typedef void (*handle_reference_pose_updated_func)(imu_pose_type old_reference_pose, imu_pose_type new_reference_pose);
 typedef void (*modify_pose_func)(imu_pose_type* pose);
-typedef void (*handle_pose_data_func)(imu_pose_type pose, imu_euler_type velocities, bool imu_calibrated, ipc_values_type *ipc_values);
+
+// The pose values handle_imu_update last published for consumers: orientation is the IMU buffer payload (see
+// push_to_imu_buffer), both hold the reset data after reset_pose_data. Owned by the pose pipeline thread, so
+// unlike the legacy IPC values they can be read without a lock.
+struct published_pose_t {
+    float orientation[IMU_BUFFER_PAYLOAD_SIZE];
+    float position[3];
+};
+
+typedef struct published_pose_t published_pose_type;
+
+// published is NULL if IPC isn't set up
+typedef void (*handle_pose_data_func)(imu_pose_type pose, imu_euler_type velocities, bool imu_calibrated, const published_pose_type *published);
 typedef void (*reset_pose_data_func)();
 typedef void (*handle_state_func)();
 typedef void (*handle_device_connect_func)();
 typedef void (*handle_device_disconnect_func)();
 
+// returns false if the plugin's per-sample hooks (modify_reference_pose, modify_pose, handle_pose_data) would
+// do nothing for the current config and state
+typedef bool (*is_active_func)();
+
 struct plugin_t {
     char* id;
 
@@ -47,8 +65,26 @@ struct plugin_t {
     handle_device_connect_func handle_device_connect;
     handle_device_disconnect_func handle_device_disconnect;
 
+    // optional, if not set the plugin's per-sample hooks are always called
+    is_active_func is_active;
+
     // TODO handle feature access change
 };
 typedef struct plugin_t plugin_type;
 
-extern const plugin_type plugins;
\ No newline at end of file
+extern const plugin_type plugins;
+
+// The per-sample hooks are dispatched from a plan that only holds the hooks of active plugins. The plan is
+// rebuilt by the pose pipeline thread on the next sample after this is called. plugins already does this
+// after config, state, IPC and device changes, a plugin only needs to call it if its own is_active result
+// changes for some other reason.
+void plugins_invalidate_hook_plan();
+
+// Plugins must hand configs they replace in set_config to this rather than freeing them, other threads may
+// still be running hooks that use them. free_func is called once none are.
+void plugins_retire_config(void* config, hazard_pointer_free_func free_func);
+
+// Every plugins hook runs between these already. A plugin that reads its config from its own thread must
+// do so between them as well, and shouldn't block while protected.
+void plugins_protect_configs();
+void plugins_release_configs();
@@ -2,6 +2,8 @@
 
 #include "plugins.h"
 
+#include <stdint.h>
+
 struct breezy_desktop_config_t {
     bool enabled;
     float look_ahead_override;
@@ -12,4 +14,50 @@ struct breezy_desktop_config_t {
 };
 typedef struct breezy_desktop_config_t breezy_desktop_config;
 
-extern const plugin_type breezy_desktop_plugin;
\ No newline at end of file
+extern const plugin_type breezy_desktop_plugin;
+
+// Layout of the /dev/shm/breezy_desktop_imu file, from version 7 on: a version byte, the field count, the size
+// of a field table entry, then the field table itself. Readers look fields up by id rather than assuming
+// offsets, so fields can be added (or moved) without breaking them; the version only changes if an existing
+// field changes meaning. Fields inside the IMU record are guarded by BREEZY_FIELD_IMU_SEQUENCE, which is odd
+// while the record is being written.
+#define BREEZY_DESKTOP_HEADER_FIELD_COUNT_OFFSET 1
+#define BREEZY_DESKTOP_HEADER_ENTRY_SIZE_OFFSET 2
+#define BREEZY_DESKTOP_HEADER_TABLE_OFFSET 4
+
+// ids are permanent, a retired field's id is never reused
+enum breezy_desktop_field_id_t {
+    BREEZY_FIELD_ENABLED = 1,
+    BREEZY_FIELD_LOOK_AHEAD_CFG,
+    BREEZY_FIELD_DISPLAY_RES,
+    BREEZY_FIELD_FOV,
+    BREEZY_FIELD_LENS_DISTANCE_RATIO,
+    BREEZY_FIELD_SBS_ENABLED,
+    BREEZY_FIELD_CUSTOM_BANNER_ENABLED,
+    BREEZY_FIELD_IMU_SEQUENCE,
+    BREEZY_FIELD_SMOOTH_FOLLOW_ENABLED,
+    BREEZY_FIELD_SMOOTH_FOLLOW_ORIGIN,
+    BREEZY_FIELD_POSE_POSITION,
+    BREEZY_FIELD_IMU_DATE_MS,
+
+    // 4 rows of 4 floats, the first row is the latest orientation quaternion and shares a cache line with
+    // BREEZY_FIELD_IMU_SEQUENCE
+    BREEZY_FIELD_POSE_ORIENTATION
+};
+
+// element type, the entry's length is a multiple of its size
+enum breezy_desktop_field_type_t {
+    BREEZY_FIELD_TYPE_U8 = 1,
+    BREEZY_FIELD_TYPE_U32,
+    BREEZY_FIELD_TYPE_U64,
+    BREEZY_FIELD_TYPE_F32
+};
+
+struct breezy_desktop_field_entry_t {
+    uint16_t id;
+    uint8_t type;
+    uint8_t reserved;
+    uint16_t offset;
+    uint16_t length;
+};
+typedef struct breezy_desktop_field_entry_t breezy_desktop_field_entry_type;
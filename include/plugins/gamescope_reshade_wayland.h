@@ -7,6 +7,9 @@
 
 struct gamescope_reshade_wayland_config_t {
     bool disabled;
+
+    // send at most one pose per display refresh instead of one per IMU sample, when the refresh rate is known
+    bool pace_to_refresh;
 };
 typedef struct gamescope_reshade_wayland_config_t gamescope_reshade_wayland_config;
 
@@ -14,9 +17,28 @@ typedef void (*gamescope_reshade_effect_ready_callback)();
 
 bool is_gamescope_reshade_ipc_connected();
 
+// every uniform the effect uses must fit these, a value that doesn't is logged and dropped rather than sent
+#define GAMESCOPE_RESHADE_UNIFORM_MAX_COUNT 64
+#define GAMESCOPE_RESHADE_UNIFORM_MAX_SIZE (16 * sizeof(float))
+
+// Records the value, it's sent by the gamescope sender thread with the next batch, right away if flush is set.
+// Only waits on other threads recording values, never on gamescope.
 void set_gamescope_reshade_effect_uniform_variable(const char *variable_name, const void *data, int entries, size_t size, bool flush);
 
-// will skip if there's already a lock on the wayland client, for values that are set repeatedly, like IMU data
-void set_skippable_gamescope_reshade_effect_uniform_variable(const char *variable_name, const void *data, int entries, size_t size, bool flush);
+// the uniforms sent with every pose
+struct gamescope_reshade_pose_uniforms_t {
+    float pose_orientation_predicted[4];
+    float pose_position_predicted[3];
+    float pose_orientation[16];
+    float pose_position[3];
+};
+typedef struct gamescope_reshade_pose_uniforms_t gamescope_reshade_pose_uniforms_type;
+
+// Hands the pose to the gamescope sender thread, replacing one it hasn't gotten to yet (counted as coalesced).
+// Never blocks and never calls into libwayland, for the pose path.
+void set_gamescope_reshade_pose_uniforms(const gamescope_reshade_pose_uniforms_type *uniforms);
+
+// same as set_gamescope_reshade_pose_uniforms, for the keepalive_date uniform
+void set_gamescope_reshade_keepalive_date(const float date[4]);
 
 extern const plugin_type gamescope_reshade_wayland_plugin;
\ No newline at end of file
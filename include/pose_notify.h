@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+
+// Socket, under the runtime directory, that hands out eventfds signaled as poses are published. A client
+// connects, writes a uint32_t (native byte order) with how many poses to coalesce into one signal (0 is
+// treated as 1), and gets back a one-byte status (0 on success) with the eventfd attached as SCM_RIGHTS
+// ancillary data. The eventfd's counter goes up by 1 every that many poses, so it can be added to any
+// poll/epoll loop. The subscription lasts until the client closes its end of the socket.
+extern const char* pose_notify_socket_filename;
+
+#define POSE_NOTIFY_MAX_SUBSCRIBERS 16
+
+#define POSE_NOTIFY_STATUS_OK 0
+#define POSE_NOTIFY_STATUS_FULL 1
+#define POSE_NOTIFY_STATUS_ERROR 2
+
+// creates the socket and starts the thread that serves it, poses are only signaled via the shm futex word
+// if this fails
+void pose_notify_init();
+
+// signals the shm futex word and any eventfd subscribers that are due, call once everything for a pose has
+// been published; never blocks, must only be called from one thread at a time
+void pose_notify_publish();
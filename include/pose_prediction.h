@@ -0,0 +1,38 @@
+#pragma once
+
+#include "imu.h"
+
+#include <stdint.h>
+
+// Tracks angular (and, for 6DoF sources, linear) velocity and acceleration from consecutive poses, so a pose
+// can be extrapolated to the time it will actually be on screen. Estimates are exponentially smoothed since
+// differencing samples that arrive every millisecond or so amplifies sensor noise.
+struct pose_predictor_t {
+    // poses seen since the last reset, capped at 2 (velocity needs one previous pose)
+    uint32_t samples;
+    uint64_t last_timestamp_ns;
+    uint64_t last_device_timestamp_ns;
+    imu_quat_type last_orientation;
+    imu_vec3_type last_position;
+
+    // body-frame, radians per second (squared)
+    imu_vec3_type angular_velocity;
+    imu_vec3_type angular_acceleration;
+
+    // reference-frame, position units per second (squared)
+    imu_vec3_type linear_velocity;
+    imu_vec3_type linear_acceleration;
+};
+
+typedef struct pose_predictor_t pose_predictor_type;
+
+void pose_predictor_reset(pose_predictor_type *predictor);
+
+// Feed every pose in order, poses that go backwards in time or jump too far (e.g. a recenter) restart the
+// estimates. Velocities are taken over device_timestamp_ns spacing when the device provides it, falling back
+// to timestamp_ns.
+void pose_predictor_observe(pose_predictor_type *predictor, imu_pose_type pose);
+
+// extrapolates pose forward by look_ahead_ns, returns pose as-is until the predictor has seen enough samples
+imu_pose_type pose_predictor_predict(const pose_predictor_type *predictor, imu_pose_type pose,
+                                     uint64_t look_ahead_ns);
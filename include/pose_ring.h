@@ -0,0 +1,39 @@
+#pragma once
+
+#include "imu.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// must be a power of 2; 16 slots gives the pose pipeline ~16ms of slack at 1000Hz
+#define POSE_RING_CAPACITY 16
+#define POSE_RING_CACHE_LINE 64
+
+// Bounded single-producer/single-consumer ring of poses. The producer (a device driver callback) never
+// blocks: if the consumer falls behind, the oldest unread pose is dropped in favor of the newest one and
+// the overrun counter is incremented. Indices are monotonic 64-bit counters, so they never wrap in practice.
+struct pose_ring_t {
+    // written by the producer only
+    _Alignas(POSE_RING_CACHE_LINE) atomic_uint_fast64_t head;
+
+    // advanced by the consumer, or by the producer when it has to drop the oldest pose
+    _Alignas(POSE_RING_CACHE_LINE) atomic_uint_fast64_t tail;
+
+    _Alignas(POSE_RING_CACHE_LINE) atomic_uint_fast64_t overruns;
+
+    _Alignas(POSE_RING_CACHE_LINE) imu_pose_type slots[POSE_RING_CAPACITY];
+};
+
+typedef struct pose_ring_t pose_ring_type;
+
+pose_ring_type* pose_ring_create();
+void pose_ring_free(pose_ring_type* ring);
+
+// producer side, returns false if the oldest pose had to be dropped to make room
+bool pose_ring_push(pose_ring_type* ring, const imu_pose_type* pose);
+
+// consumer side, returns false if the ring is empty
+bool pose_ring_pop(pose_ring_type* ring, imu_pose_type* out_pose);
+
+uint64_t pose_ring_overruns(pose_ring_type* ring);
@@ -0,0 +1,306 @@
+#pragma once
+
+#include <linux/futex.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+// "XRPOSE\0\0", little-endian
+#define POSE_SHM_MAGIC 0x000045534F505258ULL
+#define POSE_SHM_VERSION 3
+
+// Everything published for one pose. Orientations are quaternions in x, y, z, w order, in the same frame as
+// the pose_orientation IPC value, timestamps are CLOCK_MONOTONIC.
+struct pose_shm_sample_t {
+    uint64_t timestamp_ns;
+    float orientation[4];
+    float position[3];
+    uint32_t flags;
+
+    // the pose extrapolated to predicted_timestamp_ns, see pose_prediction.h
+    uint64_t predicted_timestamp_ns;
+    float predicted_orientation[4];
+    float predicted_position[3];
+    uint32_t reserved;
+};
+
+typedef struct pose_shm_sample_t pose_shm_sample_type;
+
+#define POSE_SHM_FLAG_HAS_POSITION (1u << 0)
+
+// Layout of the pose region. It lives in a sealed memfd rather than a file, so consumers that can't see
+// /dev/shm (Flatpak, containers) get the same access as everyone else: connecting to pose_shm.sock under the
+// driver's runtime directory hands over the fd, see pose_shm_open. Since version 3 that fd is read-only, only
+// the driver's own mapping can write to it. The writer never blocks: sequence is odd while a sample is being
+// written, so readers copy the sample and retry if sequence was odd or changed in the meantime (see
+// pose_shm_read). Readers should check the magic and version, and use header_size and sample_size to find
+// the sample, fields may be added to either in later versions.
+struct pose_shm_region_t {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t sample_size;
+    uint32_t reserved;
+
+    // even and unchanged across a read means the copy is consistent; 0 means nothing's been published yet
+    _Alignas(64) _Atomic uint64_t sequence;
+
+    _Alignas(64) pose_shm_sample_type sample;
+};
+
+typedef struct pose_shm_region_t pose_shm_region_type;
+
+// A futex word bumped once everything for a pose has been published (including the history ring), and the
+// number of processes blocked on it, see pose_shm_wait. Waiters have to write to it, so it's a separate
+// memfd handed over alongside the region's, and the driver never relies on what's in it: a client that
+// scribbles over it can only cause spurious or missed wakes for other waiters.
+struct pose_shm_notify_t {
+    _Atomic uint32_t count;
+    _Atomic uint32_t waiters;
+};
+
+typedef struct pose_shm_notify_t pose_shm_notify_type;
+
+// a write takes well under a microsecond, this only gives up if the writer died partway through one
+#define POSE_SHM_READ_ATTEMPTS 100000
+
+// Seqlock read of the latest sample, returns false if nothing has been published yet or no consistent copy
+// could be made. Safe to call from other processes against their mapping of the region.
+static inline bool pose_shm_read(const pose_shm_region_type *region, pose_shm_sample_type *out) {
+    for (int attempt = 0; attempt < POSE_SHM_READ_ATTEMPTS; attempt++) {
+        uint64_t sequence = atomic_load_explicit((_Atomic uint64_t *)&region->sequence, memory_order_acquire);
+        if (sequence == 0) return false;
+        if (sequence & 1) continue;
+
+        memcpy(out, (const void *)&region->sample, sizeof(pose_shm_sample_type));
+
+        // keeps the copy above from being reordered after the re-check
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit((_Atomic uint64_t *)&region->sequence, memory_order_relaxed) == sequence)
+            return true;
+    }
+
+    return false;
+}
+
+static inline uint32_t pose_shm_notify_count(const pose_shm_notify_type *notify) {
+    return atomic_load_explicit((_Atomic uint32_t *)&notify->count, memory_order_acquire);
+}
+
+// Blocks until at least min_poses poses have been published since the notify count had the value seen_count
+// (pass pose_shm_notify_count() to start, then the previous return value), or until timeout_ns passes if
+// it's non-zero. Returns the latest count, the caller can tell a timeout by it being too low.
+//
+// Every pose wakes all waiters, a consumer that only wants every Nth pose is better served by an eventfd
+// from the pose notify socket, see pose_notify.h.
+static inline uint32_t pose_shm_wait(pose_shm_notify_type *notify, uint32_t seen_count, uint32_t min_poses,
+                                     uint64_t timeout_ns) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t deadline_ns = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec + timeout_ns;
+
+    // both sides use sequentially consistent operations on the count and waiters: either the writer sees
+    // this waiter and wakes it, or this sees the bumped count and doesn't go to sleep
+    atomic_fetch_add(&notify->waiters, 1);
+    uint32_t count = atomic_load(&notify->count);
+    while (count - seen_count < min_poses) {
+        struct timespec timeout;
+        if (timeout_ns) {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            uint64_t now_ns = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+            if (now_ns >= deadline_ns) break;
+
+            timeout.tv_sec = (deadline_ns - now_ns) / 1000000000ULL;
+            timeout.tv_nsec = (deadline_ns - now_ns) % 1000000000ULL;
+        }
+
+        // shared (not private) futex, the writer is another process
+        syscall(SYS_futex, (uint32_t *)&notify->count, FUTEX_WAIT, count, timeout_ns ? &timeout : NULL, NULL, 0);
+        count = atomic_load(&notify->count);
+    }
+    atomic_fetch_sub(&notify->waiters, 1);
+
+    return count;
+}
+
+// "XRPHIST\0", little-endian
+#define POSE_HISTORY_MAGIC 0x0054534948505258ULL
+#define POSE_HISTORY_VERSION 1
+
+// upper bound for the pose_history_size config, about 4 seconds at 1000Hz
+#define POSE_HISTORY_MAX_CAPACITY 4096
+
+// One pose in the history ring. Each entry is its own seqlock: sequence is 2 * index + 1 while the pose with
+// that index is being written and 2 * index + 2 once it's complete, so readers can also tell whether the slot
+// still holds the pose they were looking for. Orientation and timestamps are as in pose_shm_sample_type,
+// device_timestamp_ns is the device's own clock (0 if it doesn't provide one), not comparable to
+// host_timestamp_ns.
+struct pose_history_entry_t {
+    _Alignas(64) _Atomic uint64_t sequence;
+    uint64_t host_timestamp_ns;
+    uint64_t device_timestamp_ns;
+    float orientation[4];
+    float position[3];
+    uint32_t flags;
+};
+
+typedef struct pose_history_entry_t pose_history_entry_type;
+
+// Layout of the /dev/shm pose history region, only present while pose_history_size is configured. Pose index
+// i lives in entries[i % capacity]; head is the number of poses ever written, so the newest is head - 1.
+// If the capacity is changed the driver sets stale and replaces the file, readers should then re-open it.
+struct pose_history_region_t {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t entry_size;
+    uint32_t capacity;
+    _Atomic uint32_t stale;
+    uint32_t reserved;
+
+    _Alignas(64) _Atomic uint64_t head;
+
+    pose_history_entry_type entries[];
+};
+
+typedef struct pose_history_region_t pose_history_region_type;
+
+static inline uint64_t pose_history_head(const pose_history_region_type *region) {
+    return atomic_load_explicit((_Atomic uint64_t *)&region->head, memory_order_acquire);
+}
+
+// Copies pose number index out of the ring. Returns false if that pose hasn't been written yet, has since
+// been overwritten, or is being overwritten right now; none of these get better by retrying.
+static inline bool pose_history_read(const pose_history_region_type *region, uint64_t index,
+                                     pose_history_entry_type *out) {
+    const pose_history_entry_type *entry = &region->entries[index % region->capacity];
+    uint64_t sequence = atomic_load_explicit((_Atomic uint64_t *)&entry->sequence, memory_order_acquire);
+    if (sequence != 2 * index + 2) return false;
+
+    out->host_timestamp_ns = entry->host_timestamp_ns;
+    out->device_timestamp_ns = entry->device_timestamp_ns;
+    memcpy(out->orientation, (const void *)entry->orientation, sizeof(out->orientation));
+    memcpy(out->position, (const void *)entry->position, sizeof(out->position));
+    out->flags = entry->flags;
+
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit((_Atomic uint64_t *)&entry->sequence, memory_order_relaxed) != sequence)
+        return false;
+
+    atomic_store_explicit(&out->sequence, sequence, memory_order_relaxed);
+    return true;
+}
+
+// Finds the two newest consecutive poses with before->host_timestamp_ns <= timestamp_ns <
+// after->host_timestamp_ns, for interpolating between them. Returns false if timestamp_ns isn't inside the
+// window the ring currently holds (including when it's newer than the latest pose, extrapolate from the last
+// two poses instead).
+static inline bool pose_history_find(const pose_history_region_type *region, uint64_t timestamp_ns,
+                                     pose_history_entry_type *before, pose_history_entry_type *after) {
+    uint64_t head = pose_history_head(region);
+    if (head < 2) return false;
+
+    uint64_t oldest = head > region->capacity ? head - region->capacity : 0;
+    if (!pose_history_read(region, head - 1, after) || after->host_timestamp_ns <= timestamp_ns) return false;
+
+    for (uint64_t index = head - 1; index-- > oldest;) {
+        if (!pose_history_read(region, index, before)) return false;
+        if (before->host_timestamp_ns <= timestamp_ns) return true;
+        *after = *before;
+    }
+
+    return false;
+}
+
+// Connects to the driver's pose region socket at socket_path ($XDG_RUNTIME_DIR/xr_driver/pose_shm.sock) and
+// maps the region it hands over, read-only. If notify isn't NULL, the notify word is mapped into it as well,
+// for pose_shm_wait. Returns NULL if the driver isn't running or sent something unexpected. Release them with
+// munmap((void *)region, sizeof(pose_shm_region_type)) and munmap(notify, sizeof(pose_shm_notify_type)).
+static inline const pose_shm_region_type *pose_shm_open(const char *socket_path, pose_shm_notify_type **notify) {
+    if (notify) *notify = NULL;
+
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) return NULL;
+    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+
+    int socket_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (socket_fd == -1) return NULL;
+    if (connect(socket_fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        close(socket_fd);
+        return NULL;
+    }
+
+    // the region's fd, then the notify word's
+    uint8_t version = 0;
+    struct iovec iov = { .iov_base = &version, .iov_len = sizeof(version) };
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(2 * sizeof(int))];
+    } control;
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buffer,
+        .msg_controllen = sizeof(control.buffer)
+    };
+    ssize_t bytes = recvmsg(socket_fd, &msg, MSG_CMSG_CLOEXEC);
+    close(socket_fd);
+
+    struct cmsghdr *cmsg = bytes == sizeof(version) ? CMSG_FIRSTHDR(&msg) : NULL;
+    if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) return NULL;
+
+    int fds[2] = { -1, -1 };
+    int fd_count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    memcpy(fds, CMSG_DATA(cmsg), (fd_count < 2 ? fd_count : 2) * sizeof(int));
+    if (version < POSE_SHM_VERSION || fd_count != 2) {
+        for (int i = 0; i < fd_count && i < 2; i++) close(fds[i]);
+        return NULL;
+    }
+
+    void *mapped = mmap(NULL, sizeof(pose_shm_region_type), PROT_READ, MAP_SHARED, fds[0], 0);
+    close(fds[0]);
+
+    void *notify_mapped = MAP_FAILED;
+    if (notify && mapped != MAP_FAILED)
+        notify_mapped = mmap(NULL, sizeof(pose_shm_notify_type), PROT_READ | PROT_WRITE, MAP_SHARED, fds[1], 0);
+    close(fds[1]);
+
+    if (mapped == MAP_FAILED || (notify && notify_mapped == MAP_FAILED)) {
+        if (mapped != MAP_FAILED) munmap(mapped, sizeof(pose_shm_region_type));
+        return NULL;
+    }
+
+    const pose_shm_region_type *region = (const pose_shm_region_type *)mapped;
+    if (atomic_load_explicit((_Atomic uint64_t *)&region->magic, memory_order_acquire) != POSE_SHM_MAGIC) {
+        munmap(mapped, sizeof(pose_shm_region_type));
+        if (notify) munmap(notify_mapped, sizeof(pose_shm_notify_type));
+        return NULL;
+    }
+
+    if (notify) *notify = (pose_shm_notify_type *)notify_mapped;
+    return region;
+}
+
+extern const char* pose_shm_socket_filename;
+extern const char* pose_history_filename;
+
+// creates the pose region and starts handing it out on pose_shm.sock, poses are silently not published to it
+// if this fails
+void pose_shm_init();
+
+// never blocks, must only be called from one thread at a time
+void pose_shm_publish(const pose_shm_sample_type *sample);
+
+// bumps the notify count and wakes any pose_shm_wait callers, once a pose's been published everywhere
+void pose_shm_notify();
+
+// Appends a pose to the history ring, (re)creating or removing the ring first if capacity differs from the
+// current one (0 disables it). Never blocks otherwise, must only be called from one thread at a time.
+void pose_history_publish(uint32_t capacity, const pose_history_entry_type *entry);
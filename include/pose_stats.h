@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// "XRSTATS\0", little-endian
+#define POSE_STATS_MAGIC 0x0053544154535258ULL
+#define POSE_STATS_VERSION 1
+
+// bucket i counts durations in [2^i, 2^(i+1)) ns, the last bucket also counts everything longer
+#define POSE_STATS_BUCKETS 32
+#define POSE_STATS_MAX_PLUGINS 16
+#define POSE_STATS_NAME_LENGTH 32
+
+enum pose_stats_stage_t {
+    POSE_STATS_INGEST = 0,
+
+    // sample received until the pose pipeline thread picks it up
+    POSE_STATS_PIPELINE_WAIT,
+    POSE_STATS_REFERENCE_POSE,
+    POSE_STATS_MODIFY_POSE,
+    POSE_STATS_DEAD_ZONE,
+    POSE_STATS_SHM_PUBLISH,
+    POSE_STATS_GAMESCOPE_FLUSH,
+
+    // pose handed to the gamescope sender thread until it's been flushed to gamescope
+    POSE_STATS_GAMESCOPE_SEND,
+
+    // sample received until every consumer has been handed the pose
+    POSE_STATS_END_TO_END,
+
+    // one handle_pose_data stage per plugin, in plugin order
+    POSE_STATS_PLUGIN_FIRST,
+
+    POSE_STATS_STAGE_COUNT = POSE_STATS_PLUGIN_FIRST + POSE_STATS_MAX_PLUGINS
+};
+
+typedef enum pose_stats_stage_t pose_stats_stage_type;
+
+// Each stage gets its own cache line(s) since stages are recorded from different threads. Counters are only
+// ever incremented, readers should expect them to be slightly inconsistent with each other.
+struct pose_stats_histogram_t {
+    _Alignas(64) char name[POSE_STATS_NAME_LENGTH];
+    _Atomic uint64_t count;
+    _Atomic uint64_t total_ns;
+    _Atomic uint64_t max_ns;
+    _Atomic uint64_t buckets[POSE_STATS_BUCKETS];
+};
+
+typedef struct pose_stats_histogram_t pose_stats_histogram_type;
+
+// Layout of the /dev/shm stats block. The sizes are written out so readers don't need to know this struct's
+// padding.
+struct pose_stats_block_t {
+    uint64_t magic;
+    uint64_t version;
+    uint64_t header_size;
+    uint64_t stage_size;
+    uint64_t stage_count;
+    uint64_t bucket_count;
+
+    pose_stats_histogram_type stages[POSE_STATS_STAGE_COUNT];
+};
+
+typedef struct pose_stats_block_t pose_stats_block_type;
+
+// Turns recording on or off, driven by the "latency" debug flag. The stats block is created (or reset) the first
+// time it's turned on, and stops updating when it's turned off again. Stats are silently dropped if the block
+// can't be created.
+void pose_stats_set_enabled(bool enabled);
+
+// name is kept, not copied, so it has to outlive the driver
+void pose_stats_set_stage_name(pose_stats_stage_type stage, const char* name);
+
+void pose_stats_record(pose_stats_stage_type stage, uint64_t elapsed_ns);
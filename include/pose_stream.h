@@ -0,0 +1,106 @@
+#pragma once
+
+#include "imu.h"
+
+#include <stdint.h>
+
+// SOCK_SEQPACKET socket, under the runtime directory, that streams poses to any number of subscribers. A
+// client connects and sends one pose_stream_request_type, the driver answers with one
+// pose_stream_response_type and, if that's accepted, one message per delivered pose: a
+// pose_stream_message_header_type followed by the requested fields as floats, in the order of the flag bits
+// below. All values are in native byte order.
+//
+// Subscribers that don't keep up have poses dropped rather than slowing anything else down, the count of
+// poses dropped so far is sent along with every message.
+extern const char* pose_stream_socket_filename;
+
+#define POSE_STREAM_PROTOCOL_VERSION 1
+#define POSE_STREAM_MAX_SUBSCRIBERS 16
+
+// quaternion, x, y, z, w, same frame as the pose_orientation IPC value
+#define POSE_STREAM_FIELD_ORIENTATION (1u << 0)
+
+// x, y, z; only meaningful when POSE_STREAM_FLAG_HAS_POSITION is set on the message
+#define POSE_STREAM_FIELD_POSITION (1u << 1)
+
+// roll, pitch, yaw, degrees
+#define POSE_STREAM_FIELD_EULER (1u << 2)
+
+// roll, pitch, yaw, degrees per second
+#define POSE_STREAM_FIELD_VELOCITY (1u << 3)
+
+#define POSE_STREAM_FIELDS_ALL (POSE_STREAM_FIELD_ORIENTATION | POSE_STREAM_FIELD_POSITION | \
+                                POSE_STREAM_FIELD_EULER | POSE_STREAM_FIELD_VELOCITY)
+
+enum pose_stream_timestamp_format_t {
+    // CLOCK_MONOTONIC nanoseconds
+    POSE_STREAM_TIMESTAMP_MONOTONIC_NS = 0,
+
+    // milliseconds since the Unix epoch
+    POSE_STREAM_TIMESTAMP_EPOCH_MS,
+
+    // the device's own clock in nanoseconds, 0 for devices that don't provide one
+    POSE_STREAM_TIMESTAMP_DEVICE_NS
+};
+
+enum pose_stream_status_t {
+    POSE_STREAM_STATUS_OK = 0,
+    POSE_STREAM_STATUS_UNSUPPORTED_VERSION,
+    POSE_STREAM_STATUS_INVALID_REQUEST,
+    POSE_STREAM_STATUS_FULL
+};
+
+struct pose_stream_request_t {
+    uint32_t version;
+    uint32_t fields;
+
+    // 0 delivers every pose, anything else skips poses that arrive sooner than 1/max_rate_hz after the last
+    // delivered one
+    uint32_t max_rate_hz;
+    uint32_t timestamp_format;
+};
+
+typedef struct pose_stream_request_t pose_stream_request_type;
+
+struct pose_stream_response_t {
+    uint32_t version;
+    uint32_t status;
+};
+
+typedef struct pose_stream_response_t pose_stream_response_type;
+
+#define POSE_STREAM_FLAG_HAS_POSITION (1u << 0)
+
+struct pose_stream_message_header_t {
+    // increases by one per pose published by the driver, so gaps show decimation and drops
+    uint64_t sequence;
+    uint64_t timestamp;
+    uint32_t fields;
+    uint32_t flags;
+    uint32_t dropped;
+    uint32_t reserved;
+};
+
+typedef struct pose_stream_message_header_t pose_stream_message_header_type;
+
+#define POSE_STREAM_MAX_MESSAGE_SIZE (sizeof(pose_stream_message_header_type) + 13 * sizeof(float))
+
+// everything a subscriber could ask for, for one pose
+struct pose_stream_sample_t {
+    uint64_t timestamp_ns;
+    uint64_t device_timestamp_ns;
+    imu_quat_type orientation;
+    imu_vec3_type position;
+    imu_euler_type euler;
+    imu_euler_type velocity;
+    uint32_t flags;
+};
+
+typedef struct pose_stream_sample_t pose_stream_sample_type;
+
+// creates the socket and starts the thread that serves it
+void pose_stream_init();
+
+// Hands a pose to the stream thread. Costs the same however many subscribers there are (and next to
+// nothing when there are none), never blocks, must only be called from one thread at a time.
+void pose_stream_publish(const pose_stream_sample_type* sample);
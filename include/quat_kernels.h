@@ -0,0 +1,36 @@
+#pragma once
+
+#include "imu.h"
+
+// Quaternion kernels that work on arrays, vectorized with SSE4.1 or AVX2/FMA on x86_64 and NEON on aarch64.
+// quat_kernels_init() picks the best set this CPU supports; until then (or if none applies) quat_kernels holds
+// the scalar set, which just loops over the functions in imu.h. Every set agrees with those functions to
+// within float rounding, see benchmarks/quat_kernels_bench.c.
+//
+// out may be the same array as an input, but mustn't otherwise overlap one.
+struct quat_kernels_t {
+    const char* name;
+
+    // out[i] = a[i] * b[i], see multiply_quaternions_unnormalized
+    void (*multiply)(const imu_quat_type* a, const imu_quat_type* b, imu_quat_type* out, int count);
+
+    // renormalize_quaternion_lazy, in place
+    void (*renormalize_lazy)(imu_quat_type* q, int count);
+
+    // out[i] = quat_nlerp(from[i], to[i], t[i])
+    void (*nlerp)(const imu_quat_type* from, const imu_quat_type* to, const float* t, imu_quat_type* out,
+                  int count);
+
+    // out[i] = vector_rotate(v[i], q[i]), without vector_rotate's renormalizing, so q[i] must be unit length
+    void (*rotate)(const imu_vec3_type* v, const imu_quat_type* q, imu_vec3_type* out, int count);
+};
+
+typedef struct quat_kernels_t quat_kernels_type;
+
+extern quat_kernels_type quat_kernels;
+
+void quat_kernels_init();
+
+// Fills sets with every kernel set this CPU can run, from the scalar set up to the one quat_kernels_init
+// picks, and returns how many there are.
+int quat_kernels_supported(const quat_kernels_type** sets, int max_sets);
@@ -3,18 +3,26 @@
 #include "config.h"
 #include "connection_pool.h"
 #include "devices.h"
+#include "hazard_pointer.h"
 #include "state.h"
 
+#include <stdatomic.h>
+
 struct runtime_context_t {
-    // user-controlled, read-only driver configurations (plugin configs not present), persistent
-    driver_config_type *config;
+    // user-controlled, read-only driver configurations (plugin configs not present), persistent;
+    // an immutable snapshot that's replaced as a whole, only access it using config() and set_config()
+    driver_config_type * _Atomic config;
 
-    // properties of the currently connected device, modified only by the device driver module
-    device_properties_type *device;
+    // properties of the currently connected device, modified only by the device driver module;
+    // only access it using the device_* functions below
+    device_properties_type * _Atomic device;
 
     // live view of the state of the driver, reflects real-world state, not intentions
     driver_state_type *state;
 
+    // immutable snapshot of the state fields read on the pose path, see publish_hot_state()
+    driver_hot_state_type * _Atomic hot_state;
+
     connection_pool_type *conn_pool;
 };
 
@@ -25,22 +33,47 @@ typedef struct runtime_context_t runtime_context;
 // `static inline` and compile down to a single load/store even without LTO.
 extern runtime_context g_runtime_context;
 
-static inline void set_state(driver_state_type *state) {
-    g_runtime_context.state = state;
-}
+// sets the state and publishes its first hot state snapshot
+void set_state(driver_state_type *state);
 
 static inline driver_state_type* state(void) {
     return g_runtime_context.state;
 }
 
-static inline void set_config(driver_config_type *config) {
-    g_runtime_context.config = config;
+// Copies the hot fields out of state() into a new snapshot and publishes it. Call this after changing any of
+// them, readers keep seeing the previous snapshot until then.
+void publish_hot_state();
+
+// Config and hot state snapshots are never modified once published, and each thread keeps the one it got
+// last protected (see hazard_pointer.h). A pointer from config() or hot_state() is only good for the expression
+// it's used in, since the thread's next call to the same accessor, possibly from a function called in between,
+// can move its protection to a newer snapshot and let the old one be freed.
+//
+// To keep a snapshot in a local, take it with config_acquire() or hot_state_acquire() and pair that with the
+// matching release. Until then, the same thread's config() or hot_state() calls return that same snapshot, so
+// functions called in between see a consistent view too. Acquires nest, only the outermost release lets go.
+extern _Thread_local driver_config_type* held_config;
+extern _Thread_local driver_hot_state_type* held_hot_state;
+
+static inline driver_hot_state_type* hot_state(void) {
+    if (held_hot_state) return held_hot_state;
+    return hazard_pointer_protect(HAZARD_SLOT_HOT_STATE, (void * _Atomic *)&g_runtime_context.hot_state);
 }
 
+driver_hot_state_type* hot_state_acquire();
+void hot_state_release();
+
+// publishes config as the current snapshot, the previous one is freed once no thread is using it
+void set_config(driver_config_type *config);
+
 static inline driver_config_type* config(void) {
-    return g_runtime_context.config;
+    if (held_config) return held_config;
+    return hazard_pointer_protect(HAZARD_SLOT_CONFIG, (void * _Atomic *)&g_runtime_context.config);
 }
 
+driver_config_type* config_acquire();
+void config_release();
+
 static inline void set_connection_pool(connection_pool_type *pool) {
     g_runtime_context.conn_pool = pool;
 }
@@ -52,6 +85,8 @@ static inline connection_pool_type* connection_pool(void) {
 // device is so heavily used across threads that it becomes difficult to find a good time to free() it,
 // so the below functions keep a reference count and free it when the count reaches 0
 //
+// checkout and checkin are called several times per IMU sample, so they never take a lock
+//
 // if a device is already set, this will queue it and set it after the current device is released.
 // once set, it's considered checked out by the setting thread and the reference count is initialized at 1
 void set_device_and_checkout(device_properties_type *device);
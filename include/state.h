@@ -4,6 +4,7 @@
 #include "imu.h" // for imu_quat_type
 
 #include <inttypes.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdio.h>
 
@@ -44,6 +45,20 @@ struct driver_state_t {
 };
 typedef struct driver_state_t driver_state_type;
 
+// The state fields read for every pose, copied out of driver_state_type by publish_hot_state() so readers get
+// them all from the same update. version increases with every publish.
+struct driver_hot_state_t {
+    uint64_t version;
+    calibration_state_type calibration_state;
+    bool sbs_mode_enabled;
+    bool connected_device_pose_has_position;
+    float connected_device_full_distance_cm;
+    bool breezy_desktop_smooth_follow_enabled;
+    float breezy_desktop_follow_threshold;
+    float breezy_desktop_display_distance;
+};
+typedef struct driver_hot_state_t driver_hot_state_type;
+
 enum sbs_control_t {
     SBS_CONTROL_UNSET,
     SBS_CONTROL_ENABLE,
@@ -51,8 +66,9 @@ enum sbs_control_t {
 };
 typedef enum sbs_control_t sbs_control_type;
 struct control_flags_t {
-    bool recenter_screen;
-    bool recalibrate;
+    // set under control_flags_mutex, but taken by the pose path without it
+    atomic_bool recenter_screen;
+    atomic_bool recalibrate;
     bool force_quit;
     sbs_control_type sbs_mode;
     char* request_features;
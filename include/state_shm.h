@@ -0,0 +1,97 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// Binary copy of the driver state file, at state_files_directory/state_shm_filename, for readers that want
+// to poll the state without re-parsing the text file. Everything in it except the heartbeat is only
+// rewritten when one of the fields actually changes, so a reader can keep the last change_counter it saw
+// and skip the copy entirely while it's the same.
+
+// "XRDSTAT\0", little-endian
+#define STATE_SHM_MAGIC 0x0054415453445258ULL
+#define STATE_SHM_VERSION 1
+
+#define STATE_SHM_STRING_LENGTH 64
+#define STATE_SHM_LICENSE_LENGTH 16384
+
+// values of the flags field
+#define STATE_SHM_FLAG_DEVICE_CONNECTED (1u << 0)
+#define STATE_SHM_FLAG_SBS_MODE_SUPPORTED (1u << 1)
+#define STATE_SHM_FLAG_SBS_MODE_ENABLED (1u << 2)
+#define STATE_SHM_FLAG_POSE_HAS_POSITION (1u << 3)
+#define STATE_SHM_FLAG_SMOOTH_FOLLOW_ENABLED (1u << 4)
+#define STATE_SHM_FLAG_GAMESCOPE_RESHADE_IPC_CONNECTED (1u << 5)
+#define STATE_SHM_FLAG_FIRMWARE_UPDATE_RECOMMENDED (1u << 6)
+
+// the license didn't fit in device_license, it's only available from the text file
+#define STATE_SHM_FLAG_DEVICE_LICENSE_TRUNCATED (1u << 7)
+
+// Same values as the text file, strings are nul-terminated and empty when the text file leaves the key out.
+// The device fields (everything but hardware_id and device_license) are only meaningful with
+// STATE_SHM_FLAG_DEVICE_CONNECTED set.
+struct state_shm_data_t {
+    uint32_t flags;
+
+    // calibration_setup_type and calibration_state_type
+    uint32_t calibration_setup;
+    uint32_t calibration_state;
+
+    float connected_device_full_distance_cm;
+    float connected_device_full_size_cm;
+    uint32_t device_license_length;
+
+    char hardware_id[STATE_SHM_STRING_LENGTH];
+    char connected_device_brand[STATE_SHM_STRING_LENGTH];
+    char connected_device_model[STATE_SHM_STRING_LENGTH];
+    char device_license[STATE_SHM_LICENSE_LENGTH];
+};
+
+typedef struct state_shm_data_t state_shm_data_type;
+
+struct state_shm_block_t {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t data_size;
+
+    // Odd while the driver is rewriting data, and advances by two with every change, so change_counter / 2 is
+    // the number of changes since the driver started.
+    _Alignas(64) _Atomic uint64_t change_counter;
+
+    // seconds since the epoch, refreshed every second without touching change_counter, same as the heartbeat
+    // key of the text file
+    _Atomic uint64_t heartbeat;
+
+    _Alignas(64) state_shm_data_type data;
+};
+
+typedef struct state_shm_block_t state_shm_block_type;
+
+extern const char* state_shm_filename;
+
+// a change takes a few microseconds, this only gives up if the driver died partway through one
+#define STATE_SHM_READ_ATTEMPTS 100000
+
+// Copies out the data if it changed since *last_change_counter, and updates that. Returns false if nothing
+// changed, the block has never been written, or no consistent copy could be made (out may have been
+// overwritten then, *last_change_counter isn't). Start with *last_change_counter at 0.
+static inline bool state_shm_read(const state_shm_block_type* block, uint64_t* last_change_counter,
+                                  state_shm_data_type* out) {
+    for (int attempt = 0; attempt < STATE_SHM_READ_ATTEMPTS; attempt++) {
+        uint64_t before = atomic_load_explicit(&block->change_counter, memory_order_acquire);
+        if (before == *last_change_counter || before == 0) return false;
+        if (before & 1) continue;
+
+        memcpy(out, (const void*)&block->data, sizeof(*out));
+
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&block->change_counter, memory_order_relaxed) == before) {
+            *last_change_counter = before;
+            return true;
+        }
+    }
+
+    return false;
+}
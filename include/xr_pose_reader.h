@@ -0,0 +1,253 @@
+#pragma once
+
+// Header-only reader for the driver's pose outputs, for consumers (shaders' host apps, desktop plugins, tools)
+// that want the latest pose, or the pose at a particular time, without reimplementing the shared memory
+// protocol. Only needs this header and pose_shm.h, link with -lm.
+//
+//     xr_pose_reader_type reader;
+//     if (xr_pose_reader_open(&reader)) {
+//         xr_pose_type pose;
+//         if (!xr_pose_reader_is_stale(&reader) &&
+//             xr_pose_reader_pose_at(&reader, vsync_time_ns, &pose)) { ... }
+//         xr_pose_reader_close(&reader);
+//     }
+//
+// Timestamps are CLOCK_MONOTONIC nanoseconds, orientations are x, y, z, w quaternions in the driver's NWU
+// frame. Reads never block and never take a lock, a reader in another process can't stall the driver.
+
+#include "pose_shm.h"
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef XR_POSE_READER_HISTORY_PATH
+#define XR_POSE_READER_HISTORY_PATH "/dev/shm/xr_driver_pose_history"
+#endif
+
+// same threshold the driver uses to decide the IMU has gone quiet
+#define XR_POSE_READER_STALE_NS 1000000000ULL
+
+// how far past the newest pose xr_pose_reader_pose_at will extrapolate, beyond that it holds the newest pose
+#define XR_POSE_READER_MAX_EXTRAPOLATION_NS 100000000ULL
+
+// how often xr_pose_reader_pose_at looks for a history ring while there isn't one, e.g. the driver started
+// keeping one after the reader was opened, or is replacing it after a capacity change
+#define XR_POSE_READER_HISTORY_RETRY_NS 1000000000ULL
+
+struct xr_pose_t {
+    uint64_t timestamp_ns;
+    float orientation[4];
+    float position[3];
+
+    // POSE_SHM_FLAG_* from pose_shm.h
+    uint32_t flags;
+};
+
+typedef struct xr_pose_t xr_pose_type;
+
+struct xr_pose_reader_t {
+    const pose_shm_region_type *region;
+
+    // for pose_shm_wait
+    pose_shm_notify_type *notify;
+
+    // only present if the driver's pose_history_size config is set and /dev/shm is visible to this process
+    pose_history_region_type *history;
+    size_t history_size;
+
+    // while history is NULL, when to look for it again
+    uint64_t history_retry_ns;
+};
+
+typedef struct xr_pose_reader_t xr_pose_reader_type;
+
+static inline uint64_t xr_pose_reader_now_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+// Spherical interpolation from "from" (t = 0) to "to" (t = 1). t outside of [0, 1] extrapolates along the
+// same arc, which is how poses get carried forward in time.
+static inline void xr_pose_quat_slerp(const float from[4], const float to[4], float t, float out[4]) {
+    float dot = from[0] * to[0] + from[1] * to[1] + from[2] * to[2] + from[3] * to[3];
+    float sign = 1.0f;
+    if (dot < 0.0f) {
+        dot = -dot;
+        sign = -1.0f;
+    }
+
+    float from_scale = 1.0f - t;
+    float to_scale = t;
+    if (dot < 0.9995f) {
+        // otherwise too close for the angle to be numerically meaningful, a normalized lerp is indistinguishable
+        float theta = acosf(dot);
+        float sin_theta = sinf(theta);
+        from_scale = sinf((1.0f - t) * theta) / sin_theta;
+        to_scale = sinf(t * theta) / sin_theta;
+    }
+
+    float length_squared = 0.0f;
+    for (int i = 0; i < 4; i++) {
+        out[i] = from_scale * from[i] + sign * to_scale * to[i];
+        length_squared += out[i] * out[i];
+    }
+
+    float inverse_length = length_squared > 0.0f ? 1.0f / sqrtf(length_squared) : 1.0f;
+    for (int i = 0; i < 4; i++) out[i] *= inverse_length;
+}
+
+// the pose at timestamp_ns along the line from a to b, extrapolating if it's outside of them
+static inline void xr_pose_interpolate(uint64_t a_ns, const float a_orientation[4], const float a_position[3],
+                                       uint64_t b_ns, const float b_orientation[4], const float b_position[3],
+                                       uint64_t timestamp_ns, xr_pose_type *out) {
+    float t = b_ns > a_ns ? (float)((double)((int64_t)(timestamp_ns - a_ns)) / (double)(b_ns - a_ns)) : 1.0f;
+
+    out->timestamp_ns = timestamp_ns;
+    xr_pose_quat_slerp(a_orientation, b_orientation, t, out->orientation);
+    for (int i = 0; i < 3; i++) out->position[i] = a_position[i] + (b_position[i] - a_position[i]) * t;
+}
+
+static inline void xr_pose_reader_close_history(xr_pose_reader_type *reader) {
+    if (reader->history) munmap(reader->history, reader->history_size);
+    reader->history = NULL;
+    reader->history_size = 0;
+}
+
+// (re)maps the history ring if the driver is publishing one, quietly does without it otherwise
+static inline void xr_pose_reader_open_history(xr_pose_reader_type *reader) {
+    xr_pose_reader_close_history(reader);
+    reader->history_retry_ns = xr_pose_reader_now_ns() + XR_POSE_READER_HISTORY_RETRY_NS;
+
+    int fd = open(XR_POSE_READER_HISTORY_PATH, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return;
+
+    pose_history_region_type header;
+    if (pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) && header.magic == POSE_HISTORY_MAGIC &&
+        header.version >= POSE_HISTORY_VERSION && header.entry_size == sizeof(pose_history_entry_type) &&
+        header.header_size == offsetof(pose_history_region_type, entries) && header.capacity > 0) {
+        size_t size = header.header_size + (size_t)header.capacity * header.entry_size;
+        void *mapped = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapped != MAP_FAILED) {
+            reader->history = (pose_history_region_type *)mapped;
+            reader->history_size = size;
+        }
+    }
+    close(fd);
+}
+
+// Same place the driver puts it: $XDG_RUNTIME_DIR/xr_driver, or $HOME/tmp/xr_driver if that's not set.
+static inline bool xr_pose_reader_default_socket_path(char *path, size_t path_size) {
+    const char *runtime_dir = getenv("XDG_RUNTIME_DIR");
+    int length;
+    if (runtime_dir) {
+        length = snprintf(path, path_size, "%s/xr_driver/pose_shm.sock", runtime_dir);
+    } else {
+        const char *home = getenv("HOME");
+        if (!home) return false;
+        length = snprintf(path, path_size, "%s/tmp/xr_driver/pose_shm.sock", home);
+    }
+
+    return length > 0 && (size_t)length < path_size;
+}
+
+static inline void xr_pose_reader_close(xr_pose_reader_type *reader) {
+    xr_pose_reader_close_history(reader);
+    if (reader->region) munmap((void *)reader->region, sizeof(pose_shm_region_type));
+    if (reader->notify) munmap(reader->notify, sizeof(pose_shm_notify_type));
+    reader->region = NULL;
+    reader->notify = NULL;
+}
+
+// Maps the driver's pose region (and history ring, if there is one). Returns false if the driver isn't
+// running or publishes an incompatible layout. socket_path may be NULL to use the default location.
+static inline bool xr_pose_reader_open_at(xr_pose_reader_type *reader, const char *socket_path) {
+    memset(reader, 0, sizeof(*reader));
+
+    char default_path[256];
+    if (!socket_path) {
+        if (!xr_pose_reader_default_socket_path(default_path, sizeof(default_path))) return false;
+        socket_path = default_path;
+    }
+
+    // pose_shm_open checks the magic and that the driver's version is at least the one compiled in here
+    reader->region = pose_shm_open(socket_path, &reader->notify);
+    if (!reader->region) return false;
+    if (reader->region->header_size != offsetof(pose_shm_region_type, sample) ||
+        reader->region->sample_size < sizeof(pose_shm_sample_type)) {
+        xr_pose_reader_close(reader);
+        return false;
+    }
+
+    xr_pose_reader_open_history(reader);
+    return true;
+}
+
+static inline bool xr_pose_reader_open(xr_pose_reader_type *reader) {
+    return xr_pose_reader_open_at(reader, NULL);
+}
+
+// the latest published sample, including the driver's own prediction; false if nothing's been published yet
+static inline bool xr_pose_reader_latest(const xr_pose_reader_type *reader, pose_shm_sample_type *out) {
+    return reader->region && pose_shm_read(reader->region, out);
+}
+
+// true if there's no pose or the latest one is older than the driver itself would tolerate
+static inline bool xr_pose_reader_is_stale(const xr_pose_reader_type *reader) {
+    pose_shm_sample_type sample;
+    if (!xr_pose_reader_latest(reader, &sample)) return true;
+
+    return xr_pose_reader_now_ns() - sample.timestamp_ns > XR_POSE_READER_STALE_NS;
+}
+
+// Estimates the pose at timestamp_ns (e.g. a vsync time):
+//  - inside the history ring's window, by interpolating between the two poses around it
+//  - past the newest pose, by extrapolating along the driver's prediction for it (which starts from the
+//    published orientation, so the two are a consistent pair), up to XR_POSE_READER_MAX_EXTRAPOLATION_NS ahead
+//  - otherwise (no history, or older than it reaches) the latest pose as-is
+// Returns false only if there's no pose to go on.
+static inline bool xr_pose_reader_pose_at(xr_pose_reader_type *reader, uint64_t timestamp_ns,
+                                          xr_pose_type *out) {
+    if (reader->history ? atomic_load_explicit(&reader->history->stale, memory_order_acquire)
+                        : xr_pose_reader_now_ns() >= reader->history_retry_ns)
+        xr_pose_reader_open_history(reader);
+
+    if (reader->history) {
+        pose_history_entry_type before, after;
+        if (pose_history_find(reader->history, timestamp_ns, &before, &after)) {
+            xr_pose_interpolate(before.host_timestamp_ns, before.orientation, before.position,
+                                after.host_timestamp_ns, after.orientation, after.position, timestamp_ns, out);
+            out->flags = after.flags;
+            return true;
+        }
+    }
+
+    pose_shm_sample_type sample;
+    if (!xr_pose_reader_latest(reader, &sample)) return false;
+
+    out->timestamp_ns = sample.timestamp_ns;
+    memcpy(out->orientation, sample.orientation, sizeof(out->orientation));
+    memcpy(out->position, sample.position, sizeof(out->position));
+    out->flags = sample.flags;
+
+    if (timestamp_ns > sample.timestamp_ns && sample.predicted_timestamp_ns > sample.timestamp_ns) {
+        uint64_t target_ns = timestamp_ns;
+        if (target_ns - sample.timestamp_ns > XR_POSE_READER_MAX_EXTRAPOLATION_NS)
+            target_ns = sample.timestamp_ns + XR_POSE_READER_MAX_EXTRAPOLATION_NS;
+
+        xr_pose_interpolate(sample.timestamp_ns, sample.orientation, sample.position,
+                            sample.predicted_timestamp_ns, sample.predicted_orientation, sample.predicted_position,
+                            target_ns, out);
+    }
+
+    return true;
+}
@@ -1,4 +1,5 @@
 #include "buffer.h"
+#include "epoch.h"
 #include "logging.h"
 
 #include <stdbool.h>
@@ -50,101 +51,93 @@ float push(buffer_type *buffer, float next_value) {
     return popped_value;
 }
 
+enum imu_buffer_column {
+    IMU_BUFFER_X,
+    IMU_BUFFER_Y,
+    IMU_BUFFER_Z,
+    IMU_BUFFER_W
+};
+
 imu_buffer_type *create_imu_buffer(int buffer_size) {
-    imu_buffer_type *gyro_buffer = calloc(1, sizeof(imu_buffer_type));
-    if (gyro_buffer == NULL) {
+    int capacity = 2 * buffer_size + 1;
+    imu_buffer_type *imu_buffer = calloc(1, sizeof(imu_buffer_type) + capacity * sizeof(uint64_t) +
+                                            IMU_BUFFER_QUAT_COLUMNS * capacity * sizeof(float));
+    if (imu_buffer == NULL) {
+        log_error("Error allocating memory\n");
         return NULL;
     }
-    gyro_buffer->stage_1 = calloc(GYRO_BUFFERS_COUNT, sizeof(buffer_type*));
-    gyro_buffer->stage_2 = calloc(GYRO_BUFFERS_COUNT, sizeof(buffer_type*));
-    for (int i = 0; i < GYRO_BUFFERS_COUNT; i++) {
-        gyro_buffer->stage_1[i] = create_buffer(buffer_size);
-        gyro_buffer->stage_2[i] = create_buffer(buffer_size);
-        if (gyro_buffer->stage_1[i] == NULL || gyro_buffer->stage_2[i] == NULL) {
-            log_error("Error allocating memory\n");
-            return NULL;
-        }
-    }
+    imu_buffer->size = buffer_size;
+    imu_buffer->capacity = capacity;
+    imu_buffer->index = 0;
+    imu_buffer->count = 0;
 
-    return gyro_buffer;
+    return imu_buffer;
 }
 
-void free_imu_buffer(imu_buffer_type *gyro_buffer) {
-    if (gyro_buffer != NULL) {
-        if (gyro_buffer->stage_1 != NULL) {
-            for (int i = 0; i < GYRO_BUFFERS_COUNT; i++) {
-                free_buffer(gyro_buffer->stage_1[i]);
-            }
-            free(gyro_buffer->stage_1);
-            gyro_buffer->stage_1 = NULL;
-        }
-        if (gyro_buffer->stage_2 != NULL) {
-            for (int i = 0; i < GYRO_BUFFERS_COUNT; i++) {
-                free_buffer(gyro_buffer->stage_2[i]);
-            }
-            free(gyro_buffer->stage_2);
-            gyro_buffer->stage_2 = NULL;
-        }
-        free(gyro_buffer);
-    }
+void free_imu_buffer(imu_buffer_type *imu_buffer) {
+    free(imu_buffer);
 }
 
-int imu_buffer_size(imu_buffer_type *gyro_buffer) {
-    if (gyro_buffer != NULL && gyro_buffer->stage_1 != NULL && gyro_buffer->stage_1[0] != NULL) {
-        return gyro_buffer->stage_1[0]->size;
-    }
-    return 0;
+int imu_buffer_size(imu_buffer_type *imu_buffer) {
+    return imu_buffer != NULL ? imu_buffer->size : 0;
 }
 
-imu_buffer_response_type *push_to_imu_buffer(imu_buffer_type *gyro_buffer, imu_quat_type quat, float timestamp_ms) {
-    imu_buffer_response_type *response = calloc(1, sizeof(imu_buffer_response_type));
-    if (response == NULL) {
-        return NULL;
-    }
-    response->ready = false;
-
-    // the oldest values are zero/unset if the buffer hasn't been filled yet, so we check prior to doing a
-    // push/pop, to know if the values that are returned will be relevant to our calculations
-    bool was_full = is_full(gyro_buffer->stage_1[0]);
-    float stage_1_quat_w = push(gyro_buffer->stage_1[0], quat.w);
-    float stage_1_quat_x = push(gyro_buffer->stage_1[1], quat.x);
-    float stage_1_quat_y = push(gyro_buffer->stage_1[2], quat.y);
-    float stage_1_quat_z = push(gyro_buffer->stage_1[3], quat.z);
-
-    // TODO - timestamp_ms can only get as large as 2^24 before it starts to lose precision as a float,
-    //        which is less than 5 hours of usage. Update this to just send two delta times, t0-t1 and t1-t2.
-    float stage_1_ts = push(gyro_buffer->stage_1[4], (float)timestamp_ms);
-
-    if (was_full) {
-        was_full = is_full(gyro_buffer->stage_2[0]);
-        float stage_2_quat_w = push(gyro_buffer->stage_2[0], stage_1_quat_w);
-        float stage_2_quat_x = push(gyro_buffer->stage_2[1], stage_1_quat_x);
-        float stage_2_quat_y = push(gyro_buffer->stage_2[2], stage_1_quat_y);
-        float stage_2_quat_z = push(gyro_buffer->stage_2[3], stage_1_quat_z);
-        float stage_2_ts = push(gyro_buffer->stage_2[4], stage_1_ts);
-
-        if (was_full) {
-            response->ready = true;
-            response->data = calloc(16, sizeof(float));
-
-            // write to shared memory for anyone using the same ipc prefix to consume
-            response->data[0] = quat.x;
-            response->data[1] = quat.y;
-            response->data[2] = quat.z;
-            response->data[3] = quat.w;
-            response->data[4] = stage_1_quat_x;
-            response->data[5] = stage_1_quat_y;
-            response->data[6] = stage_1_quat_z;
-            response->data[7] = stage_1_quat_w;
-            response->data[8] = stage_2_quat_x;
-            response->data[9] = stage_2_quat_y;
-            response->data[10] = stage_2_quat_z;
-            response->data[11] = stage_2_quat_w;
-            response->data[12] = (float)timestamp_ms;
-            response->data[13] = stage_1_ts;
-            response->data[14] = stage_2_ts;
-        }
-    }
+static inline float *imu_buffer_column(imu_buffer_type *imu_buffer, enum imu_buffer_column column) {
+    float *values = (float *)&imu_buffer->timestamps_ns[imu_buffer->capacity];
+    return &values[column * imu_buffer->capacity];
+}
+
+// index of the sample written stages_back * size pushes before the newest one
+static inline int imu_buffer_look_back(imu_buffer_type *imu_buffer, int newest, int stages_back) {
+    int index = newest - stages_back * imu_buffer->size;
+    return index < 0 ? index + imu_buffer->capacity : index;
+}
+
+// milliseconds from the newest sample back to an older one, as a (non-positive) float
+static inline float imu_buffer_ms_before(uint64_t newest_ns, uint64_t older_ns) {
+    return -(float)(newest_ns - older_ns) / NS_PER_MS;
+}
 
-    return response;
+bool push_to_imu_buffer(imu_buffer_type *imu_buffer, imu_quat_type quat, uint64_t timestamp_ns,
+                        float out_data[IMU_BUFFER_PAYLOAD_SIZE]) {
+    float *x = imu_buffer_column(imu_buffer, IMU_BUFFER_X);
+    float *y = imu_buffer_column(imu_buffer, IMU_BUFFER_Y);
+    float *z = imu_buffer_column(imu_buffer, IMU_BUFFER_Z);
+    float *w = imu_buffer_column(imu_buffer, IMU_BUFFER_W);
+    uint64_t *ts = imu_buffer->timestamps_ns;
+
+    int newest = imu_buffer->index;
+    x[newest] = quat.x;
+    y[newest] = quat.y;
+    z[newest] = quat.z;
+    w[newest] = quat.w;
+    ts[newest] = timestamp_ns;
+
+    imu_buffer->index = newest + 1 == imu_buffer->capacity ? 0 : newest + 1;
+    if (imu_buffer->count < imu_buffer->capacity) imu_buffer->count++;
+
+    // the look-back values are unset until the ring has been filled once
+    if (imu_buffer->count < imu_buffer->capacity) return false;
+
+    int stage_1 = imu_buffer_look_back(imu_buffer, newest, 1);
+    int stage_2 = imu_buffer_look_back(imu_buffer, newest, 2);
+
+    out_data[0] = x[newest];
+    out_data[1] = y[newest];
+    out_data[2] = z[newest];
+    out_data[3] = w[newest];
+    out_data[4] = x[stage_1];
+    out_data[5] = y[stage_1];
+    out_data[6] = z[stage_1];
+    out_data[7] = w[stage_1];
+    out_data[8] = x[stage_2];
+    out_data[9] = y[stage_2];
+    out_data[10] = z[stage_2];
+    out_data[11] = w[stage_2];
+    out_data[12] = 0.0f;
+    out_data[13] = imu_buffer_ms_before(ts[newest], ts[stage_1]);
+    out_data[14] = imu_buffer_ms_before(ts[newest], ts[stage_2]);
+    out_data[15] = 0.0f;
+
+    return true;
 }
\ No newline at end of file
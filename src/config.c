@@ -35,6 +35,7 @@ driver_config_type *default_config() {
     config->multi_tap_enabled = false;
     config->metrics_disabled = false;
     config->dead_zone_threshold_deg = 0.0f;
+    config->pose_history_size = 0;
 
     config->debug_threads = false;
     config->debug_joystick = false;
@@ -43,14 +44,16 @@ driver_config_type *default_config() {
     config->debug_license = false;
     config->debug_device = false;
     config->debug_connections = false;
+    config->debug_latency = false;
 
     return config;
 }
 
-void update_config(driver_config_type *config, driver_config_type *new_config) {
+void free_config(driver_config_type *config) {
+    if (config == NULL) return;
+
     free(config->output_mode);
-    *config = *new_config;
-    free(new_config);
+    free(config);
 }
 
 void boolean_config(char* key, char *value, bool *config_value) {
@@ -118,6 +121,9 @@ driver_config_type* parse_config_file(FILE *fp) {
                 if (equal(token, "connections")) {
                     config->debug_connections = true;
                 }
+                if (equal(token, "latency")) {
+                    config->debug_latency = true;
+                }
                 token = strtok(NULL, ",");
             }
         } else if (equal(key, "use_roll_axis")) {
@@ -145,6 +151,8 @@ driver_config_type* parse_config_file(FILE *fp) {
             boolean_config(key, value, &config->metrics_disabled);
         } else if (equal(key, "dead_zone_threshold_deg")) {
             float_config(key, value, &config->dead_zone_threshold_deg);
+        } else if (equal(key, "pose_history_size")) {
+            int_config(key, value, &config->pose_history_size);
         }
 
         plugins.handle_config_line(plugin_configs, key, value);
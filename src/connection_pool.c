@@ -1,15 +1,39 @@
 #include "connection_pool.h"
+#include "epoch.h"
+#include "hazard_pointer.h"
 #include "logging.h"
+#include "pose_ring.h"
+#include "pose_stats.h"
 #include "runtime_context.h"
 #include "imu.h"
 
+#include <linux/futex.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 static connection_pool_type* pool = NULL;
 
+// Immutable view of the active connections, republished under the pool mutex whenever the selection
+// changes. The per-sample path reads it under a hazard pointer instead of taking the mutex, and a removed
+// connection is only freed once no reader can still see it through an old snapshot.
+struct connection_pool_snapshot_t {
+    connection_t* primary;
+    connection_t* supplemental;
+    const device_driver_type* primary_driver;
+    const device_driver_type* supplemental_driver;
+    const char* primary_id;
+    const char* supplemental_id;
+};
+
+typedef struct connection_pool_snapshot_t connection_pool_snapshot_type;
+
+static connection_pool_snapshot_type * _Atomic active_snapshot = NULL;
+
 static void ensure_capacity() {
     if (pool->count >= pool->capacity) {
         int newcap = pool->capacity == 0 ? 2 : pool->capacity + 1;
@@ -20,6 +44,8 @@ static void ensure_capacity() {
 
 static pose_handler_t pose_handler = NULL;
 static reference_pose_getter_t reference_pose_getter = NULL;
+static void* pose_pipeline_thread_func(void* arg);
+static pthread_t pose_pipeline_thread;
 void connection_pool_init(pose_handler_t pose_handler_callback, reference_pose_getter_t reference_pose_getter_callback) {
     pool = (connection_pool_type*)calloc(1, sizeof(*pool));
     pthread_mutex_init(&pool->mutex, NULL);
@@ -27,6 +53,10 @@ void connection_pool_init(pose_handler_t pose_handler_callback, reference_pose_g
     pool->supplemental_index = -1;
     pose_handler = pose_handler_callback;
     reference_pose_getter = reference_pose_getter_callback;
+    atomic_store(&active_snapshot, calloc(1, sizeof(connection_pool_snapshot_type)));
+
+    pthread_create(&pose_pipeline_thread, NULL, pose_pipeline_thread_func, NULL);
+    pthread_detach(pose_pipeline_thread);
 }
 
 static int pick_primary_index() {
@@ -75,6 +105,39 @@ static connection_t* supplemental() {
     return pool->list[pool->supplemental_index];
 }
 
+// The pool mutex must already be held. Returns the replaced snapshot, which the caller must pass to
+// retire_snapshot after releasing the mutex.
+static connection_pool_snapshot_type* publish_snapshot_locked() {
+    connection_pool_snapshot_type* snapshot = calloc(1, sizeof(*snapshot));
+    connection_t* p = primary();
+    connection_t* s = supplemental();
+    if (p) {
+        snapshot->primary = p;
+        snapshot->primary_driver = p->driver;
+        snapshot->primary_id = p->driver->id;
+    }
+    if (s) {
+        snapshot->supplemental = s;
+        snapshot->supplemental_driver = s->driver;
+        snapshot->supplemental_id = s->driver->id;
+    }
+
+    return atomic_exchange_explicit(&active_snapshot, snapshot, memory_order_acq_rel);
+}
+
+static void retire_snapshot(connection_pool_snapshot_type* snapshot) {
+    hazard_pointer_wait_for_readers(snapshot);
+    free(snapshot);
+}
+
+static connection_pool_snapshot_type* protect_snapshot() {
+    return hazard_pointer_protect(HAZARD_SLOT_CONNECTION_POOL, (void * _Atomic *)&active_snapshot);
+}
+
+static void release_snapshot() {
+    hazard_pointer_clear(HAZARD_SLOT_CONNECTION_POOL);
+}
+
 static void* block_thread_func(void* arg) {
     connection_t* c = (connection_t*)arg;
     if (config()->debug_connections) log_debug("block_thread_func %s\n", c->driver->id);
@@ -92,10 +155,9 @@ static void connection_pool_start_connection_thread(connection_t* c) {
 }
 
 bool connection_pool_is_connected() {
-    pthread_mutex_lock(&pool->mutex);
-    connection_t* p = primary();
-    bool connected = p && p->driver->is_connected_func();
-    pthread_mutex_unlock(&pool->mutex);
+    connection_pool_snapshot_type* snapshot = protect_snapshot();
+    bool connected = snapshot->primary_driver && snapshot->primary_driver->is_connected_func();
+    release_snapshot();
     return connected;
 }
 
@@ -217,6 +279,7 @@ void connection_pool_handle_device_added(const device_driver_type* driver, devic
     c->device = device;
     c->supplemental = device->can_be_supplemental;
     c->active = false;
+    c->pose_ring = pose_ring_create();
     pool->list[pool->count++] = c;
 
     // If no primary selected yet, pick one
@@ -245,7 +308,10 @@ void connection_pool_handle_device_added(const device_driver_type* driver, devic
         }
     }
 
+    connection_pool_snapshot_type* old_snapshot = publish_snapshot_locked();
     pthread_mutex_unlock(&pool->mutex);
+
+    retire_snapshot(old_snapshot);
 }
 
 void connection_pool_handle_device_removed(const char* driver_id) {
@@ -258,10 +324,11 @@ void connection_pool_handle_device_removed(const char* driver_id) {
     bool primary_removed = false;
     bool supplemental_removed = pool->supplemental_index == -1;
 
+    connection_t* removed = NULL;
     int remove_index = find_driver_connection_index_locked(driver_id);
     if (remove_index >= 0) {
         connection_t* c = pool->list[remove_index];
-        
+
         // Request a hard disconnect; the driver threads will exit on their own.
         c->driver->disconnect_func(false);
 
@@ -280,10 +347,10 @@ void connection_pool_handle_device_removed(const char* driver_id) {
     }
 
     if (remove_index >= 0) {
-        connection_t* c = pool->list[remove_index];
-        free(c);
+        removed = pool->list[remove_index];
 
-        // Remove from array and free the connection wrapper (device is managed externally)
+        // Remove from array, the connection wrapper is freed once it's no longer in any snapshot (device is
+        // managed externally)
         for (int j = remove_index + 1; j < pool->count; ++j) pool->list[j - 1] = pool->list[j];
         pool->count--;
 
@@ -301,46 +368,83 @@ void connection_pool_handle_device_removed(const char* driver_id) {
         if (config()->debug_connections) log_debug("connection_pool_handle_device_removed picked supplemental %d\n", pool->supplemental_index);
     }
 
+    connection_pool_snapshot_type* old_snapshot = publish_snapshot_locked();
     pthread_mutex_unlock(&pool->mutex);
+
+    retire_snapshot(old_snapshot);
+    if (removed) {
+        pose_ring_free(removed->pose_ring);
+        free(removed);
+    }
+}
+
+// Bumped by device threads after every push; also the futex word the pose pipeline thread sleeps on.
+static atomic_uint pose_pipeline_seq = ATOMIC_VAR_INIT(0);
+static atomic_bool pose_pipeline_waiting = ATOMIC_VAR_INIT(false);
+
+// Both sides use sequentially consistent operations on these two atomics: either the device thread sees
+// the pipeline waiting and wakes it, or the pipeline sees the bumped sequence and doesn't go to sleep.
+static void wake_pose_pipeline() {
+    atomic_fetch_add(&pose_pipeline_seq, 1);
+    if (atomic_load(&pose_pipeline_waiting))
+        syscall(SYS_futex, (uint32_t*)&pose_pipeline_seq, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+static void wait_for_pose_pipeline_seq(unsigned int seen_seq) {
+    atomic_store(&pose_pipeline_waiting, true);
+    if (atomic_load(&pose_pipeline_seq) == seen_seq)
+        syscall(SYS_futex, (uint32_t*)&pose_pipeline_seq, FUTEX_WAIT_PRIVATE, seen_seq, NULL, NULL, 0);
+    atomic_store(&pose_pipeline_waiting, false);
 }
 
 void connection_pool_ingest_pose(const char* driver_id, imu_pose_type pose) {
-    connection_t* s = supplemental();
-    if (s) {
-        bool pose_from_supplemental = strcmp(s->driver->id, driver_id) == 0;
-        if (pose_from_supplemental) {
-            // don't forward supplemental poses directly,
-            // store the latest one to be forwarded with the next primary pose
-            if (pose.has_position) {
-                static imu_quat_type reference_supplemental_orientation_conj = {0, 0, 0, 1};
-                // reorient supplemental position into primary reference frame
-                imu_pose_type reference_pose = {0};
-                bool reference_pose_updated = false;
-                supplemental_position_ready = reference_pose_getter(&reference_pose, &reference_pose_updated);
-
-                // when we receive a new reference pose, also capture the supplemental orientation
-                // so we can properly adjust the reference frame
-                if (pose.has_orientation && reference_pose_updated) 
-                    reference_supplemental_orientation_conj = conjugate(pose.orientation);
-                    
-                if (supplemental_position_ready) {
-                    if (pose.has_orientation) {
-                        reference_pose.orientation = multiply_quaternions(reference_supplemental_orientation_conj, reference_pose.orientation);
-                    }
-                    pose.position = vector_rotate(pose.position, reference_pose.orientation);
-                }
+    uint64_t ingest_start_ns = get_monotonic_time_ns();
+
+    connection_pool_snapshot_type* snapshot = protect_snapshot();
+    connection_t* c = snapshot->supplemental;
+    if (!c || strcmp(snapshot->supplemental_id, driver_id) != 0) c = snapshot->primary;
+    if (c) pose_ring_push(c->pose_ring, &pose);
+    release_snapshot();
+
+    if (c) wake_pose_pipeline();
+
+    pose_stats_record(POSE_STATS_INGEST, get_monotonic_time_ns() - ingest_start_ns);
+}
+
+static void process_supplemental_pose(imu_pose_type pose) {
+    // don't forward supplemental poses directly,
+    // store the latest one to be forwarded with the next primary pose
+    if (pose.has_position) {
+        static imu_quat_type reference_supplemental_orientation_conj = {0, 0, 0, 1};
+        // reorient supplemental position into primary reference frame
+        imu_pose_type reference_pose = {0};
+        bool reference_pose_updated = false;
+        supplemental_position_ready = reference_pose_getter(&reference_pose, &reference_pose_updated);
+
+        // when we receive a new reference pose, also capture the supplemental orientation
+        // so we can properly adjust the reference frame
+        if (pose.has_orientation && reference_pose_updated) 
+            reference_supplemental_orientation_conj = conjugate(pose.orientation);
+            
+        if (supplemental_position_ready) {
+            if (pose.has_orientation) {
+                reference_pose.orientation = multiply_quaternions(reference_supplemental_orientation_conj, reference_pose.orientation);
             }
-            last_supplemental_pose = pose;
-            return;
+            pose.position = vector_rotate(pose.position, reference_pose.orientation);
         }
     }
+    last_supplemental_pose = pose;
+}
+
+static void process_primary_pose(imu_pose_type pose, bool has_supplemental) {
+    pose_stats_record(POSE_STATS_PIPELINE_WAIT, get_monotonic_time_ns() - pose.timestamp_ns);
 
     // use the data from the supplemental pose to fill in any gaps in the primary pose
-    if (!pose.has_orientation && s && last_supplemental_pose.has_orientation) {
+    if (!pose.has_orientation && has_supplemental && last_supplemental_pose.has_orientation) {
         pose.orientation = last_supplemental_pose.orientation;
         pose.has_orientation = true;
     }
-    if (!pose.has_position && s && last_supplemental_pose.has_position && supplemental_position_ready) {
+    if (!pose.has_position && has_supplemental && last_supplemental_pose.has_position && supplemental_position_ready) {
         pose.position = last_supplemental_pose.position;
         pose.has_position = true;
     }
@@ -348,6 +452,53 @@ void connection_pool_ingest_pose(const char* driver_id, imu_pose_type pose) {
     pose_handler(pose);
 }
 
+// Runs the pose handler (fusion and plugin pipeline) off of the device threads, so a slow plugin can never
+// stall a device driver's callback. Each pass drains both active rings, supplemental first so the primary
+// poses pick up the freshest supplemental data.
+static void* pose_pipeline_thread_func(void* arg) {
+    (void)arg;
+
+    imu_pose_type supplemental_poses[POSE_RING_CAPACITY];
+    imu_pose_type primary_poses[POSE_RING_CAPACITY];
+    uint64_t logged_overruns = 0;
+
+    while (true) {
+        unsigned int seen_seq = atomic_load(&pose_pipeline_seq);
+        int supplemental_count = 0;
+        int primary_count = 0;
+        uint64_t overruns = 0;
+
+        // the pose handler calls back into the pool, so only hold onto the snapshot while popping
+        connection_pool_snapshot_type* snapshot = protect_snapshot();
+        connection_t* p = snapshot->primary;
+        connection_t* s = snapshot->supplemental;
+        if (s) {
+            while (supplemental_count < POSE_RING_CAPACITY &&
+                   pose_ring_pop(s->pose_ring, &supplemental_poses[supplemental_count])) supplemental_count++;
+            overruns += pose_ring_overruns(s->pose_ring);
+        }
+        if (p) {
+            while (primary_count < POSE_RING_CAPACITY &&
+                   pose_ring_pop(p->pose_ring, &primary_poses[primary_count])) primary_count++;
+            overruns += pose_ring_overruns(p->pose_ring);
+        }
+        release_snapshot();
+
+        if (overruns != logged_overruns) {
+            if (overruns > logged_overruns && config()->debug_connections)
+                log_debug("pose pipeline fell behind, %llu poses dropped in total\n", (unsigned long long)overruns);
+            logged_overruns = overruns;
+        }
+
+        for (int i = 0; i < supplemental_count; i++) process_supplemental_pose(supplemental_poses[i]);
+        for (int i = 0; i < primary_count; i++) process_primary_pose(primary_poses[i], s != NULL);
+
+        if (supplemental_count == 0 && primary_count == 0) wait_for_pose_pipeline_seq(seen_seq);
+    }
+
+    return NULL;
+}
+
 connection_t* connection_pool_find_hid_connection(uint16_t id_vendor, int16_t id_product) {
     if (config()->debug_connections) log_debug("connection_pool_find_hid_connection for vendor %d product %d\n", id_vendor, id_product);
     pthread_mutex_lock(&pool->mutex);
@@ -0,0 +1,235 @@
+#include "control_socket.h"
+#include "epoch.h"
+#include "files.h"
+#include "logging.h"
+#include "memory.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+const char* control_socket_filename = "control.sock";
+
+#define COMMAND_COUNT (CONTROL_COMMAND_FORCE_QUIT + 1)
+
+// one bit per command, set while some client is waiting on control_socket_acknowledge for it, so the pose path
+// can skip everything else in the usual case of there being nobody
+static atomic_uint awaiting_commands = 0;
+
+// Bumped by every acknowledgement, a waiting client is answered once it's moved past the value from when its
+// request was handled. The timestamp is written before the bump and read after it, and the awaiting bit is
+// cleared before both, so a request whose bit is set again in between is still either answered by this bump
+// or left waiting for the next one.
+static _Atomic uint64_t acknowledgements[COMMAND_COUNT];
+static _Atomic uint64_t applied_timestamps[COMMAND_COUNT];
+
+static int ack_eventfd = -1;
+static int listen_fd = -1;
+static control_command_handler command_handler = NULL;
+static pthread_t control_thread;
+
+struct control_connection_t {
+    int fd;
+
+    // the request waiting on an acknowledgement, if deadline_ns isn't 0; the client's later requests stay
+    // queued in the socket until it's answered, so responses go out in order
+    control_request_type pending;
+    uint64_t pending_acknowledgements;
+    uint64_t deadline_ns;
+};
+
+void control_socket_acknowledge(control_command_type command, uint64_t applied_timestamp_ns) {
+    if (command >= COMMAND_COUNT) return;
+
+    unsigned int bit = 1u << command;
+    if (!(atomic_load_explicit(&awaiting_commands, memory_order_relaxed) & bit)) return;
+
+    atomic_fetch_and_explicit(&awaiting_commands, ~bit, memory_order_relaxed);
+    atomic_store_explicit(&applied_timestamps[command], applied_timestamp_ns, memory_order_relaxed);
+    atomic_fetch_add_explicit(&acknowledgements[command], 1, memory_order_release);
+
+    // non-blocking, a full counter still wakes the control thread
+    uint64_t one = 1;
+    if (write(ack_eventfd, &one, sizeof(one)) == -1 && errno != EAGAIN)
+        log_debug("Control socket: eventfd write failed: %s\n", strerror(errno));
+}
+
+static void send_response(int fd, const control_request_type* request, uint32_t status,
+                          uint64_t applied_timestamp_ns) {
+    control_response_type response = {
+        .version = CONTROL_SOCKET_PROTOCOL_VERSION,
+        .request_id = request->request_id,
+        .status = status,
+        .applied_timestamp_ns = applied_timestamp_ns
+    };
+    if (send(fd, &response, sizeof(response), MSG_DONTWAIT | MSG_NOSIGNAL) == -1)
+        log_debug("Control socket: could not reply to client: %s\n", strerror(errno));
+}
+
+// returns false if the client has gone away
+static bool handle_request(struct control_connection_t* connection) {
+    control_request_type request = {0};
+    ssize_t bytes = recv(connection->fd, &request, sizeof(request), MSG_DONTWAIT);
+    if (bytes == 0) return false;
+    if (bytes == -1) return errno == EAGAIN || errno == EINTR;
+
+    if (bytes != sizeof(request)) {
+        send_response(connection->fd, &request, CONTROL_STATUS_INVALID_REQUEST, 0);
+        return true;
+    }
+    if (request.version != CONTROL_SOCKET_PROTOCOL_VERSION) {
+        send_response(connection->fd, &request, CONTROL_STATUS_UNSUPPORTED_VERSION, 0);
+        return true;
+    }
+    if (request.command == 0 || request.command >= COMMAND_COUNT) {
+        send_response(connection->fd, &request, CONTROL_STATUS_INVALID_REQUEST, 0);
+        return true;
+    }
+
+    // Taken before the handler runs, so an acknowledgement for someone else's identical request that lands in
+    // between answers this one too. Both were in flight at the same time, that's indistinguishable from this
+    // one being applied.
+    uint64_t seen_acknowledgements = atomic_load_explicit(&acknowledgements[request.command], memory_order_acquire);
+    atomic_fetch_or_explicit(&awaiting_commands, 1u << request.command, memory_order_relaxed);
+
+    control_status_type status = command_handler((control_command_type)request.command, request.value);
+    if (status != CONTROL_STATUS_ACCEPTED) {
+        send_response(connection->fd, &request, status, status == CONTROL_STATUS_OK ? get_monotonic_time_ns() : 0);
+        return true;
+    }
+
+    connection->pending = request;
+    connection->pending_acknowledgements = seen_acknowledgements;
+    connection->deadline_ns = get_monotonic_time_ns() + (uint64_t)CONTROL_SOCKET_ACK_TIMEOUT_MS * 1000000ULL;
+    return true;
+}
+
+// answers the connection's pending request if it's been acknowledged or timed out
+static void check_pending(struct control_connection_t* connection, uint64_t now_ns) {
+    if (!connection->deadline_ns) return;
+
+    uint32_t command = connection->pending.command;
+    if (atomic_load_explicit(&acknowledgements[command], memory_order_acquire) !=
+            connection->pending_acknowledgements) {
+        send_response(connection->fd, &connection->pending, CONTROL_STATUS_OK,
+                      atomic_load_explicit(&applied_timestamps[command], memory_order_relaxed));
+    } else if (now_ns >= connection->deadline_ns) {
+        send_response(connection->fd, &connection->pending, CONTROL_STATUS_ACCEPTED, 0);
+    } else {
+        return;
+    }
+
+    connection->deadline_ns = 0;
+}
+
+static void* control_thread_func(void* arg) {
+    (void)arg;
+
+    struct control_connection_t connections[CONTROL_SOCKET_MAX_CLIENTS];
+    int connection_count = 0;
+    struct pollfd poll_fds[CONTROL_SOCKET_MAX_CLIENTS + 2];
+
+    while (true) {
+        uint64_t now_ns = get_monotonic_time_ns();
+        uint64_t next_deadline_ns = 0;
+        for (int i = 0; i < connection_count; i++) {
+            check_pending(&connections[i], now_ns);
+            if (connections[i].deadline_ns &&
+                (!next_deadline_ns || connections[i].deadline_ns < next_deadline_ns))
+                next_deadline_ns = connections[i].deadline_ns;
+        }
+
+        poll_fds[0] = (struct pollfd){ .fd = listen_fd,
+                                       .events = connection_count < CONTROL_SOCKET_MAX_CLIENTS ? POLLIN : 0 };
+        poll_fds[1] = (struct pollfd){ .fd = ack_eventfd, .events = POLLIN };
+        for (int i = 0; i < connection_count; i++) {
+            // a client waiting on an answer still gets checked for hangups, but its next request waits
+            poll_fds[i + 2] = (struct pollfd){ .fd = connections[i].fd,
+                                               .events = connections[i].deadline_ns ? 0 : POLLIN };
+        }
+
+        int timeout_ms = -1;
+        if (next_deadline_ns) timeout_ms = (int)((next_deadline_ns - now_ns + 999999) / 1000000);
+        if (poll(poll_fds, connection_count + 2, timeout_ms) == -1) {
+            if (errno == EINTR) continue;
+
+            log_error("Control socket: poll failed, no longer accepting requests: %s\n", strerror(errno));
+            break;
+        }
+
+        if (poll_fds[1].revents & POLLIN) {
+            uint64_t count;
+            if (read(ack_eventfd, &count, sizeof(count)) == -1 && errno != EAGAIN)
+                log_debug("Control socket: eventfd read failed: %s\n", strerror(errno));
+        }
+
+        // walk backwards so removing a connection doesn't disturb the ones not visited yet
+        for (int i = connection_count - 1; i >= 0; i--) {
+            short revents = poll_fds[i + 2].revents;
+            if (!revents) continue;
+
+            struct control_connection_t* connection = &connections[i];
+            // a client can send a request and hang up straight away, so read before checking for a hangup
+            bool keep;
+            if (revents & POLLIN) keep = handle_request(connection);
+            else keep = !(revents & (POLLHUP | POLLERR));
+
+            if (!keep) {
+                close(connection->fd);
+                connections[i] = connections[--connection_count];
+            }
+        }
+
+        if (poll_fds[0].revents & POLLIN) {
+            int fd = accept(listen_fd, NULL, NULL);
+            if (fd == -1) {
+                if (errno != EAGAIN && errno != EINTR)
+                    log_error("Control socket: accept failed: %s\n", strerror(errno));
+            } else {
+                fcntl(fd, F_SETFD, FD_CLOEXEC);
+                connections[connection_count++] = (struct control_connection_t){ .fd = fd };
+            }
+        }
+    }
+
+    for (int i = 0; i < connection_count; i++) close(connections[i].fd);
+    close(listen_fd);
+    listen_fd = -1;
+
+    return NULL;
+}
+
+void control_socket_init(control_command_handler handler) {
+    if (listen_fd != -1) return;
+
+    ack_eventfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (ack_eventfd == -1) {
+        log_error("Could not create control socket eventfd: %s\n", strerror(errno));
+        return;
+    }
+
+    char* path = NULL;
+    int fd = listen_on_runtime_socket(control_socket_filename, SOCK_SEQPACKET, CONTROL_SOCKET_MAX_CLIENTS, &path);
+    if (fd == -1) {
+        log_error("Could not listen on control socket %s: %s\n", path, strerror(errno));
+        free_and_clear(&path);
+        close(ack_eventfd);
+        ack_eventfd = -1;
+        return;
+    }
+    free_and_clear(&path);
+
+    command_handler = handler;
+    listen_fd = fd;
+
+    pthread_create(&control_thread, NULL, control_thread_func, NULL);
+    pthread_detach(control_thread);
+}
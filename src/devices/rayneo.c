@@ -2,6 +2,7 @@
 #include "devices/rayneo.h"
 #include "connection_pool.h"
 #include "driver.h"
+#include "epoch.h"
 #include "imu.h"
 #include "logging.h"
 #include "memory.h"
@@ -137,7 +138,6 @@ static bool is_sbs_mode = false;
 void rayneo_imu_callback(const float acc[3], const float gyro[3], const float mag[3], uint64_t timestamp){
     if (!soft_connected || driver_disabled()) return;
 
-    uint32_t ts = (uint32_t) (timestamp / TS_TO_MS_FACTOR);
     float rotation[4];
     float position[3];
     uint64_t time;
@@ -147,7 +147,8 @@ void rayneo_imu_callback(const float acc[3], const float gyro[3], const float ma
     imu_pose_type pose = (imu_pose_type){0};
     pose.orientation = quaternion_eus_to_nwu(imu_quat);
     pose.has_orientation = true;
-    pose.timestamp_ms = ts;
+    pose.timestamp_ns = get_monotonic_time_ns();
+    pose.device_timestamp_ns = timestamp;
     connection_pool_ingest_pose(RAYNEO_DRIVER_ID, pose);
 }
 
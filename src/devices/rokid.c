@@ -1,6 +1,7 @@
 #include "devices.h"
 #include "driver.h"
 #include "connection_pool.h"
+#include "epoch.h"
 #include "imu.h"
 #include "logging.h"
 #include "outputs.h"
@@ -17,7 +18,6 @@
 #include <stdlib.h>
 #include <string.h>
 
-#define TS_TO_MS_FACTOR 1000000
 #define ROKID_ID_PRODUCT_COUNT 7
 const int rokid_supported_id_product[ROKID_ID_PRODUCT_COUNT] = {
     0x162B, 0x162C, 0x162D, 0x162E, 0x162F, 0x2002, 0x2180
@@ -184,7 +184,6 @@ void rokid_block_on_device() {
         while (soft_connected) {
             if (GlassWaitEvent(event_instance, event_handle, &ed, 1000)) {
                 struct SensorData sd = ed.acc;
-                uint32_t timestamp = (uint32_t) (sd.sensor_timestamp_ns / TS_TO_MS_FACTOR);
                 struct RotationData rd = ed.rotation;
                 imu_quat_type imu_quat = {
                     .w = rd.Q[3],
@@ -204,7 +203,8 @@ void rokid_block_on_device() {
                 imu_pose_type pose = (imu_pose_type){0};
                 pose.orientation = quaternion_eus_to_nwu(imu_quat);
                 pose.has_orientation = true;
-                pose.timestamp_ms = timestamp;
+                pose.timestamp_ns = get_monotonic_time_ns();
+                pose.device_timestamp_ns = sd.sensor_timestamp_ns;
                 connection_pool_ingest_pose(ROKID_DRIVER_ID, pose);
             }
         }
@@ -38,8 +38,6 @@
 #define VITURE_IMU_FREQUENCY_DEFAULT VITURE_IMU_FREQUENCY_MEDIUM_HIGH
 #define VITURE_CARINA_CYCLES_PER_S 1000
 #define VITURE_CARINA_POLL_INTERVAL_US (1000000 / VITURE_CARINA_CYCLES_PER_S)
-#define VITURE_FLOAT_EXACT_MS_LIMIT 16777216.0 // 2^24, largest consecutive int in float
-#define VITURE_FLOAT_RESET_MARGIN_MS 1000.0 // avoid running right at the precision edge
 
 #define VITURE_LOG_LEVEL_NONE 0
 #define VITURE_LOG_LEVEL_ERROR 1
@@ -461,8 +459,9 @@ static void viture_restore_display_mode_locked() {
     viture_saved_display_size = -1;
 }
 
+// device_timestamp_ns is 0 for the SDK pose callbacks, their timestamp units aren't documented
 static void viture_publish_pose(imu_quat_type orientation, bool has_position,
-                                imu_vec3_type position, uint32_t timestamp_ms) {
+                                imu_vec3_type position, uint64_t device_timestamp_ns) {
     if (driver_disabled()) return;
 
     imu_pose_type pose = {0};
@@ -470,7 +469,8 @@ static void viture_publish_pose(imu_quat_type orientation, bool has_position,
     pose.position = has_position ? position : (imu_vec3_type){0};
     pose.has_orientation = true;
     pose.has_position = has_position;
-    pose.timestamp_ms = timestamp_ms;
+    pose.timestamp_ns = get_monotonic_time_ns();
+    pose.device_timestamp_ns = device_timestamp_ns;
     connection_pool_ingest_pose(VITURE_DRIVER_ID, pose);
 }
 
@@ -480,12 +480,10 @@ static void viture_pose_callback(float* pose, uint64_t ts) {
     // pose received in NWU coordinate system
     imu_quat_type quat = {.x = pose[4], .y = pose[5], .z = pose[6], .w = pose[3]};
 
-    uint32_t timestamp_ms = (uint32_t)(ts / 1000000ULL);
-    viture_publish_pose(quat, false, (imu_vec3_type){0}, timestamp_ms);
+    viture_publish_pose(quat, false, (imu_vec3_type){0}, 0);
 }
 
 static void viture_carina_imu_callback(float* imu, double timestamp) {
-    static double initial_timestamp = -1.0;
     device_properties_type* device = device_checkout();
     if (connected && viture_provider != NULL && device != NULL && imu != NULL) {
         float pose[9] = {0};
@@ -503,17 +501,7 @@ static void viture_carina_imu_callback(float* imu, double timestamp) {
                 .z = pose[1] * meters_to_full_distance_ratio
             };
 
-            if (initial_timestamp < 0.0) initial_timestamp = timestamp;
-
-            double elapsed_ms = (timestamp - initial_timestamp) * 1000.0;
-            if (elapsed_ms >= VITURE_FLOAT_EXACT_MS_LIMIT - VITURE_FLOAT_RESET_MARGIN_MS) {
-                initial_timestamp = timestamp;
-                elapsed_ms = 0.0;
-            }
-
-            uint32_t timestamp_ms = (uint32_t)elapsed_ms;
-            
-            viture_publish_pose(quat, true, position, timestamp_ms);
+            viture_publish_pose(quat, true, position, 0);
         } else if (config()->debug_device) {
             log_debug("VITURE: get_gl_pose_carina failed (result=%d pose_status=%d)\n",
                       result,
@@ -583,8 +571,8 @@ static void viture_fusion_event(uint64_t timestamp, device_imu_event_type event,
     device_imu_quat_type q = device_imu_get_orientation(ahrs);
     imu_quat_type nwu = {.w = -q.x, .x = q.w, .y = q.z, .z = -q.y};
 
-    uint32_t timestamp_ms = (uint32_t)(timestamp / 1000000ULL);
-    viture_publish_pose(nwu, false, (imu_vec3_type){0}, timestamp_ms);
+    // the raw callback's timestamp, passed through the fusion
+    viture_publish_pose(nwu, false, (imu_vec3_type){0}, timestamp);
 }
 
 // data: [gx, gy, gz, ax, ay, az, mx, my, mz, temperature], each triad in EDN order.
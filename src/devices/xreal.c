@@ -7,6 +7,7 @@
 #include "xreal_air_devices.h"
 #include "xreal_one_devices.h"
 #include "driver.h"
+#include "epoch.h"
 #include "imu.h"
 #include "logging.h"
 #include "outputs.h"
@@ -22,7 +23,6 @@
 #include <string.h>
 #include <unistd.h>
 
-#define TS_TO_MS_FACTOR 1000000
 #define EXPECTED_CYCLES_PER_S 1000
 #define EXPECTED_CYCLE_TIME_MS (1000.0 / EXPECTED_CYCLES_PER_S)
 #define BUFFER_SIZE_TARGET_MS 10 // smooth IMU data over this period of time
@@ -209,7 +209,6 @@ void handle_xreal_event(uint64_t timestamp,
                         const device_imu_ahrs_type* ahrs) {
     if (!connected || driver_disabled()) return;
 
-    uint32_t ts = (uint32_t) (timestamp / TS_TO_MS_FACTOR);
     if (event == DEVICE_IMU_EVENT_UPDATE) {
         device_imu_quat_type quat = device_imu_get_orientation(ahrs);
         imu_quat_type imu_quat = { .w = quat.w, .x = quat.x, .y = quat.y, .z = quat.z };
@@ -217,7 +216,8 @@ void handle_xreal_event(uint64_t timestamp,
         imu_pose_type pose = {0};
         pose.orientation = nwu_quat;
         pose.has_orientation = true;
-        pose.timestamp_ms = ts;
+        pose.timestamp_ns = get_monotonic_time_ns();
+        pose.device_timestamp_ns = timestamp;
         connection_pool_ingest_pose(XREAL_DRIVER_ID, pose);
     }
 }
@@ -323,6 +323,37 @@ void *poll_imu_func(void *arg) {
     if (config()->debug_threads) log_debug("poll_imu_func, exiting\n");
 };
 
+static int display_mode_refresh_hz(int display_mode) {
+    switch (display_mode) {
+        case DEVICE_MCU_DISPLAY_MODE_1920x1080_60:
+        case DEVICE_MCU_DISPLAY_MODE_1920x1080_60_SBS:
+        case DEVICE_MCU_DISPLAY_MODE_3840x1080_60_SBS:
+            return 60;
+        case DEVICE_MCU_DISPLAY_MODE_1920x1080_72:
+        case DEVICE_MCU_DISPLAY_MODE_3840x1080_72_SBS:
+            return 72;
+        case DEVICE_MCU_DISPLAY_MODE_1920x1080_90:
+        case DEVICE_MCU_DISPLAY_MODE_3840x1080_90_SBS:
+            return 90;
+        case DEVICE_MCU_DISPLAY_MODE_1920x1080_120:
+            return 120;
+        default:
+            return 0;
+    }
+}
+
+static void update_display_refresh_hz() {
+    device_properties_type* device = device_checkout();
+    if (device != NULL && glasses_controller) {
+        int refresh_hz = display_mode_refresh_hz(glasses_controller->disp_mode);
+        if (atomic_load_explicit(&device->display_refresh_hz, memory_order_relaxed) != refresh_hz) {
+            if (config()->debug_device) log_debug("xreal display refresh rate: %d Hz\n", refresh_hz);
+            atomic_store_explicit(&device->display_refresh_hz, refresh_hz, memory_order_relaxed);
+        }
+    }
+    device_checkin(device);
+}
+
 bool sbs_mode_change_requested = false;
 void *poll_controller_func(void *arg) {
     if (config()->debug_threads) log_debug("poll_controller_func, starting\n");
@@ -339,6 +370,7 @@ void *poll_controller_func(void *arg) {
             } else {
                 device_mcu_poll_display_mode(glasses_controller);
             }
+            update_display_refresh_hz();
         }
 
         sleep(1);
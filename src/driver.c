@@ -5,7 +5,10 @@
 #include "devices/viture.h"
 #include "devices/xreal.h"
 #include "connection_pool.h"
+#include "control_socket.h"
+#include "epoch.h"
 #include "files.h"
+#include "hazard_pointer.h"
 #include "imu.h"
 #include "imu_rate.h"
 #include "ipc.h"
@@ -15,7 +18,12 @@
 #include "ipc.h"
 #include "outputs.h"
 #include "plugins.h"
+#include "pose_notify.h"
+#include "pose_shm.h"
+#include "pose_stats.h"
+#include "pose_stream.h"
 #include "plugins/gamescope_reshade_wayland.h"
+#include "quat_kernels.h"
 #include "runtime_context.h"
 #include "state.h"
 #include "strings.h"
@@ -54,10 +62,13 @@
 ipc_values_type *ipc_values;
 
 bool glasses_calibrated=false;
-long int glasses_calibration_started_sec=0;
+uint64_t glasses_calibration_started_ns=0;
 bool force_quit=false;
 control_flags_type *control_flags;
 
+// the control flags file and the control socket are served from different threads
+pthread_mutex_t control_flags_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 bool captured_reference_pose=false;
 imu_pose_type reference_pose;
 imu_quat_type reference_orientation_conj;
@@ -67,11 +78,13 @@ static bool is_driver_connected() {
 }
 
 void reset_calibration(bool reset_device) {
-    glasses_calibration_started_sec=0;
+    glasses_calibration_started_ns=0;
     glasses_calibrated=false;
     captured_reference_pose=false;
-    control_flags->recalibrate=false;
+    atomic_store(&control_flags->recalibrate, false);
     state()->calibration_state = CALIBRATING;
+    publish_hot_state();
+    control_socket_acknowledge(CONTROL_COMMAND_RECALIBRATE, get_monotonic_time_ns());
 
     if (reset_device && is_driver_connected()) {
         if (config()->debug_device) log_debug("reset_calibration, connection_pool_disconnect_all(true)\n");
@@ -113,8 +126,10 @@ void driver_handle_pose(imu_pose_type pose) {
         if (config()->debug_device && imu_counter == 0 && pose.has_orientation)
             log_debug("driver_handle_pose_event - quat: %f %f %f %f; pos: %f %f %f\n", pose.orientation.x, pose.orientation.y, pose.orientation.z, pose.orientation.w, pose.position.x, pose.position.y, pose.position.z);
 
+        uint64_t stage_start_ns = get_monotonic_time_ns();
         if (glasses_calibrated) {
-            if (!captured_reference_pose || multi_tap == MT_RECENTER_SCREEN || control_flags->recenter_screen) {
+            bool recenter_requested = atomic_exchange(&control_flags->recenter_screen, false);
+            if (!captured_reference_pose || multi_tap == MT_RECENTER_SCREEN || recenter_requested) {
                 if (multi_tap == MT_RECENTER_SCREEN) log_message("Double-tap detected.\n");
                 log_message("Centering screen\n");
 
@@ -141,7 +156,7 @@ void driver_handle_pose(imu_pose_type pose) {
                 
                 captured_reference_pose = true;
                 reference_pose_updated = true;
-                control_flags->recenter_screen = false;
+                control_socket_acknowledge(CONTROL_COMMAND_RECENTER_SCREEN, pose.timestamp_ns);
 
                 plugins.handle_reference_pose_updated(old_reference_pose, reference_pose);
             } else {
@@ -151,10 +166,7 @@ void driver_handle_pose(imu_pose_type pose) {
                 if (reference_pose_updated) reference_orientation_conj = conjugate(reference_pose.orientation);
             }
         } else {
-            struct timeval tv;
-            gettimeofday(&tv, NULL);
-
-            if (glasses_calibration_started_sec == 0) {
+            if (glasses_calibration_started_ns == 0) {
                 // defaults used for mouse/joystick while waiting on calibration
                 imu_quat_type tmp_screen_center = { .w = 1.0, .x = 0.0, .y = 0.0, .z = 0.0 };
                 reference_pose.orientation = tmp_screen_center;
@@ -163,28 +175,34 @@ void driver_handle_pose(imu_pose_type pose) {
                 reference_pose.has_orientation = pose.has_orientation;
                 reference_pose.has_position = pose.has_position;
 
-                glasses_calibration_started_sec=tv.tv_sec;
+                glasses_calibration_started_ns=pose.timestamp_ns;
                 if (ipc_values) reset_pose_data(ipc_values);
             } else {
-                glasses_calibrated = (tv.tv_sec - glasses_calibration_started_sec) > device->calibration_wait_s;
+                glasses_calibrated = (pose.timestamp_ns - glasses_calibration_started_ns) > device->calibration_wait_s * NS_PER_SEC;
                 if (glasses_calibrated) {
                     state()->calibration_state = CALIBRATED;
+                    publish_hot_state();
                     log_message("Device calibration complete\n");
                 }
             }
         }
 
+        pose_stats_record(POSE_STATS_REFERENCE_POSE, get_monotonic_time_ns() - stage_start_ns);
+
         // be resilient to bad values that may come from device drivers
         if (!isnan(pose.orientation.w)) {
             static imu_euler_type prev_unmodified_euler = {0.0f, 0.0f, 0.0f};
 
             if (pose.has_orientation) {
-                pose.orientation = multiply_quaternions(reference_orientation_conj, pose.orientation);
+                quat_kernels.multiply(&reference_orientation_conj, &pose.orientation, &pose.orientation, 1);
+                pose.orientation = renormalize_quaternion_lazy(pose.orientation);
 
                 // invert after adjusting for the reference orientation to better match user expectations
-                if (config()->invert_x) pose.orientation.x = -pose.orientation.x;
-                if (config()->invert_y) pose.orientation.y = -pose.orientation.y;
-                if (config()->invert_z) pose.orientation.z = -pose.orientation.z;
+                driver_config_type* cfg = config_acquire();
+                if (cfg->invert_x) pose.orientation.x = -pose.orientation.x;
+                if (cfg->invert_y) pose.orientation.y = -pose.orientation.y;
+                if (cfg->invert_z) pose.orientation.z = -pose.orientation.z;
+                config_release();
                 
                 pose.euler = quaternion_to_euler_zyx(pose.orientation);
             }
@@ -195,7 +213,7 @@ void driver_handle_pose(imu_pose_type pose) {
                     .y = pose.position.y - reference_pose.position.y,
                     .z = pose.position.z - reference_pose.position.z
                 };
-                pose.position = vector_rotate(rel, reference_orientation_conj);
+                quat_kernels.rotate(&rel, &reference_orientation_conj, &pose.position, 1);
             } else {
                 pose.position = (imu_vec3_type){0.0f, 0.0f, 0.0f};
             }
@@ -203,13 +221,16 @@ void driver_handle_pose(imu_pose_type pose) {
             imu_euler_type euler_velocities;
             bool velocities_set = false;
             
-            if (config()->multi_tap_enabled) {
+            driver_config_type* cfg = config_acquire();
+            if (cfg->multi_tap_enabled) {
                 euler_velocities = get_euler_velocities(&prev_unmodified_euler, pose.euler, device->imu_cycles_per_s);
-                multi_tap = detect_multi_tap(euler_velocities, pose.timestamp_ms, config()->debug_multi_tap);
+                multi_tap = detect_multi_tap(euler_velocities, pose.timestamp_ns / NS_PER_MS, cfg->debug_multi_tap);
                 velocities_set = true;
             }
+            config_release();
 
-            if (multi_tap == MT_RESET_CALIBRATION || control_flags->recalibrate) {
+            bool recalibrate_requested = atomic_exchange(&control_flags->recalibrate, false);
+            if (multi_tap == MT_RESET_CALIBRATION || recalibrate_requested) {
                 if (multi_tap == MT_RESET_CALIBRATION) log_message("Triple-tap detected. ");
                 log_message("Kicking off calibration\n");
                 reset_calibration(true);
@@ -217,7 +238,9 @@ void driver_handle_pose(imu_pose_type pose) {
 
             if (glasses_calibrated) {
                 static imu_euler_type prev_modified_euler = {0.0f, 0.0f, 0.0f};
+                stage_start_ns = get_monotonic_time_ns();
                 plugins.modify_pose(&pose);
+                pose_stats_record(POSE_STATS_MODIFY_POSE, get_monotonic_time_ns() - stage_start_ns);
 
                 // recompute velocities after pose modification, since outputs that use them
                 // will want to be relative to the modified pose
@@ -229,6 +252,7 @@ void driver_handle_pose(imu_pose_type pose) {
                 euler_velocities = get_euler_velocities(&prev_unmodified_euler, pose.euler, device->imu_cycles_per_s);
             }
             handle_imu_update(pose, euler_velocities, glasses_calibrated, ipc_values);
+            pose_stats_record(POSE_STATS_END_TO_END, get_monotonic_time_ns() - pose.timestamp_ns);
         } else if (config()->debug_device) log_debug("driver_handle_pose_event, received invalid quat\n");
 
         // reset the counter every second
@@ -390,6 +414,9 @@ void update_config_from_file(FILE *fp) {
     if (config()->metrics_disabled != new_config->metrics_disabled)
         log_message("Metrics have been %s\n", new_config->metrics_disabled ? "disabled" : "enabled");
 
+    if (config()->pose_history_size != new_config->pose_history_size)
+        log_message("Pose history size has changed to %d\n", new_config->pose_history_size);
+
     if (!config()->debug_joystick && new_config->debug_joystick)
         log_message("Joystick debugging has been enabled, to see it, use 'watch -n 0.1 cat $XDG_RUNTIME_DIR/xr_driver/joystick_debug' in bash\n");
     if (config()->debug_joystick && !new_config->debug_joystick)
@@ -416,7 +443,11 @@ void update_config_from_file(FILE *fp) {
     if (config()->debug_connections != new_config->debug_connections)
         log_message("Connection pool debugging has been %s\n", new_config->debug_connections ? "enabled" : "disabled");
 
-    update_config(config(), new_config);
+    if (config()->debug_latency != new_config->debug_latency)
+        log_message("Latency stats have been %s\n", new_config->debug_latency ? "enabled" : "disabled");
+
+    set_config(new_config);
+    pose_stats_set_enabled(config()->debug_latency);
 
     if (config()->disabled && is_driver_connected()) {
         if (config()->debug_device) log_debug("update_config_from_file, connection_pool_disconnect_all(true)\n");
@@ -561,14 +592,57 @@ void handle_control_flags_update() {
     device_checkin(device);
 }
 
+// control socket requests, the same as their control flags file counterparts
+static control_status_type handle_control_command(control_command_type command, uint32_t value) {
+    control_status_type status = CONTROL_STATUS_OK;
+
+    pthread_mutex_lock(&control_flags_mutex);
+    switch (command) {
+        case CONTROL_COMMAND_RECENTER_SCREEN:
+            // picked up by the next pose, which acknowledges it
+            atomic_store(&control_flags->recenter_screen, true);
+            status = CONTROL_STATUS_ACCEPTED;
+            break;
+        case CONTROL_COMMAND_RECALIBRATE:
+            atomic_store(&control_flags->recalibrate, true);
+            status = CONTROL_STATUS_ACCEPTED;
+            break;
+        case CONTROL_COMMAND_SBS_MODE:
+            if (value != CONTROL_SBS_MODE_ENABLE && value != CONTROL_SBS_MODE_DISABLE) {
+                status = CONTROL_STATUS_INVALID_REQUEST;
+            } else {
+                device_properties_type* device = device_checkout();
+                if (is_driver_connected() && device != NULL && device->sbs_mode_supported) {
+                    control_flags->sbs_mode = value == CONTROL_SBS_MODE_ENABLE ? SBS_CONTROL_ENABLE : SBS_CONTROL_DISABLE;
+                    handle_control_flags_update();
+                } else {
+                    status = CONTROL_STATUS_FAILED;
+                }
+                device_checkin(device);
+            }
+            break;
+        case CONTROL_COMMAND_FORCE_QUIT:
+            control_flags->force_quit = true;
+            handle_control_flags_update();
+            break;
+        default:
+            status = CONTROL_STATUS_INVALID_REQUEST;
+    }
+    pthread_mutex_unlock(&control_flags_mutex);
+
+    return status;
+}
+
 // pthread function for watching control flags file
 void *monitor_control_flags_file_thread_func(void *arg) {
     char *control_file_path = NULL;
     FILE* fp = get_driver_state_file(control_flags_filename, "r", &control_file_path);
     if (fp) {
+        pthread_mutex_lock(&control_flags_mutex);
         read_control_flags(fp, control_flags);
         write_state(state());
         handle_control_flags_update();
+        pthread_mutex_unlock(&control_flags_mutex);
 
         fclose(fp);
         remove(control_file_path);
@@ -601,9 +675,11 @@ void *monitor_control_flags_file_thread_func(void *arg) {
             if ((event->mask & IN_CLOSE_WRITE) && strcmp(event->name, control_flags_filename) == 0) {
                 fp = fopen(control_file_path, "r");
                 if (fp) {
+                    pthread_mutex_lock(&control_flags_mutex);
                     read_control_flags(fp, control_flags);
                     write_state(state());
                     handle_control_flags_update();
+                    pthread_mutex_unlock(&control_flags_mutex);
 
                     fclose(fp);
                     remove(control_file_path);
@@ -650,6 +726,7 @@ void handle_device_connection_changed(bool is_added, connected_device_type* devi
         }
         if (new_primary) {
             state()->calibration_state = NOT_CALIBRATED;
+            publish_hot_state();
             set_device_and_checkout(new_primary);
             primary_device_ref = new_primary;
         }
@@ -696,6 +773,12 @@ int main(int argc, const char** argv) {
     }
     free_and_clear(&lock_file_path);
 
+    hazard_pointer_init();
+    quat_kernels_init();
+    log_message("Using %s quaternion kernels\n", quat_kernels.name);
+    pose_shm_init();
+    pose_notify_init();
+    pose_stream_init();
     set_config(default_config());
     set_state(calloc(1, sizeof(driver_state_type)));
     connection_pool_init(driver_handle_pose, driver_reference_pose);
@@ -706,11 +789,12 @@ int main(int argc, const char** argv) {
     if (driver_disabled()) log_message("Driver is disabled\n");
 
     control_flags = calloc(1, sizeof(control_flags_type));
-    control_flags->recenter_screen = false;
-    control_flags->recalibrate = false;
+    atomic_init(&control_flags->recenter_screen, false);
+    atomic_init(&control_flags->recalibrate, false);
     control_flags->force_quit = false;
     control_flags->sbs_mode = SBS_CONTROL_UNSET;
     control_flags->request_features = NULL;
+    control_socket_init(handle_control_command);
 
     plugins.start();
     write_state(state());
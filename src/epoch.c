@@ -1,5 +1,6 @@
 #include "epoch.h"
 
+#include <stdatomic.h>
 #include <time.h>
 
 struct timespec ts;
@@ -10,4 +11,29 @@ uint64_t get_epoch_time_ms() {
     long int nsec_ms = ts.tv_nsec / 1000000;
 
     return (uint64_t)(sec_ms + nsec_ms);
-}
\ No newline at end of file
+}
+
+uint64_t get_monotonic_time_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * NS_PER_SEC + (uint64_t)now.tv_nsec;
+}
+
+static atomic_uint_fast64_t epoch_offset_ns = ATOMIC_VAR_INIT(0);
+static atomic_uint_fast64_t epoch_offset_refreshed_ns = ATOMIC_VAR_INIT(0);
+uint64_t monotonic_to_epoch_ms(uint64_t monotonic_ns) {
+    uint64_t refreshed_ns = atomic_load_explicit(&epoch_offset_refreshed_ns, memory_order_relaxed);
+    uint64_t offset_ns = atomic_load_explicit(&epoch_offset_ns, memory_order_relaxed);
+    if (refreshed_ns == 0 || (int64_t)(monotonic_ns - refreshed_ns) > (int64_t)NS_PER_SEC) {
+        struct timespec realtime;
+        uint64_t now_ns = get_monotonic_time_ns();
+        clock_gettime(CLOCK_REALTIME, &realtime);
+        offset_ns = (uint64_t)realtime.tv_sec * NS_PER_SEC + (uint64_t)realtime.tv_nsec - now_ns;
+
+        atomic_store_explicit(&epoch_offset_ns, offset_ns, memory_order_relaxed);
+        atomic_store_explicit(&epoch_offset_refreshed_ns, now_ns, memory_order_relaxed);
+    }
+
+    return (monotonic_ns + offset_ns) / NS_PER_MS;
+}
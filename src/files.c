@@ -3,9 +3,11 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/file.h>
 #include <sys/types.h>
+#include <sys/un.h>
 #include <unistd.h>
 
 const char* XR_DRIVER_DIR = "xr_driver";
@@ -133,4 +135,29 @@ FILE* get_or_create_runtime_file(const char *filename, const char *mode, char **
 FILE* get_or_create_config_file(const char *filename, const char *mode, char **full_path, bool *created) {
     *full_path = get_config_file_path(filename);
     return get_or_create_file(*full_path, 0777, mode, created);
-}
\ No newline at end of file
+}
+
+int listen_on_runtime_socket(const char *filename, int type, int backlog, char **full_path) {
+    *full_path = get_runtime_file_path(filename);
+
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(*full_path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strncpy(addr.sun_path, *full_path, sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, type | SOCK_CLOEXEC, 0);
+    if (fd == -1) return -1;
+
+    // the driver's instance lock means a socket already at this path is stale
+    unlink(*full_path);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) == -1 || listen(fd, backlog) == -1) {
+        int saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        return -1;
+    }
+
+    return fd;
+}
@@ -0,0 +1,155 @@
+#include "hazard_pointer.h"
+#include "logging.h"
+
+#include <linux/membarrier.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// more than the number of threads the driver runs at once; a thread hands its row back when it exits
+#define HAZARD_POINTER_MAX_THREADS 64
+
+struct hazard_pointer_row_t {
+    _Alignas(64) void * _Atomic slots[HAZARD_SLOTS_PER_THREAD];
+    atomic_bool in_use;
+};
+
+static struct hazard_pointer_row_t rows[HAZARD_POINTER_MAX_THREADS];
+static _Thread_local struct hazard_pointer_row_t* thread_row = NULL;
+
+static pthread_key_t row_key;
+
+struct retired_pointer_t {
+    void* ptr;
+    hazard_pointer_free_func free_func;
+    struct retired_pointer_t* next;
+};
+
+static pthread_mutex_t retired_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct retired_pointer_t* retired_pointers = NULL;
+
+// if true, readers only need a compiler barrier, the writer forces the memory barrier on all of our threads
+static bool asymmetric_barrier = false;
+
+static int membarrier(int cmd) {
+    return syscall(SYS_membarrier, cmd, 0, 0);
+}
+
+static void release_row(void* arg) {
+    struct hazard_pointer_row_t* row = (struct hazard_pointer_row_t*)arg;
+    for (int i = 0; i < HAZARD_SLOTS_PER_THREAD; i++)
+        atomic_store_explicit(&row->slots[i], NULL, memory_order_release);
+    atomic_store_explicit(&row->in_use, false, memory_order_release);
+}
+
+void hazard_pointer_init() {
+    pthread_key_create(&row_key, release_row);
+
+    int supported = membarrier(MEMBARRIER_CMD_QUERY);
+    asymmetric_barrier = supported > 0 &&
+                         (supported & MEMBARRIER_CMD_PRIVATE_EXPEDITED) &&
+                         membarrier(MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED) == 0;
+}
+
+static struct hazard_pointer_row_t* claim_row() {
+    bool logged = false;
+    while (true) {
+        for (int i = 0; i < HAZARD_POINTER_MAX_THREADS; i++) {
+            bool expected = false;
+            if (atomic_compare_exchange_strong(&rows[i].in_use, &expected, true)) {
+                thread_row = &rows[i];
+                pthread_setspecific(row_key, thread_row);
+                return thread_row;
+            }
+        }
+
+        if (!logged) {
+            log_error("All %d hazard pointer rows are in use, waiting for a thread to exit\n", HAZARD_POINTER_MAX_THREADS);
+            logged = true;
+        }
+        sched_yield();
+    }
+}
+
+void* hazard_pointer_protect(hazard_pointer_slot_type slot, void * _Atomic *source) {
+    struct hazard_pointer_row_t* row = thread_row ? thread_row : claim_row();
+
+    void* ptr = atomic_load_explicit(source, memory_order_relaxed);
+    while (true) {
+        atomic_store_explicit(&row->slots[slot], ptr, memory_order_relaxed);
+
+        // the slot store must be visible before we re-check the source, pairs with the barrier in
+        // hazard_pointer_wait_for_readers
+        if (asymmetric_barrier) atomic_signal_fence(memory_order_seq_cst);
+        else atomic_thread_fence(memory_order_seq_cst);
+
+        void* current = atomic_load_explicit(source, memory_order_acquire);
+        if (current == ptr) return ptr;
+        ptr = current;
+    }
+}
+
+void hazard_pointer_clear(hazard_pointer_slot_type slot) {
+    if (thread_row) atomic_store_explicit(&thread_row->slots[slot], NULL, memory_order_release);
+}
+
+void hazard_pointer_wait_for_readers(void* ptr) {
+    if (ptr == NULL) return;
+
+    if (asymmetric_barrier) membarrier(MEMBARRIER_CMD_PRIVATE_EXPEDITED);
+    else atomic_thread_fence(memory_order_seq_cst);
+
+    for (int i = 0; i < HAZARD_POINTER_MAX_THREADS; i++) {
+        for (int j = 0; j < HAZARD_SLOTS_PER_THREAD; j++) {
+            while (atomic_load_explicit(&rows[i].slots[j], memory_order_acquire) == ptr) sched_yield();
+        }
+    }
+}
+
+static bool is_protected(void* ptr) {
+    for (int i = 0; i < HAZARD_POINTER_MAX_THREADS; i++) {
+        for (int j = 0; j < HAZARD_SLOTS_PER_THREAD; j++) {
+            if (atomic_load_explicit(&rows[i].slots[j], memory_order_acquire) == ptr) return true;
+        }
+    }
+
+    return false;
+}
+
+void hazard_pointer_retire(void* ptr, hazard_pointer_free_func free_func) {
+    if (ptr == NULL) return;
+
+    struct retired_pointer_t* retired = malloc(sizeof(struct retired_pointer_t));
+    if (retired == NULL) {
+        log_error("Error allocating retired pointer\n");
+        exit(1);
+    }
+    retired->ptr = ptr;
+    retired->free_func = free_func;
+
+    pthread_mutex_lock(&retired_mutex);
+    retired->next = retired_pointers;
+    retired_pointers = retired;
+
+    // one barrier covers the whole scan, same pairing as in hazard_pointer_wait_for_readers
+    if (asymmetric_barrier) membarrier(MEMBARRIER_CMD_PRIVATE_EXPEDITED);
+    else atomic_thread_fence(memory_order_seq_cst);
+
+    struct retired_pointer_t** link = &retired_pointers;
+    while (*link != NULL) {
+        struct retired_pointer_t* current = *link;
+        if (is_protected(current->ptr)) {
+            link = &current->next;
+            continue;
+        }
+
+        *link = current->next;
+        current->free_func(current->ptr);
+        free(current);
+    }
+    pthread_mutex_unlock(&retired_mutex);
+}
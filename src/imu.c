@@ -35,6 +35,15 @@ imu_quat_type normalize_quaternion(imu_quat_type q) {
     return q;
 }
 
+imu_quat_type renormalize_quaternion_lazy(imu_quat_type q) {
+    float magnitude_squared = q.w*q.w + q.x*q.x + q.y*q.y + q.z*q.z;
+
+    // written so NaN falls through to normalize_quaternion, which handles it
+    if (fabsf(magnitude_squared - 1.0f) <= QUAT_RENORMALIZE_TOLERANCE) return q;
+
+    return normalize_quaternion(q);
+}
+
 imu_quat_type conjugate(imu_quat_type q) {
     imu_quat_type q_conj = {
         .w = q.w,
@@ -46,7 +55,7 @@ imu_quat_type conjugate(imu_quat_type q) {
     return q_conj;
 }
 
-imu_quat_type multiply_quaternions(imu_quat_type q1, imu_quat_type q2) {
+imu_quat_type multiply_quaternions_unnormalized(imu_quat_type q1, imu_quat_type q2) {
     imu_quat_type q = {
         .w = q1.w*q2.w - q1.x*q2.x - q1.y*q2.y - q1.z*q2.z,
         .x = q1.w*q2.x + q1.x*q2.w + q1.y*q2.z - q1.z*q2.y,
@@ -54,7 +63,11 @@ imu_quat_type multiply_quaternions(imu_quat_type q1, imu_quat_type q2) {
         .z = q1.w*q2.z + q1.x*q2.y - q1.y*q2.x + q1.z*q2.w
     };
 
-    return normalize_quaternion(q);
+    return q;
+}
+
+imu_quat_type multiply_quaternions(imu_quat_type q1, imu_quat_type q2) {
+    return renormalize_quaternion_lazy(multiply_quaternions_unnormalized(q1, q2));
 }
 
 imu_quat_type quaternion_eus_to_nwu(imu_quat_type q) {
@@ -238,7 +251,7 @@ bool quat_equal(imu_quat_type q1, imu_quat_type q2) {
 }
 
 imu_vec3_type vector_rotate(imu_vec3_type v, imu_quat_type q) {
-    q = normalize_quaternion(q);
+    q = renormalize_quaternion_lazy(q);
 
     float w = q.w;
     float qx = q.x, qy = q.y, qz = q.z;
@@ -256,8 +269,87 @@ imu_vec3_type vector_rotate(imu_vec3_type v, imu_quat_type q) {
 }
 
 float quat_small_angle_rad(imu_quat_type q1, imu_quat_type q2) {
-    imu_quat_type q_rel = multiply_quaternions(conjugate(q1), q2);
+    // the angle only depends on the ratio of the vector part to w, so scale doesn't matter here
+    imu_quat_type q_rel = multiply_quaternions_unnormalized(conjugate(q1), q2);
     float v_norm = sqrtf(q_rel.x * q_rel.x + q_rel.y * q_rel.y + q_rel.z * q_rel.z);
     float w_abs = fabsf(q_rel.w);
     return 2.0f * atan2f(v_norm, w_abs);
-}
\ No newline at end of file
+}
+
+float quat_dot(imu_quat_type q1, imu_quat_type q2) {
+    return q1.x * q2.x + q1.y * q2.y + q1.z * q2.z + q1.w * q2.w;
+}
+
+static float clamp_unit(float v) {
+    if (v < 0.0f) return 0.0f;
+    if (v > 1.0f) return 1.0f;
+    return v;
+}
+
+// from and to must already be on the same hemisphere
+static inline imu_quat_type lerp_and_normalize(imu_quat_type from, imu_quat_type to, float t) {
+    imu_quat_type out = {
+        .x = from.x + (to.x - from.x) * t,
+        .y = from.y + (to.y - from.y) * t,
+        .z = from.z + (to.z - from.z) * t,
+        .w = from.w + (to.w - from.w) * t
+    };
+
+    // can't be 0 with both inputs on the same hemisphere, unless they weren't unit length to begin with
+    float len = sqrtf(quat_dot(out, out));
+    if (len > 0.0f) {
+        out.x /= len;
+        out.y /= len;
+        out.z /= len;
+        out.w /= len;
+    }
+
+    return out;
+}
+
+imu_quat_type quat_nlerp(imu_quat_type from, imu_quat_type to, float t) {
+    if (quat_dot(from, to) < 0.0f) {
+        to.x = -to.x;
+        to.y = -to.y;
+        to.z = -to.z;
+        to.w = -to.w;
+    }
+
+    return lerp_and_normalize(from, to, clamp_unit(t));
+}
+
+imu_quat_type quat_slerp(imu_quat_type from, imu_quat_type to, float t) {
+    t = clamp_unit(t);
+
+    float dot = quat_dot(from, to);
+    if (dot < 0.0f) {
+        dot = -dot;
+        to.x = -to.x;
+        to.y = -to.y;
+        to.z = -to.z;
+        to.w = -to.w;
+    }
+
+    // When the quaternions are very close, fall back to nlerp to avoid numeric issues.
+    if (dot > 0.9995f) return lerp_and_normalize(from, to, t);
+
+    if (dot > 1.0f) dot = 1.0f;
+    float theta_0 = acosf(dot);
+    float sin_theta_0 = sinf(theta_0);
+    if (sin_theta_0 <= 0.0f) return to;
+
+    float theta = theta_0 * t;
+    float sin_theta = sinf(theta);
+
+    float s0 = cosf(theta) - dot * sin_theta / sin_theta_0;
+    float s1 = sin_theta / sin_theta_0;
+
+    imu_quat_type out = {
+        .x = (s0 * from.x) + (s1 * to.x),
+        .y = (s0 * from.y) + (s1 * to.y),
+        .z = (s0 * from.z) + (s1 * to.z),
+        .w = (s0 * from.w) + (s1 * to.w)
+    };
+
+    return renormalize_quaternion_lazy(out);
+}
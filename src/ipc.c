@@ -23,6 +23,9 @@ const char *date_ipc_name = "keepalive_date";
 const char *pose_orientation_ipc_name = "pose_orientation";
 const char *pose_orientation_mutex_ipc_name = "pose_orientation_mutex";
 const char *pose_position_ipc_name = "pose_position";
+const char *pose_orientation_predicted_ipc_name = "pose_orientation_predicted";
+const char *pose_position_predicted_ipc_name = "pose_position_predicted";
+const char *pose_prediction_look_ahead_ms_ipc_name = "pose_prediction_look_ahead_ms";
 
 // deprecated - can be removed once this version is widely distributed
 const char *display_fov_ipc_name = "display_fov";
@@ -34,6 +37,9 @@ bool setup_ipc_values(ipc_values_type *ipc_values, bool debug) {
     setup_ipc_value(date_ipc_name, (void**) &ipc_values->date, sizeof(float) * 4, debug);
     setup_ipc_value(pose_orientation_ipc_name, (void**) &ipc_values->pose_orientation, sizeof(float) * 16, debug);
     setup_ipc_value(pose_position_ipc_name, (void**) &ipc_values->pose_position, sizeof(float) * 3, debug);
+    setup_ipc_value(pose_orientation_predicted_ipc_name, (void**) &ipc_values->pose_orientation_predicted, sizeof(float) * 4, debug);
+    setup_ipc_value(pose_position_predicted_ipc_name, (void**) &ipc_values->pose_position_predicted, sizeof(float) * 3, debug);
+    setup_ipc_value(pose_prediction_look_ahead_ms_ipc_name, (void**) &ipc_values->pose_prediction_look_ahead_ms, sizeof(float), debug);
 
     setup_ipc_value(display_fov_ipc_name, (void**) &ipc_values->display_fov, sizeof(float), debug);
     setup_ipc_value(lens_distance_ratio_ipc_name, (void**) &ipc_values->lens_distance_ratio, sizeof(float), debug);
@@ -130,4 +136,19 @@ void cleanup_ipc(char* file_prefix, bool debug) {
     }
 
     globfree(&glob_result);
-}
\ No newline at end of file
+}
+
+bool try_lock_pose_ipc_values(ipc_values_type *ipc_values) {
+    int ret = pthread_mutex_trylock(ipc_values->pose_orientation_mutex);
+    if (ret == EOWNERDEAD) {
+        // a reader died holding it, only we write the values so they're still intact
+        pthread_mutex_consistent(ipc_values->pose_orientation_mutex);
+        return true;
+    }
+
+    return ret == 0;
+}
+
+void unlock_pose_ipc_values(ipc_values_type *ipc_values) {
+    pthread_mutex_unlock(ipc_values->pose_orientation_mutex);
+}
@@ -48,7 +48,7 @@ void init_multi_tap(int init_imu_cycles_per_s) {
 }
 
 // returns the number of taps observed
-int detect_multi_tap(imu_euler_type velocities, uint32_t timestamp, bool debug) {
+int detect_multi_tap(imu_euler_type velocities, uint64_t timestamp_ms, bool debug) {
     if (mt_buffer) {
         // the oldest value is zero/unset if the buffer hasn't been filled yet, so we check prior to doing a
         // push/pop, to know if the value returned will be relevant to our calculations
@@ -59,7 +59,7 @@ int detect_multi_tap(imu_euler_type velocities, uint32_t timestamp, bool debug)
         if (was_full) {
             // extrapolate out to seconds, so the threshold can stay the same regardless of buffer size
             float acceleration = (next_value - oldest_value) * (float)imu_cycles_per_s / mt_buffer_size * accel_adjust_constant;
-            int tap_elapsed_ms = timestamp - tap_start_time;
+            int tap_elapsed_ms = timestamp_ms - tap_start_time;
             if ((tap_count > 0 || mt_state != MT_STATE_IDLE) && tap_elapsed_ms > max_tap_period_ms) {
                 peak_max = 0.0;
                 mt_state = MT_STATE_IDLE;
@@ -72,17 +72,17 @@ int detect_multi_tap(imu_euler_type velocities, uint32_t timestamp, bool debug)
                 switch(mt_state) {
                     case MT_STATE_IDLE: {
                         if (acceleration > mt_detect_threshold) {
-                            tap_start_time = timestamp;
+                            tap_start_time = timestamp_ms;
                             peak_max = 0.0;
                             mt_state = MT_STATE_RISE;
                             if (debug) log_debug("tap-rise detected %f\n", acceleration);
                         } else {
                             if (debug) {
                                 if (acceleration > peak_max) peak_max = acceleration;
-                                if ((timestamp - last_logged_peak_time) > 1000) {
+                                if ((timestamp_ms - last_logged_peak_time) > 1000) {
                                     log_debug("no-tap detected, peak was %f\n", peak_max);
                                     peak_max = 0.0;
-                                    last_logged_peak_time = timestamp;
+                                    last_logged_peak_time = timestamp_ms;
                                 }
                             }
                         }
@@ -103,7 +103,7 @@ int detect_multi_tap(imu_euler_type velocities, uint32_t timestamp, bool debug)
                             } else {
                                 if (debug) log_debug("rise and fall took %d\n", tap_elapsed_ms);
                                 tap_count++;
-                                pause_start_time = timestamp;
+                                pause_start_time = timestamp_ms;
                                 mt_state = MT_STATE_PAUSE;
                             }
                         }
@@ -111,13 +111,13 @@ int detect_multi_tap(imu_euler_type velocities, uint32_t timestamp, bool debug)
                     }
                     case MT_STATE_PAUSE: {
                         if (fabs(acceleration) < mt_pause_threshold) {
-                            int pause_elapsed_ms = timestamp - pause_start_time;
+                            int pause_elapsed_ms = timestamp_ms - pause_start_time;
                             if (pause_elapsed_ms > min_pause_ms)
                                 // paused long enough, wrap back around to idle where we can detect the next rise
                                 mt_state = MT_STATE_IDLE;
                         } else {
                             // not idle, reset pause state timer
-                            pause_start_time = timestamp;
+                            pause_start_time = timestamp_ms;
                         }
                     }
                 }
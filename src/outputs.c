@@ -9,6 +9,11 @@
 #include "outputs.h"
 #include "plugins.h"
 #include "plugins/gamescope_reshade_wayland.h"
+#include "pose_notify.h"
+#include "pose_prediction.h"
+#include "pose_shm.h"
+#include "pose_stats.h"
+#include "pose_stream.h"
 #include "runtime_context.h"
 #include "strings.h"
 #include "epoch.h"
@@ -29,19 +34,48 @@
 
 imu_buffer_type *imu_buffer;
 
-static int last_imu_checkpoint_ms = 0;
+static uint64_t last_imu_checkpoint_ns = 0;
 static imu_quat_type last_imu_checkpoint_quat = {.x = 0.0f, .y = 0.0f, .z = 0.0f, .w = 1.0f};
-static uint64_t last_healthy_imu_timestamp_ms = 0;
+static uint64_t last_healthy_imu_timestamp_ns = 0;
 
 // Cached perceptual threshold for when tiny orientation changes become effectively invisible.
 // Reset on output deinit/reinit.
 static float dead_zone_cached_device_visible_angle_rad = -1.0f;
 static float dead_zone_cached_threshold_visible_angle_rad = -1.0f;
 
+// only touched by the pose pipeline thread, under outputs_mutex
+static pose_predictor_type pose_predictor = {0};
+
+// only touched by the pose pipeline thread, handed to the plugins' handle_pose_data
+static published_pose_type published_pose = {0};
+
+// set when reset_pose_data couldn't take the legacy pose values' lock, the next sample retries until it can,
+// unless a new pose has replaced them by then
+static bool legacy_pose_reset_pending = false;
+
 static pthread_mutex_t outputs_mutex = PTHREAD_MUTEX_INITIALIZER;
 struct libevdev* evdev;
 struct libevdev_uinput* uinput;
 
+// One IMU sample's worth of uinput events, up to three axes and the SYN_REPORT, submitted with a single write()
+// rather than one per event.
+#define UINPUT_FRAME_MAX_EVENTS 4
+
+struct uinput_frame_t {
+    struct input_event events[UINPUT_FRAME_MAX_EVENTS];
+    int count;
+};
+
+// joystick values in the last submitted frame, a frame that wouldn't change any of them isn't submitted
+static int uinput_last_abs[3];
+static bool uinput_has_last_abs = false;
+
+// since uinput_stats_window_start_ns, logged once a second with debug_device
+static uint64_t uinput_stats_window_start_ns = 0;
+static uint32_t uinput_stats_writes = 0;
+static uint32_t uinput_stats_events = 0;
+static uint32_t uinput_stats_skipped = 0;
+
 int joystick_debug_imu_cycles;
 int prev_joystick_x = 0;
 int prev_joystick_y = 0;
@@ -58,67 +92,6 @@ static float clampf(float v, float lo, float hi) {
     return v;
 }
 
-static imu_quat_type quat_slerp(imu_quat_type a, imu_quat_type b, float t) {
-    t = clampf(t, 0.0f, 1.0f);
-
-    float dot = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
-    if (dot < 0.0f) {
-        dot = -dot;
-        b.x = -b.x;
-        b.y = -b.y;
-        b.z = -b.z;
-        b.w = -b.w;
-    }
-
-    // When the quaternions are very close, fall back to lerp to avoid numeric issues.
-    if (dot > 0.9995f) {
-        imu_quat_type out = {
-            .x = a.x + (b.x - a.x) * t,
-            .y = a.y + (b.y - a.y) * t,
-            .z = a.z + (b.z - a.z) * t,
-            .w = a.w + (b.w - a.w) * t,
-        };
-        float len = sqrtf(out.x * out.x + out.y * out.y + out.z * out.z + out.w * out.w);
-        if (len > 0.0f) {
-            out.x /= len;
-            out.y /= len;
-            out.z /= len;
-            out.w /= len;
-        }
-        return out;
-    }
-
-    dot = clampf(dot, -1.0f, 1.0f);
-    float theta_0 = acosf(dot);
-    float sin_theta_0 = sinf(theta_0);
-    if (sin_theta_0 <= 0.0f) {
-        return b;
-    }
-
-    float theta = theta_0 * t;
-    float sin_theta = sinf(theta);
-
-    float s0 = cosf(theta) - dot * sin_theta / sin_theta_0;
-    float s1 = sin_theta / sin_theta_0;
-
-    imu_quat_type out = {
-        .x = (s0 * a.x) + (s1 * b.x),
-        .y = (s0 * a.y) + (s1 * b.y),
-        .z = (s0 * a.z) + (s1 * b.z),
-        .w = (s0 * a.w) + (s1 * b.w),
-    };
-
-    float len = sqrtf(out.x * out.x + out.y * out.y + out.z * out.z + out.w * out.w);
-    if (len > 0.0f) {
-        out.x /= len;
-        out.y /= len;
-        out.z /= len;
-        out.w /= len;
-    }
-
-    return out;
-}
-
 static float dead_zone_exponential_curve(float ratio01) {
     // Exponential curve with very low values near 0 and a smooth rise towards 1.
     // ratio01 is expected in [0, 1].
@@ -323,6 +296,50 @@ imu_euler_type get_euler_velocities(imu_euler_type* previous, imu_euler_type cur
     return velocities;
 }
 
+static void uinput_frame_add(struct uinput_frame_t *frame, uint16_t type, uint16_t code, int32_t value) {
+    // the kernel stamps the time, same as libevdev_uinput_write_event leaving it zeroed
+    struct input_event *event = &frame->events[frame->count++];
+    memset(event, 0, sizeof(*event));
+    event->type = type;
+    event->code = code;
+    event->value = value;
+}
+
+static void uinput_log_stats(uint64_t now_ns) {
+    if (uinput_stats_window_start_ns == 0) uinput_stats_window_start_ns = now_ns;
+    if (now_ns - uinput_stats_window_start_ns < NS_PER_SEC) return;
+
+    if (config()->debug_device) {
+        float elapsed_s = (float)(now_ns - uinput_stats_window_start_ns) / NS_PER_SEC;
+        log_debug("uinput: %.0f writes/s, %.0f events/s, %.0f unchanged frames/s skipped\n",
+                  uinput_stats_writes / elapsed_s, uinput_stats_events / elapsed_s, uinput_stats_skipped / elapsed_s);
+    }
+
+    uinput_stats_window_start_ns = now_ns;
+    uinput_stats_writes = 0;
+    uinput_stats_events = 0;
+    uinput_stats_skipped = 0;
+}
+
+// Ends the frame with a SYN_REPORT and writes it, or skips it if it has no events (nothing moved).
+static void uinput_frame_submit(struct uinput_frame_t *frame) {
+    if (frame->count == 0) {
+        uinput_stats_skipped++;
+    } else {
+        uinput_frame_add(frame, EV_SYN, SYN_REPORT, 0);
+
+        size_t size = frame->count * sizeof(struct input_event);
+        ssize_t written = write(libevdev_uinput_get_fd(uinput), frame->events, size);
+        if (written != (ssize_t)size)
+            log_debug("uinput write failed: %s\n", written == -1 ? strerror(errno) : "short write");
+
+        uinput_stats_writes++;
+        uinput_stats_events += frame->count;
+    }
+
+    uinput_log_stats(get_monotonic_time_ns());
+}
+
 static void _init_outputs() {
     device_properties_type* device = device_checkout();
     joystick_debug_imu_cycles = device == NULL ? 6 : ceil(100.0 * device->imu_cycles_per_s / 1000.0); // update joystick debug file roughly every 100 ms
@@ -377,10 +394,11 @@ static void _init_outputs() {
     }
     if (config()->mouse_mode || config()->joystick_mode)
         evdev_check("libevdev_uinput_create_from_device", libevdev_uinput_create_from_device(evdev, LIBEVDEV_UINPUT_OPEN_MANAGED, &uinput));
+    uinput_has_last_abs = false;
 }
 
 static void _deinit_outputs() {
-    last_imu_checkpoint_ms = 0;
+    last_imu_checkpoint_ns = 0;
     dead_zone_cached_device_visible_angle_rad = -1.0f;
     dead_zone_cached_threshold_visible_angle_rad = -1.0f;
     if (uinput) {
@@ -412,6 +430,17 @@ void reinit_outputs() {
     pthread_mutex_unlock(&outputs_mutex);
 }
 
+// the consumer-requested look-ahead if there is one, otherwise the device's constant latency, capped either way
+static uint64_t prediction_look_ahead_ns(device_properties_type* device, ipc_values_type *ipc_values) {
+    float look_ahead_ms = *ipc_values->pose_prediction_look_ahead_ms;
+    if (!(look_ahead_ms > 0.0f)) look_ahead_ms = device->look_ahead_constant;
+    if (device->look_ahead_ms_cap > 0.0f && look_ahead_ms > device->look_ahead_ms_cap)
+        look_ahead_ms = device->look_ahead_ms_cap;
+    if (!(look_ahead_ms > 0.0f)) return 0;
+
+    return (uint64_t)(look_ahead_ms * (float)NS_PER_MS);
+}
+
 #define WAIT_FOR_IMU_ATTEMPTS 5
 bool wait_for_imu_start() {
     int attempts = 0;
@@ -423,17 +452,28 @@ bool wait_for_imu_start() {
     return true;
 }
 
+static bool write_legacy_pose_reset(ipc_values_type *ipc_values) {
+    if (!try_lock_pose_ipc_values(ipc_values)) return false;
+
+    memcpy(ipc_values->pose_orientation, pose_orientation_reset_data, sizeof(float) * 16);
+    memcpy(ipc_values->pose_position, pose_position_reset_data, sizeof(float) * 3);
+    memcpy(ipc_values->pose_orientation_predicted, pose_orientation_reset_data, sizeof(float) * 4);
+    memcpy(ipc_values->pose_position_predicted, pose_position_reset_data, sizeof(float) * 3);
+    unlock_pose_ipc_values(ipc_values);
+    return true;
+}
+
 void handle_imu_update(imu_pose_type pose, imu_euler_type velocities, bool imu_calibrated, ipc_values_type *ipc_values) {
     // counter that resets every second, for triggering things that we don't want to do every cycle
     static int imu_counter = 0;
 
     // periodically run checks to keep an eye on the health of the IMU
-    if (pose.timestamp_ms - last_imu_checkpoint_ms > IMU_CHECKPOINT_MS) {
-        last_imu_checkpoint_ms = pose.timestamp_ms;
+    if (pose.timestamp_ns - last_imu_checkpoint_ns > (uint64_t)(IMU_CHECKPOINT_MS) * NS_PER_MS) {
+        last_imu_checkpoint_ns = pose.timestamp_ns;
 
         // in practice, no two quats will be exactly equal even if the glasses are stationary
         if (!quat_equal(pose.orientation, last_imu_checkpoint_quat)) {
-            last_healthy_imu_timestamp_ms = get_epoch_time_ms();
+            last_healthy_imu_timestamp_ns = pose.timestamp_ns;
             last_imu_checkpoint_quat = pose.orientation;
         } else if (config()->debug_device) {
             log_debug("handle_imu_update, device failed health check\n");
@@ -454,7 +494,12 @@ void handle_imu_update(imu_pose_type pose, imu_euler_type velocities, bool imu_c
                 ipc_values->date[1] = (float)(t->tm_mon + 1);
                 ipc_values->date[2] = (float)t->tm_mday;
                 ipc_values->date[3] = (float)(t->tm_hour * 3600 + t->tm_min * 60 + t->tm_sec);
-                set_skippable_gamescope_reshade_effect_uniform_variable("keepalive_date", ipc_values->date, 4, sizeof(float), true);
+                set_gamescope_reshade_keepalive_date(ipc_values->date);
+            }
+
+            if (legacy_pose_reset_pending && write_legacy_pose_reset(ipc_values)) {
+                legacy_pose_reset_pending = false;
+                pose_notify_publish();
             }
 
             if (imu_calibrated) {
@@ -471,9 +516,12 @@ void handle_imu_update(imu_pose_type pose, imu_euler_type velocities, bool imu_c
                     }
                 }
 
-                imu_buffer_response_type *response = push_to_imu_buffer(imu_buffer, pose.orientation, (float)pose.timestamp_ms);
+                pose_predictor_observe(&pose_predictor, pose);
+
+                float imu_payload[IMU_BUFFER_PAYLOAD_SIZE];
+                if (push_to_imu_buffer(imu_buffer, pose.orientation, pose.timestamp_ns, imu_payload)) {
+                    uint64_t stage_start_ns = get_monotonic_time_ns();
 
-                if (response && response->ready) {
                     // Deadzone smoothing: below the configured threshold, slerp towards the new quat.
                     // The closer the angle is to the threshold, the more aggressively we slerp (exponential curve).
                     // Past the threshold, we effectively "snap" (copy) to preserve responsiveness.
@@ -482,8 +530,9 @@ void handle_imu_update(imu_pose_type pose, imu_euler_type velocities, bool imu_c
 
                     static float dead_zone_threshold_deg = 0.0f;
                     static float dead_zone_threshold_rad = 0.0f;
-                    if (config()->dead_zone_threshold_deg != dead_zone_threshold_deg) {
-                        dead_zone_threshold_deg = config()->dead_zone_threshold_deg;
+                    float configured_threshold_deg = config()->dead_zone_threshold_deg;
+                    if (configured_threshold_deg != dead_zone_threshold_deg) {
+                        dead_zone_threshold_deg = configured_threshold_deg;
                         dead_zone_threshold_rad = degree_to_radian(dead_zone_threshold_deg);
                         dead_zone_initialized = false;
                         dead_zone_cached_threshold_visible_angle_rad = -1.0f;
@@ -503,10 +552,10 @@ void handle_imu_update(imu_pose_type pose, imu_euler_type velocities, bool imu_c
                             }
                         }
                         imu_quat_type current_quat = {
-                            .x = response->data[0],
-                            .y = response->data[1],
-                            .z = response->data[2],
-                            .w = response->data[3],
+                            .x = imu_payload[0],
+                            .y = imu_payload[1],
+                            .z = imu_payload[2],
+                            .w = imu_payload[3],
                         };
 
                         if (!dead_zone_initialized) {
@@ -529,31 +578,95 @@ void handle_imu_update(imu_pose_type pose, imu_euler_type velocities, bool imu_c
                         }
 
                         // Overwrite quaternions with smoothed orientation (timestamps left unchanged).
-                        response->data[0] = dead_zone_quat.x;
-                        response->data[1] = dead_zone_quat.y;
-                        response->data[2] = dead_zone_quat.z;
-                        response->data[3] = dead_zone_quat.w;
-                        response->data[4] = dead_zone_quat.x;
-                        response->data[5] = dead_zone_quat.y;
-                        response->data[6] = dead_zone_quat.z;
-                        response->data[7] = dead_zone_quat.w;
-                        response->data[8] = dead_zone_quat.x;
-                        response->data[9] = dead_zone_quat.y;
-                        response->data[10] = dead_zone_quat.z;
-                        response->data[11] = dead_zone_quat.w;
+                        imu_payload[0] = dead_zone_quat.x;
+                        imu_payload[1] = dead_zone_quat.y;
+                        imu_payload[2] = dead_zone_quat.z;
+                        imu_payload[3] = dead_zone_quat.w;
+                        imu_payload[4] = dead_zone_quat.x;
+                        imu_payload[5] = dead_zone_quat.y;
+                        imu_payload[6] = dead_zone_quat.z;
+                        imu_payload[7] = dead_zone_quat.w;
+                        imu_payload[8] = dead_zone_quat.x;
+                        imu_payload[9] = dead_zone_quat.y;
+                        imu_payload[10] = dead_zone_quat.z;
+                        imu_payload[11] = dead_zone_quat.w;
                     }
 
-                    pthread_mutex_lock(ipc_values->pose_orientation_mutex);
-
-                    memcpy(ipc_values->pose_orientation, response->data, sizeof(float) * 16);
-                    memcpy(ipc_values->pose_position, &pose.position, sizeof(float) * 3);
-                    // trigger flush on just the last write
-                    set_skippable_gamescope_reshade_effect_uniform_variable("pose_orientation", ipc_values->pose_orientation, 16, sizeof(float), false);
-                    set_skippable_gamescope_reshade_effect_uniform_variable("pose_position", ipc_values->pose_position, 3, sizeof(float), true);
-
-                    pthread_mutex_unlock(ipc_values->pose_orientation_mutex);
+                    uint64_t stage_end_ns = get_monotonic_time_ns();
+                    pose_stats_record(POSE_STATS_DEAD_ZONE, stage_end_ns - stage_start_ns);
+                    stage_start_ns = stage_end_ns;
+
+                    // predicted from the raw pose, the dead zone would only hold back the motion being extrapolated;
+                    // the predicted rotation (a body-frame delta, see pose_prediction.c) is then applied to the
+                    // published orientation, so consumers extrapolating between the two get a consistent pair
+                    imu_pose_type predicted_pose = pose_predictor_predict(&pose_predictor, pose,
+                                                                          prediction_look_ahead_ns(device, ipc_values));
+                    imu_quat_type published_orientation = {
+                        .x = imu_payload[0],
+                        .y = imu_payload[1],
+                        .z = imu_payload[2],
+                        .w = imu_payload[3]
+                    };
+                    imu_quat_type predicted_delta = multiply_quaternions_unnormalized(conjugate(pose.orientation),
+                                                                                     predicted_pose.orientation);
+                    predicted_pose.orientation = multiply_quaternions(published_orientation, predicted_delta);
+
+                    pose_shm_sample_type sample = {
+                        .timestamp_ns = pose.timestamp_ns,
+                        .flags = pose.has_position ? POSE_SHM_FLAG_HAS_POSITION : 0,
+                        .predicted_timestamp_ns = predicted_pose.timestamp_ns
+                    };
+                    memcpy(sample.orientation, imu_payload, sizeof(sample.orientation));
+                    memcpy(sample.position, &pose.position, sizeof(sample.position));
+                    memcpy(sample.predicted_orientation, &predicted_pose.orientation, sizeof(sample.predicted_orientation));
+                    memcpy(sample.predicted_position, &predicted_pose.position, sizeof(sample.predicted_position));
+                    pose_shm_publish(&sample);
+
+                    int history_size = config()->pose_history_size;
+                    pose_history_entry_type history_entry = {
+                        .host_timestamp_ns = pose.timestamp_ns,
+                        .device_timestamp_ns = pose.device_timestamp_ns,
+                        .flags = sample.flags
+                    };
+                    memcpy(history_entry.orientation, sample.orientation, sizeof(history_entry.orientation));
+                    memcpy(history_entry.position, sample.position, sizeof(history_entry.position));
+                    pose_history_publish(history_size > 0 ? (uint32_t)history_size : 0, &history_entry);
+
+                    memcpy(published_pose.orientation, imu_payload, sizeof(published_pose.orientation));
+                    memcpy(published_pose.position, sample.position, sizeof(published_pose.position));
+
+                    // a reader holding the legacy values' lock just makes this sample skip them, the plugins get
+                    // published_pose either way
+                    if (try_lock_pose_ipc_values(ipc_values)) {
+                        memcpy(ipc_values->pose_orientation, imu_payload, sizeof(float) * 16);
+                        memcpy(ipc_values->pose_position, &pose.position, sizeof(float) * 3);
+                        memcpy(ipc_values->pose_orientation_predicted, sample.predicted_orientation, sizeof(float) * 4);
+                        memcpy(ipc_values->pose_position_predicted, sample.predicted_position, sizeof(float) * 3);
+                        unlock_pose_ipc_values(ipc_values);
+                        legacy_pose_reset_pending = false;
+                    }
+                    pose_notify_publish();
+
+                    pose_stream_sample_type stream_sample = {
+                        .timestamp_ns = pose.timestamp_ns,
+                        .device_timestamp_ns = pose.device_timestamp_ns,
+                        .position = pose.position,
+                        .euler = pose.euler,
+                        .velocity = velocities,
+                        .flags = pose.has_position ? POSE_STREAM_FLAG_HAS_POSITION : 0
+                    };
+                    memcpy(&stream_sample.orientation, sample.orientation, sizeof(stream_sample.orientation));
+                    pose_stream_publish(&stream_sample);
+
+                    gamescope_reshade_pose_uniforms_type gamescope_uniforms;
+                    memcpy(gamescope_uniforms.pose_orientation_predicted, sample.predicted_orientation, sizeof(gamescope_uniforms.pose_orientation_predicted));
+                    memcpy(gamescope_uniforms.pose_position_predicted, sample.predicted_position, sizeof(gamescope_uniforms.pose_position_predicted));
+                    memcpy(gamescope_uniforms.pose_orientation, imu_payload, sizeof(gamescope_uniforms.pose_orientation));
+                    memcpy(gamescope_uniforms.pose_position, sample.position, sizeof(gamescope_uniforms.pose_position));
+                    set_gamescope_reshade_pose_uniforms(&gamescope_uniforms);
+
+                    pose_stats_record(POSE_STATS_SHM_PUBLISH, get_monotonic_time_ns() - stage_start_ns);
                 }
-                free(response);
             }
         }
 
@@ -561,34 +674,46 @@ void handle_imu_update(imu_pose_type pose, imu_euler_type velocities, bool imu_c
         int y_velocity;
         int next_joystick_x;
         int next_joystick_y;
-        bool do_joystick_debug = config()->debug_joystick && (imu_counter % joystick_debug_imu_cycles) == 0;
+        driver_config_type* cfg = config_acquire();
+        bool do_joystick_debug = cfg->debug_joystick && (imu_counter % joystick_debug_imu_cycles) == 0;
         if (uinput || do_joystick_debug) {
             // tracking head movements in euler (roll, pitch, yaw) against 2d joystick/mouse (x,y) coordinates means that yaw
             // maps to horizontal movements (x) and pitch maps to vertical (y) movements. Because the euler values use a NWU
             // coordinate system, positive yaw/pitch values move left/down, respectively, and the mouse/joystick coordinate
             // systems are right-down, so a positive yaw should result in a negative x, and a positive pitch should result in a
             // positive y.
-            x_velocity = config()->vr_lite_invert_x ? velocities.yaw : -velocities.yaw;
-            y_velocity = config()->vr_lite_invert_y ? -velocities.pitch : velocities.pitch;
+            x_velocity = cfg->vr_lite_invert_x ? velocities.yaw : -velocities.yaw;
+            y_velocity = cfg->vr_lite_invert_y ? -velocities.pitch : velocities.pitch;
             next_joystick_x = joystick_value(x_velocity, joystick_max_degrees_per_s);
             next_joystick_y = joystick_value(y_velocity, joystick_max_degrees_per_s);
         }
 
         if (uinput) {
-            if (config()->joystick_mode) {
-                int next_joystick_z = joystick_value(-velocities.roll, joystick_max_degrees_per_s);
-                libevdev_uinput_write_event(uinput, EV_ABS, ABS_RX, next_joystick_x);
-                libevdev_uinput_write_event(uinput, EV_ABS, ABS_RY, next_joystick_y);
-                if (config()->use_roll_axis)
-                    libevdev_uinput_write_event(uinput, EV_ABS, ABS_RZ, next_joystick_z);
-            } else if (config()->mouse_mode) {
+            struct uinput_frame_t frame = { .count = 0 };
+            if (cfg->joystick_mode) {
+                int next_joystick_z = cfg->use_roll_axis ? joystick_value(-velocities.roll, joystick_max_degrees_per_s) : 0;
+
+                // the kernel would drop unchanged absolute values anyway, only the frame's SYN_REPORT would get through
+                if (!uinput_has_last_abs || uinput_last_abs[0] != next_joystick_x ||
+                        uinput_last_abs[1] != next_joystick_y || uinput_last_abs[2] != next_joystick_z) {
+                    uinput_frame_add(&frame, EV_ABS, ABS_RX, next_joystick_x);
+                    uinput_frame_add(&frame, EV_ABS, ABS_RY, next_joystick_y);
+                    if (cfg->use_roll_axis)
+                        uinput_frame_add(&frame, EV_ABS, ABS_RZ, next_joystick_z);
+
+                    uinput_last_abs[0] = next_joystick_x;
+                    uinput_last_abs[1] = next_joystick_y;
+                    uinput_last_abs[2] = next_joystick_z;
+                    uinput_has_last_abs = true;
+                }
+            } else if (cfg->mouse_mode) {
                 // keep track of the remainder (the amount that was lost with round()) for smoothing out mouse movements
                 static float mouse_x_remainder = 0.0;
                 static float mouse_y_remainder = 0.0;
                 static float mouse_z_remainder = 0.0;
 
                 // smooth out the mouse values using the remainders left over from previous writes
-                float mouse_sensitivity_seconds = (float) config()->mouse_sensitivity / device->imu_cycles_per_s;
+                float mouse_sensitivity_seconds = (float) cfg->mouse_sensitivity / device->imu_cycles_per_s;
                 float next_x = x_velocity * mouse_sensitivity_seconds + mouse_x_remainder;
                 int next_x_int = round(next_x);
                 mouse_x_remainder = next_x - next_x_int;
@@ -601,17 +726,19 @@ void handle_imu_update(imu_pose_type pose, imu_euler_type velocities, bool imu_c
                 int next_z_int = round(next_z);
                 mouse_z_remainder = next_z - next_z_int;
 
-                libevdev_uinput_write_event(uinput, EV_REL, REL_X, next_x_int);
-                libevdev_uinput_write_event(uinput, EV_REL, REL_Y, next_y_int);
-                if (config()->use_roll_axis)
-                    libevdev_uinput_write_event(uinput, EV_REL, REL_Z, next_z_int);
-            } else if (!config()->external_mode) {
-                log_error("Unsupported output mode: %s\n", config()->output_mode);
+                // zero deltas are no movement, sub-pixel movement stays in the remainders until it adds up
+                if (next_x_int != 0) uinput_frame_add(&frame, EV_REL, REL_X, next_x_int);
+                if (next_y_int != 0) uinput_frame_add(&frame, EV_REL, REL_Y, next_y_int);
+                if (cfg->use_roll_axis && next_z_int != 0)
+                    uinput_frame_add(&frame, EV_REL, REL_Z, next_z_int);
+            } else if (!cfg->external_mode) {
+                log_error("Unsupported output mode: %s\n", cfg->output_mode);
             }
 
-            if (config()->mouse_mode || config()->joystick_mode)
-                libevdev_uinput_write_event(uinput, EV_SYN, SYN_REPORT, 0);
+            if (cfg->mouse_mode || cfg->joystick_mode)
+                uinput_frame_submit(&frame);
         }
+        config_release();
 
         // always use joystick debugging as it adds a helpful visual
         if (do_joystick_debug)
@@ -620,7 +747,7 @@ void handle_imu_update(imu_pose_type pose, imu_euler_type velocities, bool imu_c
         prev_joystick_x = next_joystick_x;
         prev_joystick_y = next_joystick_y;
 
-        plugins.handle_pose_data(pose, velocities, imu_calibrated, ipc_values);
+        plugins.handle_pose_data(pose, velocities, imu_calibrated, ipc_values ? &published_pose : NULL);
 
         // reset the counter every second
         if ((++imu_counter % device->imu_cycles_per_s) == 0) {
@@ -632,16 +759,31 @@ void handle_imu_update(imu_pose_type pose, imu_euler_type velocities, bool imu_c
 }
 
 void reset_pose_data(ipc_values_type *ipc_values) {
+    pthread_mutex_lock(&outputs_mutex);
+    pose_predictor_reset(&pose_predictor);
+    pthread_mutex_unlock(&outputs_mutex);
+
     if (ipc_values) {    
-        pthread_mutex_lock(ipc_values->pose_orientation_mutex);
-        memcpy(ipc_values->pose_orientation, pose_orientation_reset_data, sizeof(float) * 16);
-        memcpy(ipc_values->pose_position, pose_position_reset_data, sizeof(float) * 3);
-        pthread_mutex_unlock(ipc_values->pose_orientation_mutex);
+        uint64_t now_ns = get_monotonic_time_ns();
+        pose_shm_sample_type sample = {
+            .timestamp_ns = now_ns,
+            .predicted_timestamp_ns = now_ns
+        };
+        memcpy(sample.orientation, pose_orientation_reset_data, sizeof(sample.orientation));
+        memcpy(sample.position, pose_position_reset_data, sizeof(sample.position));
+        memcpy(sample.predicted_orientation, pose_orientation_reset_data, sizeof(sample.predicted_orientation));
+        memcpy(sample.predicted_position, pose_position_reset_data, sizeof(sample.predicted_position));
+        pose_shm_publish(&sample);
+
+        memcpy(published_pose.orientation, pose_orientation_reset_data, sizeof(published_pose.orientation));
+        memcpy(published_pose.position, pose_position_reset_data, sizeof(published_pose.position));
+        legacy_pose_reset_pending = !write_legacy_pose_reset(ipc_values);
+        pose_notify_publish();
     }
 
     plugins.reset_pose_data();
 }
 
 bool is_imu_alive() {
-    return get_epoch_time_ms() - last_healthy_imu_timestamp_ms < MS_PER_SEC;
+    return get_monotonic_time_ns() - last_healthy_imu_timestamp_ns < NS_PER_SEC;
 }
\ No newline at end of file
@@ -1,3 +1,5 @@
+#include "epoch.h"
+#include "hazard_pointer.h"
 #include "logging.h"
 #include "plugins.h"
 #include "plugins/custom_banner.h"
@@ -11,11 +13,14 @@
 #include "plugins/neck_saver.h"
 #include "plugins/opentrack_source.h"
 #include "plugins/opentrack_listener.h"
+#include "pose_stats.h"
 #include "state.h"
 
+#include <stdatomic.h>
 #include <stdlib.h>
 
 #define PLUGIN_COUNT 11
+_Static_assert(PLUGIN_COUNT <= POSE_STATS_MAX_PLUGINS, "not enough pose stats stages for every plugin");
 const plugin_type* all_plugins[PLUGIN_COUNT] = {
     &device_license_plugin,
     &virtual_display_plugin,
@@ -30,12 +35,125 @@ const plugin_type* all_plugins[PLUGIN_COUNT] = {
     &opentrack_listener_plugin
 };
 
+// Dense arrays of just the per-sample hooks that active plugins implement, in plugin order. Only the pose
+// pipeline thread calls these hooks, so only it reads or rebuilds the plan; other threads just mark it dirty.
+struct hook_plan_t {
+    int modify_reference_pose_count;
+    modify_reference_pose_func modify_reference_pose[PLUGIN_COUNT];
+
+    int modify_pose_count;
+    modify_pose_func modify_pose[PLUGIN_COUNT];
+
+    int handle_pose_data_count;
+    handle_pose_data_func handle_pose_data[PLUGIN_COUNT];
+    int handle_pose_data_plugin[PLUGIN_COUNT];
+};
+
+static struct hook_plan_t hook_plan;
+static atomic_bool hook_plan_dirty = ATOMIC_VAR_INIT(true);
+
+// Plugin hooks may dispatch to all plugins again, e.g. smooth follow's modify_reference_pose calls
+// plugins.modify_pose. Only the outermost dispatch counts for config protection and rebuilding the plan.
+static _Thread_local int dispatch_depth = 0;
+
+void plugins_invalidate_hook_plan() {
+    atomic_store_explicit(&hook_plan_dirty, true, memory_order_release);
+}
+
+static void rebuild_hook_plan() {
+    struct hook_plan_t plan = {0};
+    for (int i = 0; i < PLUGIN_COUNT; i++) {
+        const plugin_type* plugin = all_plugins[i];
+        if (plugin->is_active != NULL && !plugin->is_active()) continue;
+
+        if (plugin->modify_reference_pose != NULL)
+            plan.modify_reference_pose[plan.modify_reference_pose_count++] = plugin->modify_reference_pose;
+        if (plugin->modify_pose != NULL)
+            plan.modify_pose[plan.modify_pose_count++] = plugin->modify_pose;
+        if (plugin->handle_pose_data != NULL) {
+            plan.handle_pose_data_plugin[plan.handle_pose_data_count] = i;
+            plan.handle_pose_data[plan.handle_pose_data_count++] = plugin->handle_pose_data;
+        }
+    }
+    hook_plan = plan;
+}
+
+// Must be called after plugins_protect_configs. A nested dispatch keeps using the plan as it is, since an outer
+// one may be iterating it; the rebuild then happens at the next outermost dispatch.
+static inline struct hook_plan_t* current_hook_plan() {
+    // the flag is cleared before rebuilding, so an invalidation that races with the rebuild triggers another
+    if (dispatch_depth == 1 && atomic_load_explicit(&hook_plan_dirty, memory_order_relaxed) &&
+        atomic_exchange_explicit(&hook_plan_dirty, false, memory_order_acquire)) rebuild_hook_plan();
+    return &hook_plan;
+}
+
+// Plugins replace their configs in set_config while other threads are running their hooks. Every dispatch
+// below protects the config generation that's current when it starts, and configs replaced during a
+// set_config are freed along with the generation that was current until then, so only once every dispatch
+// that could have loaded them has returned.
+struct retired_config_t {
+    void* config;
+    hazard_pointer_free_func free_func;
+    struct retired_config_t* next;
+};
+
+struct config_generation_t {
+    struct retired_config_t* retired;
+};
+
+static struct config_generation_t first_config_generation = {0};
+static struct config_generation_t * _Atomic config_generation = &first_config_generation;
+
+// only touched by set_config, which runs on one thread at a time
+static struct retired_config_t* pending_retired_configs = NULL;
+
+void plugins_protect_configs() {
+    if (dispatch_depth++ == 0)
+        hazard_pointer_protect(HAZARD_SLOT_PLUGIN_CONFIGS, (void * _Atomic *)&config_generation);
+}
+
+void plugins_release_configs() {
+    if (--dispatch_depth == 0) hazard_pointer_clear(HAZARD_SLOT_PLUGIN_CONFIGS);
+}
+
+static void free_config_generation(void* ptr) {
+    struct config_generation_t* generation = (struct config_generation_t*)ptr;
+    struct retired_config_t* retired = generation->retired;
+    while (retired != NULL) {
+        struct retired_config_t* next = retired->next;
+        retired->free_func(retired->config);
+        free(retired);
+        retired = next;
+    }
+
+    if (generation != &first_config_generation) free(generation);
+    else generation->retired = NULL;
+}
+
+void plugins_retire_config(void* config, hazard_pointer_free_func free_func) {
+    if (config == NULL) return;
+
+    struct retired_config_t* retired = malloc(sizeof(struct retired_config_t));
+    if (retired == NULL) {
+        log_error("Error allocating retired config\n");
+        exit(1);
+    }
+    retired->config = config;
+    retired->free_func = free_func;
+    retired->next = pending_retired_configs;
+    pending_retired_configs = retired;
+}
 
 void all_plugins_start_func() {
+    plugins_protect_configs();
     for (int i = 0; i < PLUGIN_COUNT; i++) {
+        if (all_plugins[i]->handle_pose_data != NULL)
+            pose_stats_set_stage_name(POSE_STATS_PLUGIN_FIRST + i, all_plugins[i]->id);
+
         if (all_plugins[i]->start == NULL) continue;
         all_plugins[i]->start();
     }
+    plugins_release_configs();
 }
 void* all_plugins_default_config_func() {
     void** configs = calloc(PLUGIN_COUNT, sizeof(void*));
@@ -54,19 +172,35 @@ void all_plugins_handle_config_line_func(void* config, char* key, char* value) {
     }
 }
 void all_plugins_handle_control_flag_line_func(char* key, char* value) {
+    plugins_protect_configs();
     for (int i = 0; i < PLUGIN_COUNT; i++) {
         if (all_plugins[i]->handle_control_flag_line == NULL) continue;
         all_plugins[i]->handle_control_flag_line(key, value);
     }
+    plugins_release_configs();
 }
 void all_plugins_set_config_func(void* config) {
+    struct config_generation_t* next_generation = calloc(1, sizeof(struct config_generation_t));
+    if (next_generation == NULL) {
+        log_error("Error allocating config generation\n");
+        exit(1);
+    }
+
     void **configs = (void**)config;
     for (int i = 0; i < PLUGIN_COUNT; i++) {
         if (all_plugins[i]->set_config == NULL) continue;
         all_plugins[i]->set_config(configs[i]);
     }
+    plugins_invalidate_hook_plan();
+
+    // the new configs are all in place, dispatches that start from here on can't load the replaced ones
+    struct config_generation_t* previous_generation = atomic_exchange(&config_generation, next_generation);
+    previous_generation->retired = pending_retired_configs;
+    pending_retired_configs = NULL;
+    hazard_pointer_retire(previous_generation, free_config_generation);
 }
 bool all_plugins_setup_ipc_func() {
+    plugins_protect_configs();
     for (int i = 0; i < PLUGIN_COUNT; i++) {
         if (all_plugins[i]->setup_ipc == NULL) continue;
         if (!all_plugins[i]->setup_ipc()) {
@@ -74,67 +208,96 @@ bool all_plugins_setup_ipc_func() {
             exit(1);
         }
     }
+    plugins_invalidate_hook_plan();
+    plugins_release_configs();
 
     return true;
 }
 void all_plugins_handle_ipc_change_func() {
+    plugins_protect_configs();
     for (int i = 0; i < PLUGIN_COUNT; i++) {
         if (all_plugins[i]->handle_ipc_change == NULL) continue;
         all_plugins[i]->handle_ipc_change();
     }
+    plugins_invalidate_hook_plan();
+    plugins_release_configs();
 }
 bool all_plugins_modify_reference_pose_func(imu_pose_type pose, imu_pose_type* ref_pose) {
+    plugins_protect_configs();
+    struct hook_plan_t* plan = current_hook_plan();
     bool modified = false;
-    for (int i = 0; i < PLUGIN_COUNT; i++) {
-        if (all_plugins[i]->modify_reference_pose == NULL) continue;
-        modified |= all_plugins[i]->modify_reference_pose(pose, ref_pose);
+    for (int i = 0; i < plan->modify_reference_pose_count; i++) {
+        modified |= plan->modify_reference_pose[i](pose, ref_pose);
     }
+    plugins_release_configs();
     return modified;
 }
 
 void all_plugins_handle_reference_pose_updated_func(imu_pose_type old_reference_pose, imu_pose_type new_reference_pose) {
+    plugins_protect_configs();
     for (int i = 0; i < PLUGIN_COUNT; i++) {
         if (all_plugins[i]->handle_reference_pose_updated == NULL) continue;
         all_plugins[i]->handle_reference_pose_updated(old_reference_pose, new_reference_pose);
     }
+    plugins_release_configs();
 }
 
 void all_plugins_modify_pose_func(imu_pose_type* pose) {
-    for (int i = 0; i < PLUGIN_COUNT; i++) {
-        if (all_plugins[i]->modify_pose == NULL) continue;
-        all_plugins[i]->modify_pose(pose);
+    plugins_protect_configs();
+    struct hook_plan_t* plan = current_hook_plan();
+    for (int i = 0; i < plan->modify_pose_count; i++) {
+        plan->modify_pose[i](pose);
     }
+    plugins_release_configs();
 }
-void all_plugins_handle_pose_data_func(imu_pose_type pose, imu_euler_type velocities, bool imu_calibrated, ipc_values_type *ipc_values) {
-    for (int i = 0; i < PLUGIN_COUNT; i++) {
-        if (all_plugins[i]->handle_pose_data == NULL) continue;
-        all_plugins[i]->handle_pose_data(pose, velocities, imu_calibrated, ipc_values);
+void all_plugins_handle_pose_data_func(imu_pose_type pose, imu_euler_type velocities, bool imu_calibrated, const published_pose_type *published) {
+    plugins_protect_configs();
+    struct hook_plan_t* plan = current_hook_plan();
+    uint64_t stage_start_ns = get_monotonic_time_ns();
+    for (int i = 0; i < plan->handle_pose_data_count; i++) {
+        plan->handle_pose_data[i](pose, velocities, imu_calibrated, published);
+
+        uint64_t stage_end_ns = get_monotonic_time_ns();
+        pose_stats_record(POSE_STATS_PLUGIN_FIRST + plan->handle_pose_data_plugin[i], stage_end_ns - stage_start_ns);
+        stage_start_ns = stage_end_ns;
     }
+    plugins_release_configs();
 }
 
 void all_plugins_reset_pose_data_func() {
+    plugins_protect_configs();
     for (int i = 0; i < PLUGIN_COUNT; i++) {
         if (all_plugins[i]->reset_pose_data == NULL) continue;
         all_plugins[i]->reset_pose_data();
     }
+    plugins_release_configs();
 }
 void all_plugins_handle_state_func() {
+    plugins_protect_configs();
     for (int i = 0; i < PLUGIN_COUNT; i++) {
         if (all_plugins[i]->handle_state == NULL) continue;
         all_plugins[i]->handle_state();
     }
+    plugins_invalidate_hook_plan();
+    plugins_release_configs();
 }
 void all_plugins_handle_device_connect_func() {
+    plugins_protect_configs();
     for (int i = 0; i < PLUGIN_COUNT; i++) {
         if (all_plugins[i]->handle_device_connect == NULL) continue;
         all_plugins[i]->handle_device_connect();
     }
+    plugins_invalidate_hook_plan();
+    plugins_release_configs();
 }
 void all_plugins_handle_device_disconnect_func() {
+    plugins_protect_configs();
     for (int i = 0; i < PLUGIN_COUNT; i++) {
         if (all_plugins[i]->handle_device_disconnect == NULL) continue;
         all_plugins[i]->handle_device_disconnect();
     }
+    plugins_invalidate_hook_plan();
+    plugins_release_configs();
 }
 
 const plugin_type plugins = {
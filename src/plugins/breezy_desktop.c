@@ -12,6 +12,7 @@
 #include <inttypes.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
@@ -22,15 +23,14 @@
 #include <sys/mman.h>
 #include <pthread.h>
 
-#define BREEZY_DESKTOP_FD_RESET -2
-
 const char* shared_mem_directory = "/dev/shm";
 const char* shared_mem_filename = "breezy_desktop_imu";
 const int breezy_desktop_feature_count = 1;
 static bool has_started = false;
 static pthread_mutex_t file_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-static int fd = BREEZY_DESKTOP_FD_RESET;
+// the whole shared file, mapped on first use and unmapped on device connect so it's re-opened
+static uint8_t* shared_mem = NULL;
 static pthread_once_t shared_mem_path_once = PTHREAD_ONCE_INIT;
 
 #define NUM_ORIENTATION_VALUES 16
@@ -80,35 +80,55 @@ void breezy_desktop_handle_config_line_func(void* config, char* key, char* value
     }
 };
 
-const uint8_t DATA_LAYOUT_VERSION = 5;
+const uint8_t DATA_LAYOUT_VERSION = 7;
 #define BOOL_TRUE 1
 #define BOOL_FALSE 0
 
-// IMU data is written more frequently, so we need to know the offset in the file
-const int CONFIG_DATA_END_OFFSET =
-    sizeof(uint8_t) + // version
-    sizeof(uint8_t) + // enabled
-    sizeof(float) * 4 + // look_ahead_cfg
-    sizeof(uint32_t) * 2 + // display_res
-    sizeof(float) + // fov
-    sizeof(float) + // lens_distance_ratio
-    sizeof(uint8_t) + // sbs_enabled
-    sizeof(uint8_t); // custom_banner_enabled
-
-const int IMU_RECORD_SIZE =
-    sizeof(uint8_t) + // smooth_follow_enabled
-    sizeof(float) * NUM_ORIENTATION_VALUES + // smooth_follow_origin (4 quaternion rows, 4 values each)
-    sizeof(float) * NUM_POSITION_VALUES + // pose_position
-    sizeof(uint64_t) + // imu_date_ms
-    sizeof(float) * NUM_ORIENTATION_VALUES + // pose_orientation (4 quaternion rows, 4 values each)
-    sizeof(uint8_t); // imu_parity_byte
-
-uint64_t last_config_write_ts = 0;
-
-// https://stackoverflow.com/a/12340725
-static int fd_is_valid(int fd) {
-    return fd >= 0 && (fcntl(fd, F_GETFD) != -1 || errno != EBADF);
-}
+#define FIELD_COUNT 13
+#define ALIGN_UP(offset, alignment) (((offset) + (alignment) - 1) / (alignment) * (alignment))
+
+// Offsets of everything in the file, published to readers through the field table (see
+// plugins/breezy_desktop.h). The config block is rewritten as a whole, the IMU record is written far more
+// often so it starts on its own cache line.
+enum {
+    CONFIG_ENABLED_OFFSET = BREEZY_DESKTOP_HEADER_TABLE_OFFSET + FIELD_COUNT * sizeof(breezy_desktop_field_entry_type),
+    CONFIG_LOOK_AHEAD_CFG_OFFSET = ALIGN_UP(CONFIG_ENABLED_OFFSET + sizeof(uint8_t), sizeof(float)),
+    CONFIG_DISPLAY_RES_OFFSET = CONFIG_LOOK_AHEAD_CFG_OFFSET + sizeof(float) * 4,
+    CONFIG_FOV_OFFSET = CONFIG_DISPLAY_RES_OFFSET + sizeof(uint32_t) * 2,
+    CONFIG_LENS_DISTANCE_RATIO_OFFSET = CONFIG_FOV_OFFSET + sizeof(float),
+    CONFIG_SBS_ENABLED_OFFSET = CONFIG_LENS_DISTANCE_RATIO_OFFSET + sizeof(float),
+    CONFIG_CUSTOM_BANNER_ENABLED_OFFSET = CONFIG_SBS_ENABLED_OFFSET + sizeof(uint8_t),
+    CONFIG_DATA_END_OFFSET = CONFIG_CUSTOM_BANNER_ENABLED_OFFSET + sizeof(uint8_t),
+
+    // a reader that only wants the latest orientation gets it, and the sequence guarding it, in one cache line
+    IMU_SEQUENCE_OFFSET = ALIGN_UP(CONFIG_DATA_END_OFFSET, 64),
+    IMU_POSE_ORIENTATION_OFFSET = IMU_SEQUENCE_OFFSET + sizeof(uint32_t),
+    IMU_POSE_POSITION_OFFSET = IMU_POSE_ORIENTATION_OFFSET + sizeof(float) * NUM_ORIENTATION_VALUES,
+    IMU_DATE_MS_OFFSET = ALIGN_UP(IMU_POSE_POSITION_OFFSET + sizeof(float) * NUM_POSITION_VALUES, sizeof(uint64_t)),
+    IMU_SMOOTH_FOLLOW_ENABLED_OFFSET = IMU_DATE_MS_OFFSET + sizeof(uint64_t),
+    IMU_SMOOTH_FOLLOW_ORIGIN_OFFSET = ALIGN_UP(IMU_SMOOTH_FOLLOW_ENABLED_OFFSET + sizeof(uint8_t), sizeof(float)),
+    DATA_END_OFFSET = IMU_SMOOTH_FOLLOW_ORIGIN_OFFSET + sizeof(float) * NUM_ORIENTATION_VALUES
+};
+
+static const breezy_desktop_field_entry_type field_table[FIELD_COUNT] = {
+    { BREEZY_FIELD_ENABLED, BREEZY_FIELD_TYPE_U8, 0, CONFIG_ENABLED_OFFSET, sizeof(uint8_t) },
+    { BREEZY_FIELD_LOOK_AHEAD_CFG, BREEZY_FIELD_TYPE_F32, 0, CONFIG_LOOK_AHEAD_CFG_OFFSET, sizeof(float) * 4 },
+    { BREEZY_FIELD_DISPLAY_RES, BREEZY_FIELD_TYPE_U32, 0, CONFIG_DISPLAY_RES_OFFSET, sizeof(uint32_t) * 2 },
+    { BREEZY_FIELD_FOV, BREEZY_FIELD_TYPE_F32, 0, CONFIG_FOV_OFFSET, sizeof(float) },
+    { BREEZY_FIELD_LENS_DISTANCE_RATIO, BREEZY_FIELD_TYPE_F32, 0, CONFIG_LENS_DISTANCE_RATIO_OFFSET, sizeof(float) },
+    { BREEZY_FIELD_SBS_ENABLED, BREEZY_FIELD_TYPE_U8, 0, CONFIG_SBS_ENABLED_OFFSET, sizeof(uint8_t) },
+    { BREEZY_FIELD_CUSTOM_BANNER_ENABLED, BREEZY_FIELD_TYPE_U8, 0, CONFIG_CUSTOM_BANNER_ENABLED_OFFSET, sizeof(uint8_t) },
+    { BREEZY_FIELD_IMU_SEQUENCE, BREEZY_FIELD_TYPE_U32, 0, IMU_SEQUENCE_OFFSET, sizeof(uint32_t) },
+    { BREEZY_FIELD_POSE_ORIENTATION, BREEZY_FIELD_TYPE_F32, 0, IMU_POSE_ORIENTATION_OFFSET, sizeof(float) * NUM_ORIENTATION_VALUES },
+    { BREEZY_FIELD_POSE_POSITION, BREEZY_FIELD_TYPE_F32, 0, IMU_POSE_POSITION_OFFSET, sizeof(float) * NUM_POSITION_VALUES },
+    { BREEZY_FIELD_IMU_DATE_MS, BREEZY_FIELD_TYPE_U64, 0, IMU_DATE_MS_OFFSET, sizeof(uint64_t) },
+    { BREEZY_FIELD_SMOOTH_FOLLOW_ENABLED, BREEZY_FIELD_TYPE_U8, 0, IMU_SMOOTH_FOLLOW_ENABLED_OFFSET, sizeof(uint8_t) },
+    { BREEZY_FIELD_SMOOTH_FOLLOW_ORIGIN, BREEZY_FIELD_TYPE_F32, 0, IMU_SMOOTH_FOLLOW_ORIGIN_OFFSET, sizeof(float) * NUM_ORIENTATION_VALUES }
+};
+
+// how often the config block is checked for changes, it's only rewritten if something changed
+#define CONFIG_CHECK_INTERVAL_NS (250 * NS_PER_MS)
+static uint64_t last_config_check_ns = 0;
 
 static char* shared_mem_file_path = NULL;
 static void init_shared_mem_file_path() {
@@ -120,20 +140,10 @@ static char* get_shared_mem_file_path_once() {
     pthread_once(&shared_mem_path_once, init_shared_mem_file_path);
     return shared_mem_file_path;
 }
-static int full_write(int wfd, const void* buf, size_t len) {
-    const uint8_t *p = (const uint8_t*)buf;
-    while (len) {
-        ssize_t n = write(wfd, p, len);
-        if (n < 0) { if (errno == EINTR) continue; return -1; }
-        if (n == 0) { errno = EIO; return -1; }
-        p += (size_t)n; len -= (size_t)n;
-    }
-    return 0;
-}
 
 char* get_shared_mem_file_path() { return get_shared_mem_file_path_once(); }
 
-static off_t expected_file_size() { return (off_t)(CONFIG_DATA_END_OFFSET + IMU_RECORD_SIZE); }
+static off_t expected_file_size() { return (off_t)DATA_END_OFFSET; }
 static int create_or_open_shared_mem_file() {
 #ifndef O_CLOEXEC
 #define O_CLOEXEC 0
@@ -152,120 +162,120 @@ static int create_or_open_shared_mem_file() {
     struct stat st; if (fstat(new_fd, &st) == -1) { log_error("breezy_desktop: fstat failed: %s\n", strerror(errno)); close(new_fd); return -1; }
     off_t want = expected_file_size();
     if (st.st_size != want) {
-        if (ftruncate(new_fd, want) == -1) { log_error("breezy_desktop: ftruncate(%lld) failed: %s\n", (long long)want, strerror(errno)); close(new_fd); return -1; }
-        if (lseek(new_fd, 0, SEEK_SET) != -1) {
-            size_t sz = (size_t)want; uint8_t *zero = calloc(1, sz);
-            if (zero) { if (full_write(new_fd, zero, sz) == -1) log_error("breezy_desktop: zero init write failed: %s\n", strerror(errno)); free(zero);} else log_error("breezy_desktop: calloc zero init failed\n");
-        }
+        // truncating to 0 first zeroes out a file left with a different layout
+        if (ftruncate(new_fd, 0) == -1 || ftruncate(new_fd, want) == -1) { log_error("breezy_desktop: ftruncate(%lld) failed: %s\n", (long long)want, strerror(errno)); close(new_fd); return -1; }
     }
     return new_fd;
 }
-static int get_shared_mem_fd() {
-    if (!fd_is_valid(fd)) fd = BREEZY_DESKTOP_FD_RESET;
-    if (fd == BREEZY_DESKTOP_FD_RESET) {
-        int new_fd = create_or_open_shared_mem_file();
-        if (new_fd != -1) fd = new_fd;
+
+// file_mutex must be held
+static uint8_t* get_shared_mem() {
+    if (shared_mem) return shared_mem;
+
+    int new_fd = create_or_open_shared_mem_file();
+    if (new_fd == -1) return NULL;
+
+    void* mapped = mmap(NULL, (size_t)expected_file_size(), PROT_READ | PROT_WRITE, MAP_SHARED, new_fd, 0);
+    close(new_fd);
+    if (mapped == MAP_FAILED) {
+        log_error("breezy_desktop: mmap failed: %s\n", strerror(errno));
+        return NULL;
     }
-    return fd;
+
+    shared_mem = (uint8_t*)mapped;
+    return shared_mem;
+}
+
+// file_mutex must be held
+static void release_shared_mem() {
+    if (shared_mem) munmap(shared_mem, (size_t)expected_file_size());
+    shared_mem = NULL;
 }
 
-void do_write_config_data(int target_fd) {
+static inline void put_field(uint8_t* buffer, size_t offset, const void* data, size_t size) {
+    memcpy(buffer + offset, data, size);
+}
+
+// file_mutex must be held, and the file mapped
+static void do_write_config_data(uint64_t now_ns) {
     if (!bd_config) bd_config = breezy_desktop_default_config_func();
-    if (lseek(target_fd, 0, SEEK_SET) == -1) {
-        int first_err = errno;
-        if (first_err == EBADF) {
-            // Attempt single reopen and retry
-            fd = BREEZY_DESKTOP_FD_RESET;
-            int new_fd = get_shared_mem_fd();
-            if (new_fd != -1) {
-                target_fd = new_fd;
-                if (lseek(target_fd, 0, SEEK_SET) == -1) {
-                    log_error("lseek config retry failed: %s\n", strerror(errno));
-                    goto error;
-                }
-            } else {
-                log_error("reopen after EBADF failed: %s\n", strerror(first_err));
-                goto error;
-            }
-        } else {
-            log_error("lseek config: %s\n", strerror(first_err));
-            goto error;
-        }
-    }
+
+    // the header and field table are rewritten along with the config, so a file from an older layout is
+    // overwritten as soon as it's mapped; anything not written stays zeroed
+    uint8_t config_data[CONFIG_DATA_END_OFFSET] = {0};
+    uint8_t field_count = FIELD_COUNT;
+    uint8_t entry_size = sizeof(breezy_desktop_field_entry_type);
+    put_field(config_data, 0, &DATA_LAYOUT_VERSION, sizeof(uint8_t));
+    put_field(config_data, BREEZY_DESKTOP_HEADER_FIELD_COUNT_OFFSET, &field_count, sizeof(uint8_t));
+    put_field(config_data, BREEZY_DESKTOP_HEADER_ENTRY_SIZE_OFFSET, &entry_size, sizeof(uint8_t));
+    put_field(config_data, BREEZY_DESKTOP_HEADER_TABLE_OFFSET, field_table, sizeof(field_table));
+
     uint8_t enabled = BOOL_FALSE;
-    if (full_write(target_fd, &DATA_LAYOUT_VERSION, sizeof(uint8_t)) == -1) goto error;
     device_properties_type* device = device_checkout();
     if (device) {
         enabled = (!config()->disabled && bd_config->enabled) ? BOOL_TRUE : BOOL_FALSE;
         float look_ahead_cfg[4] = { device->look_ahead_constant, device->look_ahead_frametime_multiplier, device->look_ahead_scanline_adjust, device->look_ahead_ms_cap };
         int display_res[2] = { device->resolution_w, device->resolution_h };
-        uint8_t sbs_enabled = state()->sbs_mode_enabled ? BOOL_TRUE : BOOL_FALSE;
+        uint8_t sbs_enabled = hot_state()->sbs_mode_enabled ? BOOL_TRUE : BOOL_FALSE;
         uint8_t custom_banner_enabled = (custom_banner_ipc_values && custom_banner_ipc_values->enabled && *custom_banner_ipc_values->enabled) ? BOOL_TRUE : BOOL_FALSE;
-        if (full_write(target_fd, &enabled, sizeof(uint8_t)) == -1) goto error;
-        if (full_write(target_fd, look_ahead_cfg, sizeof(float) * 4) == -1) goto error;
-        if (full_write(target_fd, display_res, sizeof(uint32_t) * 2) == -1) goto error;
-        if (full_write(target_fd, &device->fov, sizeof(float)) == -1) goto error;
-        if (full_write(target_fd, &device->lens_distance_ratio, sizeof(float)) == -1) goto error;
-        if (full_write(target_fd, &sbs_enabled, sizeof(uint8_t)) == -1) goto error;
-        if (full_write(target_fd, &custom_banner_enabled, sizeof(uint8_t)) == -1) goto error;
-    } else {
-        if (full_write(target_fd, &enabled, sizeof(uint8_t)) == -1) goto error;
-        const int remaining = CONFIG_DATA_END_OFFSET - (int)(sizeof(uint8_t) * 2);
-        uint8_t *zero_data = calloc(1, remaining);
-        if (!zero_data) { log_error("breezy_desktop: calloc zero config failed\n"); goto error; }
-        if (full_write(target_fd, zero_data, remaining) == -1) { free(zero_data); goto error; }
-        free(zero_data);
+        put_field(config_data, CONFIG_LOOK_AHEAD_CFG_OFFSET, look_ahead_cfg, sizeof(float) * 4);
+        put_field(config_data, CONFIG_DISPLAY_RES_OFFSET, display_res, sizeof(uint32_t) * 2);
+        put_field(config_data, CONFIG_FOV_OFFSET, &device->fov, sizeof(float));
+        put_field(config_data, CONFIG_LENS_DISTANCE_RATIO_OFFSET, &device->lens_distance_ratio, sizeof(float));
+        put_field(config_data, CONFIG_SBS_ENABLED_OFFSET, &sbs_enabled, sizeof(uint8_t));
+        put_field(config_data, CONFIG_CUSTOM_BANNER_ENABLED_OFFSET, &custom_banner_enabled, sizeof(uint8_t));
     }
+    put_field(config_data, CONFIG_ENABLED_OFFSET, &enabled, sizeof(uint8_t));
     device_checkin(device);
-    last_config_write_ts = get_epoch_time_ms();
-    return;
-error:
-    log_error("breezy_desktop: config write failed: %s\n", strerror(errno));
-    fd = BREEZY_DESKTOP_FD_RESET;
+    last_config_check_ns = now_ns;
+
+    if (memcmp(shared_mem, config_data, sizeof(config_data)) != 0)
+        memcpy(shared_mem, config_data, sizeof(config_data));
 }
 
 void write_config_data() {
-    if (fd_is_valid(fd) || bd_config && bd_config->enabled) {
-        pthread_mutex_lock(&file_mutex);
-        if (!fd_is_valid(fd)) (void)get_shared_mem_fd();
-        if (fd_is_valid(fd)) do_write_config_data(fd);
-        pthread_mutex_unlock(&file_mutex);
+    pthread_mutex_lock(&file_mutex);
+    if (shared_mem || bd_config && bd_config->enabled) {
+        if (get_shared_mem()) do_write_config_data(get_monotonic_time_ns());
     }
+    pthread_mutex_unlock(&file_mutex);
 }
 
-void breezy_desktop_write_pose_data(float *orientation, float *position) {
+// timestamp_ns is the pose's monotonic timestamp, the shared memory gets it as wall-clock epoch ms
+void breezy_desktop_write_pose_data(const float *orientation, const float *position, uint64_t timestamp_ns) {
     pthread_mutex_lock(&file_mutex);
-    int wfd = get_shared_mem_fd();
-    if (wfd != -1) {
-        uint64_t epoch_ms = get_epoch_time_ms();
-        if (last_config_write_ts == 0 || epoch_ms - last_config_write_ts > 250) {
-            do_write_config_data(wfd);
-            if (fd == BREEZY_DESKTOP_FD_RESET) { pthread_mutex_unlock(&file_mutex); return; }
-        }
-        if (lseek(wfd, CONFIG_DATA_END_OFFSET, SEEK_SET) == -1) {
-            log_error("breezy_desktop: lseek imu: %s\n", strerror(errno)); goto imu_error; }
-        uint8_t smooth_follow_enabled = state()->breezy_desktop_smooth_follow_enabled ? BOOL_TRUE : BOOL_FALSE;
-        if (full_write(wfd, &smooth_follow_enabled, sizeof(uint8_t)) == -1) goto imu_error;
-        if (state()->smooth_follow_origin_ready && state()->smooth_follow_origin) {
-            if (full_write(wfd, state()->smooth_follow_origin, sizeof(float) * NUM_ORIENTATION_VALUES) == -1) goto imu_error;
-        } else if (full_write(wfd, orientation, sizeof(float) * NUM_ORIENTATION_VALUES) == -1) goto imu_error;
-        if (full_write(wfd, position, sizeof(float) * NUM_POSITION_VALUES) == -1) goto imu_error;
-        if (full_write(wfd, &epoch_ms, sizeof(uint64_t)) == -1) goto imu_error;
-        if (full_write(wfd, orientation, sizeof(float) * NUM_ORIENTATION_VALUES) == -1) goto imu_error;
-        uint8_t parity = 0; uint8_t* d = (uint8_t*)&epoch_ms; for (size_t i=0;i<sizeof(uint64_t);++i) parity ^= d[i];
-        d = (uint8_t*)orientation; for (size_t i=0;i<sizeof(float)*NUM_ORIENTATION_VALUES;++i) parity ^= d[i];
-        if (full_write(wfd, &parity, sizeof(uint8_t)) == -1) goto imu_error;
-        pthread_mutex_unlock(&file_mutex); return;
+    if (get_shared_mem()) {
+        if (last_config_check_ns == 0 || timestamp_ns - last_config_check_ns > CONFIG_CHECK_INTERVAL_NS)
+            do_write_config_data(timestamp_ns);
+
+        uint64_t epoch_ms = monotonic_to_epoch_ms(timestamp_ns);
+        uint8_t smooth_follow_enabled = hot_state()->breezy_desktop_smooth_follow_enabled ? BOOL_TRUE : BOOL_FALSE;
+        const float* smooth_follow_origin = state()->smooth_follow_origin_ready && state()->smooth_follow_origin ?
+                                            state()->smooth_follow_origin : orientation;
+
+        _Atomic uint32_t* sequence = (_Atomic uint32_t*)(shared_mem + IMU_SEQUENCE_OFFSET);
+        uint32_t start = atomic_load_explicit(sequence, memory_order_relaxed);
+
+        // a previous run may have died partway through a record
+        if (start & 1) start++;
+        atomic_store_explicit(sequence, start + 1, memory_order_relaxed);
+
+        // the odd sequence must be visible before any of the record changes
+        atomic_thread_fence(memory_order_release);
+        put_field(shared_mem, IMU_POSE_ORIENTATION_OFFSET, orientation, sizeof(float) * NUM_ORIENTATION_VALUES);
+        put_field(shared_mem, IMU_POSE_POSITION_OFFSET, position, sizeof(float) * NUM_POSITION_VALUES);
+        put_field(shared_mem, IMU_DATE_MS_OFFSET, &epoch_ms, sizeof(uint64_t));
+        put_field(shared_mem, IMU_SMOOTH_FOLLOW_ENABLED_OFFSET, &smooth_follow_enabled, sizeof(uint8_t));
+        put_field(shared_mem, IMU_SMOOTH_FOLLOW_ORIGIN_OFFSET, smooth_follow_origin, sizeof(float) * NUM_ORIENTATION_VALUES);
+
+        atomic_store_explicit(sequence, start + 2, memory_order_release);
     }
-imu_error:
-    if (errno) log_error("breezy_desktop: imu write failed: %s\n", strerror(errno));
-    if (fd_is_valid(wfd)) { close(wfd); fd = BREEZY_DESKTOP_FD_RESET; }
     pthread_mutex_unlock(&file_mutex);
 }
 
 void breezy_desktop_reset_pose_data_func() {
-    if (fd_is_valid(fd) || bd_config && bd_config->enabled) {
-        breezy_desktop_write_pose_data(&ORIENTATION_RESET[0], &POSITION_RESET[0]);
+    if (shared_mem || bd_config && bd_config->enabled) {
+        breezy_desktop_write_pose_data(&ORIENTATION_RESET[0], &POSITION_RESET[0], get_monotonic_time_ns());
     }
 }
 
@@ -276,20 +286,21 @@ void breezy_desktop_set_config_func(void* new_config) {
     if (bd_config) {
         if (bd_config->enabled != temp_config->enabled)
             log_message("Breezy desktop has been %s\n", temp_config->enabled ? "enabled" : "disabled");
-        free(bd_config);
+        plugins_retire_config(bd_config, free);
     }
     bd_config = temp_config;
     if (has_started) {
         write_config_data();
-        if (state()->calibration_state == CALIBRATING) breezy_desktop_reset_pose_data_func();
+        if (hot_state()->calibration_state == CALIBRATING) breezy_desktop_reset_pose_data_func();
     }
 };
 
-void breezy_desktop_handle_pose_data_func(imu_pose_type pose, imu_euler_type velocities, bool imu_calibrated, ipc_values_type *ipc_values) {
+void breezy_desktop_handle_pose_data_func(imu_pose_type pose, imu_euler_type velocities, bool imu_calibrated, const published_pose_type *published) {
     if (bd_config && bd_config->enabled) {
-        if (imu_calibrated && ipc_values) {
-            breezy_desktop_write_pose_data(ipc_values->pose_orientation, 
-                is_productivity_pro_granted() ? ipc_values->pose_position : &POSITION_RESET[0]);
+        if (imu_calibrated && published) {
+            breezy_desktop_write_pose_data(published->orientation, 
+                is_productivity_pro_granted() ? published->position : &POSITION_RESET[0],
+                pose.timestamp_ns);
         } else {
             breezy_desktop_reset_pose_data_func();
         }
@@ -302,14 +313,17 @@ void breezy_desktop_start_func() {
 
 void breezy_desktop_device_connect_func() {
     pthread_mutex_lock(&file_mutex);
-    if (fd_is_valid(fd)) close(fd);
-    fd = BREEZY_DESKTOP_FD_RESET;
+    release_shared_mem();
     pthread_mutex_unlock(&file_mutex);
     has_started = true;
     write_config_data();
     breezy_desktop_reset_pose_data_func();
 }
 
+bool breezy_desktop_is_active_func() {
+    return bd_config && bd_config->enabled;
+}
+
 const plugin_type breezy_desktop_plugin = {
     .id = "breezy_desktop",
     .start = breezy_desktop_start_func,
@@ -319,5 +333,6 @@ const plugin_type breezy_desktop_plugin = {
     .handle_pose_data = breezy_desktop_handle_pose_data_func,
     .reset_pose_data = breezy_desktop_reset_pose_data_func,
     .handle_device_disconnect = write_config_data,
-    .handle_device_connect = breezy_desktop_device_connect_func
+    .handle_device_connect = breezy_desktop_device_connect_func,
+    .is_active = breezy_desktop_is_active_func
 };
\ No newline at end of file
@@ -3,16 +3,25 @@
 #include "imu.h"
 #include "logging.h"
 #include "plugins/gamescope_reshade_wayland.h"
+#include "pose_stats.h"
 #include "runtime_context.h"
 #include "strings.h"
 #include "wl_client/gamescope_reshade.h"
 
 #include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <unistd.h>
+#include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <time.h>
 
 /**
  * The wayland-client library may not be present, so we create a weak reference to wl_proxy_create just
@@ -28,6 +37,14 @@ __attribute__((weak)) struct wl_proxy *wl_proxy_create(struct wl_proxy *factory,
 #define GAMESCOPE_RESHADE_EFFECT_PATH "reshade/Shaders/" GAMESCOPE_RESHADE_EFFECT_FILE
 #define GAMESCOPE_RESHADE_WAIT_TIME_MS 500
 
+// gamescope's wayland socket, in $XDG_RUNTIME_DIR
+#define GAMESCOPE_WAYLAND_DISPLAY "gamescope-0"
+
+// gamescope creates its socket file a moment before it starts listening on it, connecting right after the file
+// shows up can be refused
+#define GAMESCOPE_CONNECT_RETRY_MS 100
+#define GAMESCOPE_CONNECT_RETRIES 10
+
 static gamescope_reshade_wayland_config *gamescope_config;
 static struct wl_display *display = NULL;
 static struct wl_registry *registry = NULL;
@@ -35,11 +52,15 @@ static struct gamescope_reshade *reshade_object = NULL;
 static gamescope_reshade_effect_ready_callback effect_ready_callback = NULL;
 static uint64_t gamescope_reshade_effect_request_time = 0;
 static bool gamescope_reshade_ipc_connected = false;
+
+// whether the effect is currently turned on, it stays loaded (and the connection open) while it's off
+static bool gamescope_reshade_effect_enabled = false;
 static pthread_mutex_t wayland_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 void *gamescope_reshade_wayland_default_config_func() {
     gamescope_reshade_wayland_config *config = calloc(1, sizeof(gamescope_reshade_wayland_config));
     config->disabled = false;
+    config->pace_to_refresh = false;
 
     return config;
 };
@@ -49,6 +70,8 @@ void gamescope_reshade_wayland_handle_config_line_func(void* config, char* key,
 
     if (equal(key, "gamescope_reshade_wayland_disabled")) {
         boolean_config(key, value, &temp_config->disabled);
+    } else if (equal(key, "gamescope_reshade_wayland_pace_to_refresh")) {
+        boolean_config(key, value, &temp_config->pace_to_refresh);
     }
 };
 
@@ -59,8 +82,11 @@ void gamescope_reshade_wayland_set_config_func(void* config) {
     if (gamescope_config) {
         if (gamescope_config->disabled != temp_config->disabled)
             log_message("Gamescope ReShade integration has been %s\n", temp_config->disabled ? "disabled" : "enabled");
+        if (gamescope_config->pace_to_refresh != temp_config->pace_to_refresh)
+            log_message("Gamescope pose pacing to the display refresh rate has been %s\n",
+                        temp_config->pace_to_refresh ? "enabled" : "disabled");
 
-        free(gamescope_config);
+        plugins_retire_config(gamescope_config, free);
     }
     gamescope_config = temp_config;
 };
@@ -90,8 +116,12 @@ bool is_gamescope_reshade_ipc_connected() {
     return gamescope_reshade_ipc_connected;
 }
 
+static void do_reset_uniform_cache();
+
 static void do_wl_server_disconnect() {
     gamescope_reshade_ipc_connected = false;
+    gamescope_reshade_effect_enabled = false;
+    do_reset_uniform_cache();
     if (config()->debug_ipc) log_debug("gamescope_reshade_wl_server_disconnect\n");
     if (effect_ready_callback) effect_ready_callback = NULL;
     if (reshade_object) {
@@ -119,7 +149,7 @@ static bool do_wl_server_connect() {
         return false;
     }
 
-    if (!display) display = wl_display_connect("gamescope-0");
+    if (!display) display = wl_display_connect(GAMESCOPE_WAYLAND_DISPLAY);
     if (!display) {
         if (config()->debug_ipc) log_debug("gamescope_reshade_wl_server_connect no display\n");
         return false;
@@ -187,6 +217,7 @@ static bool do_wl_enable_gamescope_effect() {
     if (config()->debug_ipc) log_debug("enable_gamescope_effect\n");
     gamescope_reshade_enable_effect(reshade_object);
     wl_display_flush(display);
+    gamescope_reshade_effect_enabled = true;
     return true;
 }
 
@@ -196,6 +227,7 @@ static bool do_wl_disable_gamescope_effect() {
     if (config()->debug_ipc) log_debug("disable_gamescope_effect\n");
     gamescope_reshade_disable_effect(reshade_object);
     wl_display_flush(display);
+    gamescope_reshade_effect_enabled = false;
     
     return true;
 }
@@ -231,49 +263,180 @@ static void do_wl_cleanup() {
     gamescope_reshade_effect_request_time = 0;
 }
 
-static void wayland_cleanup() {
-    if (config()->debug_ipc) log_debug("wayland_cleanup\n");
+// Only turns the effect off, the connection and the loaded effect are kept for when the device comes back, so a
+// replug doesn't have to wait on gamescope loading the effect again.
+static void wayland_handle_device_disconnect() {
+    if (config()->debug_ipc) log_debug("wayland_handle_device_disconnect\n");
 
     pthread_mutex_lock(&wayland_mutex);
-    do_wl_cleanup();
+    if (gamescope_reshade_effect_enabled) do_wl_disable_gamescope_effect();
     pthread_mutex_unlock(&wayland_mutex);
 }
 
-static bool do_wl_set_uniform_variable(const char *variable_name, const void *data, int entries, 
-                                       size_t element_size, bool flush) {
-    if (!reshade_object) return false;
+// Last value set for each uniform variable, so only the ones that changed since the last flush get sent, as
+// one batch of requests ahead of the flush. Only touched with uniform_cache_mutex held, which is never held
+// across a wayland call, so setting a uniform from the pose path never waits on a flush or round trip.
+//
+// A value that doesn't fit is dropped rather than sent directly, since that would mean waiting on the wayland
+// mutex. The driver sets 25 uniforms, the largest of them pose_orientation.
+#define UNIFORM_CACHE_SIZE GAMESCOPE_RESHADE_UNIFORM_MAX_COUNT
+#define UNIFORM_NAME_LENGTH 64
+#define UNIFORM_MAX_DATA_SIZE GAMESCOPE_RESHADE_UNIFORM_MAX_SIZE
+
+_Static_assert(UNIFORM_CACHE_SIZE <= 64, "uniform_dirty_mask has one bit per uniform_cache entry");
+_Static_assert(sizeof(((gamescope_reshade_pose_uniforms_type *) 0)->pose_orientation) <= UNIFORM_MAX_DATA_SIZE &&
+               sizeof(((gamescope_reshade_pose_uniforms_type *) 0)->pose_orientation_predicted) <= UNIFORM_MAX_DATA_SIZE,
+               "the pose uniforms must fit the uniform cache");
+
+struct uniform_variable_t {
+    char name[UNIFORM_NAME_LENGTH];
+    size_t size;
+
+    // false until a value's been set since the last connect, nothing's been sent before that
+    bool has_value;
+    uint8_t value[UNIFORM_MAX_DATA_SIZE];
+};
 
-    struct wl_array array;
-    wl_array_init(&array);
-    size_t total_size = entries * element_size;
-    void *array_data = wl_array_add(&array, total_size);
-    if (!array_data) {
-        wl_array_release(&array);
-        return false;
+static pthread_mutex_t uniform_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct uniform_variable_t uniform_cache[UNIFORM_CACHE_SIZE];
+static int uniform_cache_count = 0;
+
+// one bit per uniform_cache entry with a value that hasn't been sent yet
+static uint64_t uniform_dirty_mask = 0;
+
+// the dirty entries copied out of the cache for the sender thread to send, only touched by that thread
+static struct uniform_variable_t uniform_send_batch[UNIFORM_CACHE_SIZE];
+
+// sent since stats_window_start_ns, logged once a second with debug_ipc
+static uint64_t stats_window_start_ns = 0;
+static uint32_t stats_requests = 0;
+static uint32_t stats_bytes = 0;
+static uint32_t stats_flushes = 0;
+
+// poses the sender thread sent, and ones replaced in the mailbox before it got to them
+static uint32_t stats_poses_sent = 0;
+static uint32_t stats_poses_coalesced = 0;
+
+// values from before a disconnect mean nothing to the next connection, everything gets sent again
+static void do_reset_uniform_cache() {
+    pthread_mutex_lock(&uniform_cache_mutex);
+    for (int i = 0; i < uniform_cache_count; i++) uniform_cache[i].has_value = false;
+    uniform_dirty_mask = 0;
+    pthread_mutex_unlock(&uniform_cache_mutex);
+}
+
+// must only be called with uniform_cache_mutex held
+static int find_uniform_variable(const char *variable_name) {
+    for (int i = 0; i < uniform_cache_count; i++) {
+        if (strcmp(uniform_cache[i].name, variable_name) == 0) return i;
     }
-    memcpy(array.data, data, total_size);
 
+    if (uniform_cache_count == UNIFORM_CACHE_SIZE || strlen(variable_name) >= UNIFORM_NAME_LENGTH) return -1;
+
+    struct uniform_variable_t *variable = &uniform_cache[uniform_cache_count];
+    strcpy(variable->name, variable_name);
+    variable->has_value = false;
+    return uniform_cache_count++;
+}
+
+// the array points straight at the caller's data, the request is marshalled before this returns
+static void do_wl_send_uniform_variable(const char *variable_name, const void *data, size_t size) {
+    struct wl_array array = {
+        .size = size,
+        .alloc = size,
+        .data = (void *) data
+    };
     gamescope_reshade_set_uniform_variable(reshade_object, variable_name, &array);
-    wl_array_release(&array);
 
-    if (flush) {
-        int wl_result;
-        if (effect_ready_callback) {
-            // this is a blocking call, so only use it if we're waiting on an event callback
-            wl_result = wl_display_roundtrip(display);
-        } else {
-            wl_result = wl_display_flush(display);
-        }
+    stats_requests++;
+    stats_bytes += size;
+}
 
-        if (wl_result < 0) {
-            log_error("Error %d on gamescope wl_display_flush: %s\n", wl_result, strerror(errno));
-            return false;
-        }
+static void do_log_uniform_stats(uint64_t now_ns) {
+    if (stats_window_start_ns == 0) stats_window_start_ns = now_ns;
+    if (now_ns - stats_window_start_ns < NS_PER_SEC) return;
+
+    if (config()->debug_ipc && stats_flushes > 0) {
+        float elapsed_s = (float)(now_ns - stats_window_start_ns) / NS_PER_SEC;
+        log_debug("gamescope uniforms: %.0f requests/s, %.0f bytes/s, %.0f flushes/s, %.0f poses/s sent, "
+                  "%.0f poses/s coalesced\n", stats_requests / elapsed_s, stats_bytes / elapsed_s,
+                  stats_flushes / elapsed_s, stats_poses_sent / elapsed_s, stats_poses_coalesced / elapsed_s);
     }
-    
+
+    stats_window_start_ns = now_ns;
+    stats_requests = 0;
+    stats_bytes = 0;
+    stats_flushes = 0;
+    stats_poses_sent = 0;
+    stats_poses_coalesced = 0;
+}
+
+// copies the values that haven't been sent yet into uniform_send_batch and returns how many there are
+static int take_dirty_uniform_variables() {
+    pthread_mutex_lock(&uniform_cache_mutex);
+    int count = 0;
+    for (uint64_t dirty = uniform_dirty_mask; dirty; dirty &= dirty - 1)
+        uniform_send_batch[count++] = uniform_cache[__builtin_ctzll(dirty)];
+    uniform_dirty_mask = 0;
+    pthread_mutex_unlock(&uniform_cache_mutex);
+
+    return count;
+}
+
+// sends the first count entries of uniform_send_batch
+static bool do_wl_flush_uniform_variables(int count) {
+    uint64_t flush_start_ns = get_monotonic_time_ns();
+    for (int i = 0; i < count; i++) {
+        struct uniform_variable_t *variable = &uniform_send_batch[i];
+        do_wl_send_uniform_variable(variable->name, variable->value, variable->size);
+    }
+
+    int wl_result;
+    if (effect_ready_callback) {
+        // this is a blocking call, so only use it if we're waiting on an event callback
+        wl_result = wl_display_roundtrip(display);
+    } else {
+        wl_result = wl_display_flush(display);
+    }
+    uint64_t now_ns = get_monotonic_time_ns();
+    pose_stats_record(POSE_STATS_GAMESCOPE_FLUSH, now_ns - flush_start_ns);
+
+    stats_flushes++;
+    do_log_uniform_stats(now_ns);
+
+    if (wl_result < 0) {
+        log_error("Error %d on gamescope wl_display_flush: %s\n", wl_result, strerror(errno));
+        return false;
+    }
+
     return true;
 }
 
+// only records the value, the sender thread sends it with the next flush
+static void set_uniform_variable(const char *variable_name, const void *data, int entries, size_t element_size) {
+    size_t total_size = entries * element_size;
+    pthread_mutex_lock(&uniform_cache_mutex);
+    int index = total_size <= UNIFORM_MAX_DATA_SIZE ? find_uniform_variable(variable_name) : -1;
+    if (index == -1) {
+        pthread_mutex_unlock(&uniform_cache_mutex);
+
+        // only once, most uniforms are set over and over
+        static atomic_bool logged = false;
+        if (!atomic_exchange(&logged, true))
+            log_error("gamescope uniform %s doesn't fit the uniform cache, not sending it\n", variable_name);
+        return;
+    }
+
+    struct uniform_variable_t *variable = &uniform_cache[index];
+    if (!variable->has_value || variable->size != total_size || memcmp(variable->value, data, total_size) != 0) {
+        memcpy(variable->value, data, total_size);
+        variable->size = total_size;
+        variable->has_value = true;
+        uniform_dirty_mask |= 1ULL << index;
+    }
+    pthread_mutex_unlock(&uniform_cache_mutex);
+}
+
 static void _effect_ready_callback(void *data,
                                    struct gamescope_reshade *gamescope_reshade,
                                    const char *effect_path) {
@@ -301,67 +464,355 @@ static void _gamescope_reshade_effect_ready() {
     gamescope_reshade_effect_request_time = 0;
 }
 
+// Latest pose and keepalive date from the pose path, for the sender thread. A seqlock, so the pose path never
+// waits on the sender thread; writers only ever wait on each other, for the length of a memcpy.
+struct pose_mailbox_t {
+    _Alignas(64) _Atomic uint64_t sequence;
+
+    // number of poses and dates ever written, so the sender thread can tell which changed and how many it missed
+    uint64_t pose_count;
+    uint64_t keepalive_date_count;
+    uint64_t pose_handed_over_ns;
+    gamescope_reshade_pose_uniforms_type pose;
+    float keepalive_date[4];
+};
+
+static struct pose_mailbox_t pose_mailbox;
+
+// the pose path only writes to sender_wake_fd while the sender thread says it's about to sleep
+static int sender_wake_fd = -1;
+static atomic_bool sender_thread_waiting = false;
+static atomic_bool flush_requested = false;
+static pthread_t sender_thread;
+
+static void wake_sender_thread() {
+    // Both sides use sequentially consistent operations on the mailbox sequence (or flush_requested) and
+    // sender_thread_waiting: either this sees the thread waiting, or the thread sees the change and doesn't sleep.
+    if (atomic_load(&sender_thread_waiting)) {
+        uint64_t one = 1;
+        if (write(sender_wake_fd, &one, sizeof(one)) == -1 && errno != EAGAIN)
+            log_debug("gamescope sender wake write failed: %s\n", strerror(errno));
+    }
+}
+
+static void pose_mailbox_write_begin() {
+    uint64_t sequence = atomic_load_explicit(&pose_mailbox.sequence, memory_order_relaxed);
+    while ((sequence & 1) ||
+           !atomic_compare_exchange_weak_explicit(&pose_mailbox.sequence, &sequence, sequence + 1,
+                                                  memory_order_acquire, memory_order_relaxed)) {
+        if (sequence & 1) sequence = atomic_load_explicit(&pose_mailbox.sequence, memory_order_relaxed);
+    }
+
+    // the odd sequence must be visible before any of the contents change
+    atomic_thread_fence(memory_order_release);
+}
+
+static void pose_mailbox_write_end() {
+    atomic_fetch_add(&pose_mailbox.sequence, 1);
+    wake_sender_thread();
+}
+
+static bool pose_mailbox_read(uint64_t *sequence, struct pose_mailbox_t *out) {
+    uint64_t before = atomic_load_explicit(&pose_mailbox.sequence, memory_order_acquire);
+    if (before & 1) return false;
+
+    memcpy((char *) out + sizeof(out->sequence), (char *) &pose_mailbox + sizeof(pose_mailbox.sequence),
+           sizeof(pose_mailbox) - sizeof(pose_mailbox.sequence));
+
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&pose_mailbox.sequence, memory_order_relaxed) != before) return false;
+
+    *sequence = before;
+    return true;
+}
+
+void set_gamescope_reshade_pose_uniforms(const gamescope_reshade_pose_uniforms_type *uniforms) {
+    if (!reshade_object || sender_wake_fd == -1) return;
+
+    pose_mailbox_write_begin();
+    pose_mailbox.pose = *uniforms;
+    pose_mailbox.pose_handed_over_ns = get_monotonic_time_ns();
+    pose_mailbox.pose_count++;
+    pose_mailbox_write_end();
+}
+
+void set_gamescope_reshade_keepalive_date(const float date[4]) {
+    if (!reshade_object || sender_wake_fd == -1) return;
+
+    pose_mailbox_write_begin();
+    memcpy(pose_mailbox.keepalive_date, date, sizeof(pose_mailbox.keepalive_date));
+    pose_mailbox.keepalive_date_count++;
+    pose_mailbox_write_end();
+}
+
 void set_gamescope_reshade_effect_uniform_variable(const char *variable_name, const void *data, int entries, 
                                                    size_t element_size, bool flush) {
     if (!reshade_object) return;
 
-    pthread_mutex_lock(&wayland_mutex);
-    bool success = do_wl_set_uniform_variable(variable_name, data, entries, element_size, flush);
-    if (!success && flush) {
+    set_uniform_variable(variable_name, data, entries, element_size);
+
+    if (flush) {
+        atomic_store(&flush_requested, true);
+        wake_sender_thread();
+    }
+}
+
+// must only be called from within the wayland mutex
+static void do_check_effect_ready_timeout() {
+    if (gamescope_reshade_effect_request_time != 0 && 
+            get_epoch_time_ms() - gamescope_reshade_effect_request_time > 
+            GAMESCOPE_RESHADE_WAIT_TIME_MS) {
+        log_error("gamescope effect_ready event never received, falling back to shared memory IPC\n");
         do_wl_cleanup();
     }
-    pthread_mutex_unlock(&wayland_mutex);
 }
 
-void set_skippable_gamescope_reshade_effect_uniform_variable(const char *variable_name, const void *data, 
-                                                             int entries, size_t element_size, bool flush) {
-    // if already locked, just skip this call
-    if (!reshade_object || pthread_mutex_trylock(&wayland_mutex) != 0) return;
+// Connects and turns the effect on while there's a device to show it for. When the device goes away the effect is
+// only turned off, the connection is only closed if the integration is disabled or the effect file goes away (or
+// gamescope does). Must only be called from within the wayland mutex, returns whether gamescope is connected.
+static bool do_wl_update_connection() {
+    if (gamescope_config->disabled || !sombrero_file_exists()) {
+        if (gamescope_reshade_ipc_connected) do_wl_cleanup();
+        return false;
+    }
 
-    bool success = do_wl_set_uniform_variable(variable_name, data, entries, element_size, flush);
-    if (!success && flush) {
-        do_wl_cleanup();
+    if (!device_present()) {
+        if (gamescope_reshade_effect_enabled) do_wl_disable_gamescope_effect();
+        return gamescope_reshade_ipc_connected;
     }
-    pthread_mutex_unlock(&wayland_mutex);
+
+    if (!gamescope_reshade_ipc_connected) {
+        do_wl_server_connect();
+        if (gamescope_reshade_ipc_connected) {
+            if (config()->debug_ipc) log_debug("gamescope_reshade_wl_update_connection connected to gamescope\n");
+            state()->is_gamescope_reshade_ipc_connected = true;
+
+            do_trigger_plugins_ipc_change();
+
+            do_wl_add_gamescope_effect_ready_listener(_gamescope_reshade_effect_ready);
+            do_wl_enable_gamescope_effect();
+        }
+    } else if (!gamescope_reshade_effect_enabled) {
+        // still connected from before the device went away, the effect is already loaded
+        if (config()->debug_ipc) log_debug("gamescope_reshade_wl_update_connection re-enabling effect\n");
+        state()->is_gamescope_reshade_ipc_connected = true;
+
+        do_trigger_plugins_ipc_change();
+
+        // connected but never heard back about the effect, e.g. connected from setup_ipc
+        if (gamescope_reshade_effect_request_time != 0 && !effect_ready_callback)
+            do_wl_add_gamescope_effect_ready_listener(_gamescope_reshade_effect_ready);
+        do_wl_enable_gamescope_effect();
+    }
+
+    return gamescope_reshade_ipc_connected;
 }
 
-void gamescope_reshade_wl_handle_state_func() {
-    pthread_mutex_lock(&wayland_mutex);
-    if (device_present() && sombrero_file_exists() && !gamescope_config->disabled) {
-        if (!gamescope_reshade_ipc_connected) {
-            do_wl_server_connect();
-            if (gamescope_reshade_ipc_connected) {
-                if (config()->debug_ipc) log_debug("gamescope_reshade_wl_handle_state_func connected to gamescope\n");
-                state()->is_gamescope_reshade_ipc_connected = true;
+// watches $XDG_RUNTIME_DIR for gamescope's socket, -1 if there's no runtime dir to watch
+static int watch_gamescope_socket() {
+    const char *runtime_dir = getenv("XDG_RUNTIME_DIR");
+    if (!runtime_dir) return -1;
+
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd == -1) {
+        log_error("Could not watch for the gamescope socket: %s\n", strerror(errno));
+        return -1;
+    }
+    if (inotify_add_watch(fd, runtime_dir, IN_CREATE | IN_MOVED_TO) == -1) {
+        log_error("Could not watch %s for the gamescope socket: %s\n", runtime_dir, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+// drains the watch, returns whether gamescope's socket was among the files that showed up
+static bool gamescope_socket_appeared(int watch_fd) {
+    bool appeared = false;
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t length;
+    while ((length = read(watch_fd, buffer, sizeof(buffer))) > 0) {
+        for (char *next = buffer; next < buffer + length; ) {
+            struct inotify_event *event = (struct inotify_event *) next;
+            if (event->len > 0 && strcmp(event->name, GAMESCOPE_WAYLAND_DISPLAY) == 0) appeared = true;
+            next += sizeof(struct inotify_event) + event->len;
+        }
+    }
+
+    return appeared;
+}
+
+// 0 unless pacing is enabled and the device knows its display's refresh rate
+static uint64_t pose_period_ns() {
+    if (!gamescope_config || !gamescope_config->pace_to_refresh) return 0;
+
+    device_properties_type* device = device_checkout();
+    int refresh_hz = device != NULL ? atomic_load_explicit(&device->display_refresh_hz, memory_order_relaxed) : 0;
+    device_checkin(device);
+
+    return refresh_hz > 0 ? NS_PER_SEC / refresh_hz : 0;
+}
+
+// Does all of the uniform traffic to gamescope, so the pose path never waits on it, not even on the round trips
+// made while the effect is loading.
+static void *sender_thread_func(void *arg) {
+    (void)arg;
+
+    uint64_t seen_sequence = 0;
+    uint64_t seen_pose_count = 0;
+    uint64_t seen_keepalive_date_count = 0;
+    uint64_t last_pose_sent_ns = 0;
+    int connect_retries = 0;
+
+    // Connects the moment gamescope's socket shows up rather than on the next state update. The display's fd is
+    // also watched, without asking for input, so a gamescope exit is noticed right away even while idle.
+    int watch_fd = watch_gamescope_socket();
+    while (true) {
+        pthread_mutex_lock(&wayland_mutex);
+        int display_fd = display ? wl_display_get_fd(display) : -1;
+        bool effect_loading = gamescope_reshade_effect_request_time != 0;
+        pthread_mutex_unlock(&wayland_mutex);
+
+        struct pollfd poll_fds[3] = {
+            { .fd = sender_wake_fd, .events = POLLIN },
+            { .fd = watch_fd, .events = POLLIN },
+            { .fd = display_fd, .events = 0 }
+        };
+
+        // keep checking on the effect while it's loading, the effect_ready event may never come
+        int timeout_ms = -1;
+        if (effect_loading) timeout_ms = GAMESCOPE_RESHADE_WAIT_TIME_MS / 5;
+        if (connect_retries > 0) timeout_ms = GAMESCOPE_CONNECT_RETRY_MS;
+
+        atomic_store(&sender_thread_waiting, true);
+        bool idle = atomic_load(&pose_mailbox.sequence) == seen_sequence && !atomic_load(&flush_requested);
+        int result = poll(poll_fds, 3, idle ? timeout_ms : 0);
+        atomic_store(&sender_thread_waiting, false);
+        if (result == -1) {
+            if (errno == EINTR) continue;
+
+            log_error("gamescope sender poll failed, no longer sending to gamescope: %s\n", strerror(errno));
+            break;
+        }
+
+        if (poll_fds[0].revents & POLLIN) {
+            uint64_t wakes;
+            if (read(sender_wake_fd, &wakes, sizeof(wakes)) == -1 && errno != EAGAIN)
+                log_debug("gamescope sender wake read failed: %s\n", strerror(errno));
+        }
+
+        if (poll_fds[2].revents & (POLLHUP | POLLERR)) {
+            pthread_mutex_lock(&wayland_mutex);
+            if (display && wl_display_get_fd(display) == display_fd) {
+                if (config()->debug_ipc) log_debug("gamescope closed the connection\n");
+                do_wl_cleanup();
+            }
+            pthread_mutex_unlock(&wayland_mutex);
+        }
+
+        if ((poll_fds[1].revents & POLLIN) && gamescope_socket_appeared(watch_fd)) {
+            if (config()->debug_ipc) log_debug("gamescope socket appeared\n");
+            connect_retries = GAMESCOPE_CONNECT_RETRIES;
+        }
+        if (connect_retries > 0) {
+            pthread_mutex_lock(&wayland_mutex);
+            bool connected = do_wl_update_connection();
+            pthread_mutex_unlock(&wayland_mutex);
+
+            // nothing to retry for if there's no device, the state updates take over from here
+            connect_retries = connected || !device_present() ? 0 : connect_retries - 1;
+        }
+
+        struct pose_mailbox_t mailbox;
+        uint64_t sequence;
+        while (!pose_mailbox_read(&sequence, &mailbox)) sched_yield();
+
+        // When paced, a pose is held back until a refresh period after the last one sent, and whatever is newest
+        // by then goes out instead. The pose path doesn't wake this thread while it's sleeping here, so gamescope
+        // and this thread see one wakeup per refresh rather than one per IMU sample.
+        uint64_t period_ns = pose_period_ns();
+        uint64_t pose_due_ns = 0;
+        if (period_ns && mailbox.pose_count != seen_pose_count &&
+                get_monotonic_time_ns() < last_pose_sent_ns + period_ns) {
+            pose_due_ns = last_pose_sent_ns + period_ns;
+            struct timespec due = { .tv_sec = pose_due_ns / NS_PER_SEC, .tv_nsec = pose_due_ns % NS_PER_SEC };
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &due, NULL) == EINTR);
+
+            while (!pose_mailbox_read(&sequence, &mailbox)) sched_yield();
+        }
+        seen_sequence = sequence;
 
-                do_trigger_plugins_ipc_change();
+        bool flush = atomic_exchange(&flush_requested, false);
+        bool send_pose = mailbox.pose_count != seen_pose_count;
 
-                do_wl_add_gamescope_effect_ready_listener(_gamescope_reshade_effect_ready);
-                do_wl_enable_gamescope_effect();
+        if (send_pose) {
+            // stays on the refresh grid while poses keep coming, restarts from now after a gap
+            last_pose_sent_ns = pose_due_ns ? pose_due_ns : get_monotonic_time_ns();
+
+            stats_poses_sent++;
+            stats_poses_coalesced += mailbox.pose_count - seen_pose_count - 1;
+            seen_pose_count = mailbox.pose_count;
+
+            set_uniform_variable("pose_orientation_predicted", mailbox.pose.pose_orientation_predicted, 4, sizeof(float));
+            set_uniform_variable("pose_position_predicted", mailbox.pose.pose_position_predicted, 3, sizeof(float));
+            set_uniform_variable("pose_orientation", mailbox.pose.pose_orientation, 16, sizeof(float));
+            set_uniform_variable("pose_position", mailbox.pose.pose_position, 3, sizeof(float));
+        }
+        if (mailbox.keepalive_date_count != seen_keepalive_date_count) {
+            seen_keepalive_date_count = mailbox.keepalive_date_count;
+            set_uniform_variable("keepalive_date", mailbox.keepalive_date, 4, sizeof(float));
+        }
+
+        pthread_mutex_lock(&wayland_mutex);
+        int dirty_count = reshade_object ? take_dirty_uniform_variables() : 0;
+        if (reshade_object && (send_pose || flush || dirty_count > 0)) {
+            if (do_wl_flush_uniform_variables(dirty_count)) {
+                if (send_pose)
+                    pose_stats_record(POSE_STATS_GAMESCOPE_SEND, get_monotonic_time_ns() - mailbox.pose_handed_over_ns);
+            } else {
+                do_wl_cleanup();
             }
         }
-    } else {
-        if (gamescope_reshade_ipc_connected) do_wl_cleanup();
+        if (reshade_object) do_check_effect_ready_timeout();
+        pthread_mutex_unlock(&wayland_mutex);
     }
-    pthread_mutex_unlock(&wayland_mutex);
-};
 
-void gamescope_reshade_wl_handle_pose_data_func(imu_pose_type pose, imu_euler_type velocities, bool imu_calibrated, ipc_values_type *ipc_values) {
-    if (!reshade_object) return;
-    
-    pthread_mutex_lock(&wayland_mutex);
-    if (gamescope_reshade_effect_request_time != 0 && 
-            get_epoch_time_ms() - gamescope_reshade_effect_request_time > 
-            GAMESCOPE_RESHADE_WAIT_TIME_MS) {
-        log_error("gamescope effect_ready event never received, falling back to shared memory IPC\n");
-        do_wl_cleanup();
+    return NULL;
+}
+
+// must only be called from within the wayland mutex
+static void do_start_sender_thread() {
+    if (sender_wake_fd != -1) return;
+
+    sender_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (sender_wake_fd == -1) {
+        log_error("Could not create gamescope sender eventfd: %s\n", strerror(errno));
+        return;
     }
-    pthread_mutex_unlock(&wayland_mutex);
+
+    pthread_create(&sender_thread, NULL, sender_thread_func, NULL);
+    pthread_detach(sender_thread);
 }
 
+void gamescope_reshade_wl_handle_state_func() {
+    pthread_mutex_lock(&wayland_mutex);
+    do_start_sender_thread();
+    do_wl_update_connection();
+    pthread_mutex_unlock(&wayland_mutex);
+};
+
 void gamescope_reshade_wl_reset_pose_data_func() {
-    set_skippable_gamescope_reshade_effect_uniform_variable("pose_orientation", pose_orientation_reset_data, 16, sizeof(float), false);
-    set_skippable_gamescope_reshade_effect_uniform_variable("pose_position", pose_position_reset_data, 3, sizeof(float), true);
+    gamescope_reshade_pose_uniforms_type uniforms;
+    memcpy(uniforms.pose_orientation_predicted, pose_orientation_reset_data, sizeof(uniforms.pose_orientation_predicted));
+    memcpy(uniforms.pose_position_predicted, pose_position_reset_data, sizeof(uniforms.pose_position_predicted));
+    memcpy(uniforms.pose_orientation, pose_orientation_reset_data, sizeof(uniforms.pose_orientation));
+    memcpy(uniforms.pose_position, pose_position_reset_data, sizeof(uniforms.pose_position));
+    set_gamescope_reshade_pose_uniforms(&uniforms);
+}
+
+bool gamescope_reshade_wl_is_active_func() {
+    return reshade_object != NULL;
 }
 
 const plugin_type gamescope_reshade_wayland_plugin = {
@@ -371,7 +822,7 @@ const plugin_type gamescope_reshade_wayland_plugin = {
     .set_config = gamescope_reshade_wayland_set_config_func,
     .setup_ipc = gamescope_reshade_wl_setup_ipc,
     .handle_state = gamescope_reshade_wl_handle_state_func,
-    .handle_pose_data = gamescope_reshade_wl_handle_pose_data_func,
     .reset_pose_data = gamescope_reshade_wl_reset_pose_data_func,
-    .handle_device_disconnect = wayland_cleanup,
+    .handle_device_disconnect = wayland_handle_device_disconnect,
+    .is_active = gamescope_reshade_wl_is_active_func,
 };
\ No newline at end of file
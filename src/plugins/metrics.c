@@ -138,9 +138,9 @@ void metrics_set_config_func(void* config) {
 
 
 void metrics_handle_state_func() {
-    if (!state_sbs_enabled && state()->sbs_mode_enabled) {
+    if (!state_sbs_enabled && hot_state()->sbs_mode_enabled) {
         log_metric("sbs_enabled");
-        state_sbs_enabled = state()->sbs_mode_enabled;
+        state_sbs_enabled = hot_state()->sbs_mode_enabled;
     }
 };
 
@@ -41,7 +41,7 @@ static void neck_saver_set_config_func(void *config) {
         log_message("Neck Saver vertical multiplier changed to %f\n", new_config->vertical_multiplier);
     }
 
-    free(ns_config);
+    plugins_retire_config(ns_config, free);
     ns_config = new_config;
 }
 
@@ -57,10 +57,15 @@ static void neck_saver_modify_pose_func(imu_pose_type* pose) {
     pose->orientation = euler_to_quaternion_zyx(pose->euler);
 }
 
+static bool neck_saver_is_active_func() {
+    return ns_config && (ns_config->horizontal_multiplier != 1.0f || ns_config->vertical_multiplier != 1.0f);
+}
+
 const plugin_type neck_saver_plugin = {
     .id = "neck_saver",
     .default_config = neck_saver_default_config_func,
     .handle_config_line = neck_saver_handle_config_line_func,
     .set_config = neck_saver_set_config_func,
-    .modify_pose = neck_saver_modify_pose_func
+    .modify_pose = neck_saver_modify_pose_func,
+    .is_active = neck_saver_is_active_func
 };
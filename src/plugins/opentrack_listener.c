@@ -2,6 +2,7 @@
 #include "connection_pool.h"
 #include "devices.h"
 #include "driver.h"
+#include "epoch.h"
 #include "imu.h"
 #include "logging.h"
 #include "memory.h"
@@ -246,8 +247,16 @@ static device_properties_type *opentrack_supported_device(uint16_t id_vendor, ui
     return NULL;
 }
 
+// for reads from the listener and device threads, which don't run inside a plugins hook
+static bool listener_enabled() {
+    plugins_protect_configs();
+    bool enabled = ot_cfg && ot_cfg->enabled;
+    plugins_release_configs();
+    return enabled;
+}
+
 static bool opentrack_device_connect() {
-    connected = ot_cfg && ot_cfg->enabled && udp_fd != -1;
+    connected = listener_enabled() && udp_fd != -1;
     return connected;
 }
 
@@ -325,7 +334,7 @@ static const struct timeval OT_SELECT_TIMEOUT = {
 static void* opentrack_listener_thread_func(void* arg) {
     (void)arg;
     uint8_t buf[6 * sizeof(double) + sizeof(uint32_t)];
-    while (!driver_disabled() && ot_cfg && ot_cfg->enabled && udp_fd != -1) {
+    while (!driver_disabled() && listener_enabled() && udp_fd != -1) {
         fd_set rfds; FD_ZERO(&rfds); FD_SET(udp_fd, &rfds);
         struct timeval tv = OT_SELECT_TIMEOUT;
         int sel = select(udp_fd + 1, &rfds, NULL, NULL, &tv);
@@ -366,7 +375,6 @@ static void* opentrack_listener_thread_func(void* arg) {
             pthread_mutex_unlock(&conn_mutex);
         }
 
-        static bool prev_block_active = false;
         if (block_active) {
             device_properties_type *device = device_checkout();
             if (device) {
@@ -375,12 +383,6 @@ static void* opentrack_listener_thread_func(void* arg) {
                 memcpy(vals, buf, 6 * sizeof(double));
                 imu_euler_type e = { .roll = (float)vals[5], .pitch = (float)vals[4], .yaw = (float)vals[3] };
                 imu_quat_type q = euler_to_quaternion_zyx(e);
-                struct timeval tv2; gettimeofday(&tv2, NULL);
-                uint32_t ts_ms = (uint32_t)((tv2.tv_sec * 1000ULL) + (tv2.tv_usec / 1000ULL));
-                static uint32_t start_ts_ms = 0; // set on first active event
-                if (!prev_block_active) {
-                    start_ts_ms = ts_ms;
-                }
 
                 // OpenTrack reports in EUS; convert to NWU
                 float full_distance_cm = LENS_TO_PIVOT_CM / device->lens_distance_ratio;
@@ -395,12 +397,11 @@ static void* opentrack_listener_thread_func(void* arg) {
                 pose.position = pos;
                 pose.has_orientation = true;
                 pose.has_position = true;
-                pose.timestamp_ms = ts_ms - start_ts_ms;
+                pose.timestamp_ns = get_monotonic_time_ns();
                 connection_pool_ingest_pose(OT_DRIVER_ID, pose);
             }
             device_checkin(device);
         }
-        prev_block_active = block_active;
     }
 
     listener_running = false;
@@ -439,6 +440,12 @@ static void opentrack_start_func() {
     }
 }
 
+static void free_opentrack_config(void *config) {
+    opentrack_listener_config *cfg = (opentrack_listener_config *)config;
+    free(cfg->ip);
+    free(cfg);
+}
+
 static void opentrack_set_config_func(void *new_config) {
     opentrack_listener_config *new_cfg = (opentrack_listener_config *)new_config;
     if (!new_cfg) return;
@@ -448,8 +455,7 @@ static void opentrack_set_config_func(void *new_config) {
         bool was_enabled = ot_cfg && ot_cfg->enabled;
         if (was_enabled != new_cfg->enabled)
             log_message("OpenTrack listener has been %s\n", new_cfg->enabled ? "enabled" : "disabled");
-        free(ot_cfg->ip);
-        free(ot_cfg);
+        plugins_retire_config(ot_cfg, free_opentrack_config);
     }
     ot_cfg = new_cfg;
 
@@ -109,6 +109,12 @@ static void opentrack_handle_config_line_func(void *config, char *key, char *val
     }
 }
 
+static void free_opentrack_config(void *config) {
+    opentrack_source_config *cfg = (opentrack_source_config *)config;
+    free(cfg->ip);
+    free(cfg);
+}
+
 static void opentrack_set_config_func(void *new_config) {
     opentrack_source_config *new_cfg = (opentrack_source_config *)new_config;
     if (!new_cfg) return;
@@ -128,8 +134,7 @@ static void opentrack_set_config_func(void *new_config) {
             reopen = true;
         }
 
-        free(ot_config->ip);
-        free(ot_config);
+        plugins_retire_config(ot_config, free_opentrack_config);
     }
 
     ot_config = new_cfg;
@@ -150,8 +155,8 @@ static void opentrack_handle_device_disconnect_func() {
     frame_number = 0;
 }
 
-static void opentrack_handle_pose_data_func(imu_pose_type pose, imu_euler_type velocities, bool imu_calibrated, ipc_values_type *ipc_values) {
-    (void)ipc_values;
+static void opentrack_handle_pose_data_func(imu_pose_type pose, imu_euler_type velocities, bool imu_calibrated, const published_pose_type *published) {
+    (void)published;
 
     if (!ot_config || !ot_config->enabled || !imu_calibrated || udp_fd == -1) return;
 
@@ -191,6 +196,10 @@ static void opentrack_reset_pose_data_func() {
     frame_number = 0;
 }
 
+static bool opentrack_is_active_func() {
+    return ot_config && ot_config->enabled && udp_fd != -1;
+}
+
 const plugin_type opentrack_source_plugin = {
     .id = "opentrack_source",
     .default_config = opentrack_default_config_func,
@@ -198,5 +207,6 @@ const plugin_type opentrack_source_plugin = {
     .set_config = opentrack_set_config_func,
     .handle_pose_data = opentrack_handle_pose_data_func,
     .reset_pose_data = opentrack_reset_pose_data_func,
-    .handle_device_disconnect = opentrack_handle_device_disconnect_func
+    .handle_device_disconnect = opentrack_handle_device_disconnect_func,
+    .is_active = opentrack_is_active_func
 };
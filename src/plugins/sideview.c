@@ -83,7 +83,7 @@ void sideview_set_config_func(void* config) {
         if (sv_config->position != temp_config->position)
             log_message("Sideview position has been changed to %s\n", sideview_position_names[temp_config->position]);
 
-        free(sv_config);
+        plugins_retire_config(sv_config, free);
     }
     sv_config = temp_config;
 
@@ -1,11 +1,13 @@
 #include "buffer.h"
 #include "config.h"
+#include "epoch.h"
 #include "features/breezy_desktop.h"
 #include "features/smooth_follow.h"
 #include "imu.h"
 #include "ipc.h"
 #include "logging.h"
 #include "memory.h"
+#include "plugins.h"
 #include "plugins/gamescope_reshade_wayland.h"
 #include "plugins/smooth_follow.h"
 #include "runtime_context.h"
@@ -15,7 +17,6 @@
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/time.h>
 
 typedef enum {
     FOLLOW_STATE_NONE,
@@ -55,9 +56,7 @@ const smooth_follow_params loose_follow_params = {
 };
 
 uint32_t get_time_ms() {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return tv.tv_sec * 1000 + tv.tv_usec / 1000;
+    return (uint32_t)(get_monotonic_time_ns() / NS_PER_MS);
 }
 
 smooth_follow_config* sf_config = NULL;
@@ -116,16 +115,17 @@ void smooth_follow_handle_config_line_func(void* config, char* key, char* value)
 
 static bool smooth_follow_enabled=false;
 follow_state_type follow_state = FOLLOW_STATE_NONE;
-uint32_t last_timestamp_ms = -1;
+uint64_t last_timestamp_ns = -1;
 static imu_pose_type *origin_pose = NULL;
 
-uint32_t start_snap_back_timestamp_ms = -1;
+uint64_t start_snap_back_timestamp_ns = -1;
 static bool was_sbs_mode_enabled = false;
 static void update_smooth_follow_params() {
     if (!sf_params) sf_params = calloc(1, sizeof(smooth_follow_params));
+    driver_hot_state_type* hot = hot_state_acquire();
     bool virtual_display_follow = sf_config->virtual_display_enabled && sf_config->virtual_display_follow_enabled;
     bool smooth_follow = sf_config->sideview_enabled && sf_config->sideview_follow_enabled;
-    bool breezy_desktop_follow = sf_config->breezy_desktop_enabled && state()->breezy_desktop_smooth_follow_enabled;
+    bool breezy_desktop_follow = sf_config->breezy_desktop_enabled && hot->breezy_desktop_smooth_follow_enabled;
     device_properties_type* device = device_checkout();
     if (device != NULL) {
         float half_fov = device->fov / 2.0;
@@ -137,7 +137,7 @@ static void update_smooth_follow_params() {
             sf_params->upper_angle_threshold = device_fov_threshold * 2.0;
         } else if (smooth_follow) {
             *sf_params = sticky_params;
-            bool widescreen = state()->sbs_mode_enabled && is_gamescope_reshade_ipc_connected();
+            bool widescreen = hot->sbs_mode_enabled && is_gamescope_reshade_ipc_connected();
             float threshold = sf_params->lower_angle_threshold;
             if (sf_config->sideview_follow_threshold) threshold = sf_config->sideview_follow_threshold;
             float display_size = fmax(1.0, sf_config->display_size * (widescreen ? 2.0 : 1.0));
@@ -154,8 +154,8 @@ static void update_smooth_follow_params() {
             *sf_params = sticky_params;
             float display_distance = 1.0;
             float threshold = sf_params->lower_angle_threshold;
-            if (state()->breezy_desktop_display_distance) display_distance = state()->breezy_desktop_display_distance;
-            if (state()->breezy_desktop_follow_threshold) threshold = state()->breezy_desktop_follow_threshold;
+            if (hot->breezy_desktop_display_distance) display_distance = hot->breezy_desktop_display_distance;
+            if (hot->breezy_desktop_follow_threshold) threshold = hot->breezy_desktop_follow_threshold;
             threshold += half_fov * (1.0 / display_distance - 1.0);
             threshold = fmax(sf_params->lower_angle_threshold, threshold);
             
@@ -166,7 +166,9 @@ static void update_smooth_follow_params() {
     }
     device_checkin(device);
 
-    was_sbs_mode_enabled = state()->sbs_mode_enabled;
+    was_sbs_mode_enabled = hot->sbs_mode_enabled;
+    hot_state_release();
+
     bool was_smooth_follow_enabled = smooth_follow_enabled;
     smooth_follow_enabled = is_smooth_follow_granted() && (virtual_display_follow || smooth_follow);
     smooth_follow_enabled |= is_productivity_granted() && breezy_desktop_follow;
@@ -177,11 +179,13 @@ static void update_smooth_follow_params() {
     }
 
     if (smooth_follow_enabled && !was_smooth_follow_enabled) {
-        start_snap_back_timestamp_ms = -1;
-        last_timestamp_ms = -1;
+        start_snap_back_timestamp_ns = -1;
+        last_timestamp_ns = -1;
         *sf_params = init_params;
         follow_state = FOLLOW_STATE_INIT;
     }
+
+    if (smooth_follow_enabled != was_smooth_follow_enabled) plugins_invalidate_hook_plan();
 }
 
 void smooth_follow_set_config_func(void* config) {
@@ -202,7 +206,7 @@ void smooth_follow_set_config_func(void* config) {
         if (temp_config->sideview_follow_threshold != sf_config->sideview_follow_threshold)
             log_message("Sideview follow threshold has been changed to %f\n", temp_config->sideview_follow_threshold);
 
-        free(sf_config);
+        plugins_retire_config(sf_config, free);
     }
 
     sf_config = temp_config;
@@ -276,10 +280,10 @@ imu_quat_type slerp(imu_quat_type from, imu_quat_type to, float a) {
     if (a < 0.0f) a = 0.0f;
     if (a > 1.0f) a = 1.0f;
 
-    from = normalize_quaternion(from);
-    target = normalize_quaternion(target);
+    from = renormalize_quaternion_lazy(from);
+    target = renormalize_quaternion_lazy(target);
 
-    float cosTheta = from.w * target.w + from.x * target.x + from.y * target.y + from.z * target.z;
+    float cosTheta = quat_dot(from, target);
     if (cosTheta < 0) {
         imu_quat_type tmp = {
             .w = -target.w,
@@ -311,15 +315,7 @@ imu_quat_type slerp(imu_quat_type from, imu_quat_type to, float a) {
 
         float a_compliment = 1 - a;
         float sin_of_angle = sinf(half_angle);
-        if (fabsf(sin_of_angle) <= 1e-6f) {
-            imu_quat_type result = {
-                .w = (1.0f - a) * from.w + a * target.w,
-                .x = (1.0f - a) * from.x + a * target.x,
-                .y = (1.0f - a) * from.y + a * target.y,
-                .z = (1.0f - a) * from.z + a * target.z
-            };
-            return normalize_quaternion(result);
-        }
+        if (fabsf(sin_of_angle) <= 1e-6f) return quat_nlerp(from, target, a);
 
         float from_weight = percent_adjust(sinf(a_compliment * half_angle) / sin_of_angle, target_percent, false);
         float target_weight = percent_adjust(sinf(a * half_angle) / sin_of_angle, target_percent, true);
@@ -342,22 +338,25 @@ bool smooth_follow_modify_reference_pose_func(imu_pose_type pose, imu_pose_type*
         return false;
     }
 
-    if (last_timestamp_ms == -1) {
-        last_timestamp_ms = pose.timestamp_ms;
+    if (last_timestamp_ns == -1) {
+        last_timestamp_ns = pose.timestamp_ns;
         return false;
     }
 
     if (follow_state == FOLLOW_STATE_NONE) {
-        last_timestamp_ms = pose.timestamp_ms;
+        last_timestamp_ns = pose.timestamp_ns;
     }
 
-    uint32_t elapsed_ms = pose.timestamp_ms - last_timestamp_ms;
-    last_timestamp_ms = pose.timestamp_ms;
+    float elapsed_ms = (float)(pose.timestamp_ns - last_timestamp_ns) / NS_PER_MS;
+    last_timestamp_ns = pose.timestamp_ns;
 
     if (origin_pose) {
         // allow 6DoF some freedom to move around in the forward/back direction within a half-meter
-        float full_distance_cm = state()->connected_device_full_distance_cm;
-        if (full_distance_cm > 0.0f && state()->connected_device_pose_has_position) {
+        driver_hot_state_type* hot = hot_state_acquire();
+        float full_distance_cm = hot->connected_device_full_distance_cm;
+        bool pose_has_position = hot->connected_device_pose_has_position;
+        hot_state_release();
+        if (full_distance_cm > 0.0f && pose_has_position) {
             float half_meter_units = 50.0f / full_distance_cm;
             
             // transiently rotate into the current pose frame so we clamp along "forward"
@@ -399,28 +398,28 @@ bool smooth_follow_modify_reference_pose_func(imu_pose_type pose, imu_pose_type*
 
             // for visual consistency with how screen placement behaves when smooth follow is disabled,
             // trigger the modify_pose hook
-            imu_pose_type delta_pose = { .timestamp_ms = pose.timestamp_ms, .orientation = delta_quat, .position = (imu_vec3_type){0.0f,0.0f,0.0f}, .euler = quaternion_to_euler_zyx(delta_quat) };
+            imu_pose_type delta_pose = { .timestamp_ns = pose.timestamp_ns, .orientation = delta_quat, .position = (imu_vec3_type){0.0f,0.0f,0.0f}, .euler = quaternion_to_euler_zyx(delta_quat) };
             plugins.modify_pose(&delta_pose);
             delta_quat = delta_pose.orientation;
 
-            imu_buffer_response_type* response = push_to_imu_buffer(
+            float origin_payload[IMU_BUFFER_PAYLOAD_SIZE];
+            state()->smooth_follow_origin_ready = push_to_imu_buffer(
                 smooth_follow_imu_buffer, 
                 delta_quat,
-                pose.timestamp_ms
+                pose.timestamp_ns,
+                origin_payload
             );
-            state()->smooth_follow_origin_ready = response && response->ready;
             if (state()->smooth_follow_origin_ready) {
-                memcpy(state()->smooth_follow_origin, response->data, sizeof(float) * 16);
+                memcpy(state()->smooth_follow_origin, origin_payload, sizeof(float) * 16);
             }
-            free(response);
         }
 
         // smooth follow has been disabled, slerp the screen back to its original center
         if (!smooth_follow_enabled) {
-            if (start_snap_back_timestamp_ms == -1) {
-                start_snap_back_timestamp_ms = pose.timestamp_ms;
+            if (start_snap_back_timestamp_ns == -1) {
+                start_snap_back_timestamp_ns = pose.timestamp_ns;
             }
-            uint32_t elapsed_snap_back_ms = pose.timestamp_ms - start_snap_back_timestamp_ms;
+            uint64_t elapsed_snap_back_ms = (pose.timestamp_ns - start_snap_back_timestamp_ns) / NS_PER_MS;
             ref_pose->orientation = slerp(ref_pose->orientation, origin_pose->orientation, 1 - pow(1 - sf_params->interpolation_ratio_ms, elapsed_ms));
             
             // our return-to-angle is so small it will never hit the target, kill the snap-back slerp after 2 seconds
@@ -433,8 +432,9 @@ bool smooth_follow_modify_reference_pose_func(imu_pose_type pose, imu_pose_type*
                 free_and_clear(&origin_pose);
                 free_and_clear(&state()->smooth_follow_origin);
                 state()->smooth_follow_origin_ready = false;
+                plugins_invalidate_hook_plan();
 
-                start_snap_back_timestamp_ms = -1;
+                start_snap_back_timestamp_ns = -1;
             }
 
             return true;
@@ -476,21 +476,22 @@ void smooth_follow_handle_control_flag_line_func(char* key, char* value) {
         if (was_enabled != state()->breezy_desktop_smooth_follow_enabled)
             log_message("Breezy Desktop follow has been %s\n", state()->breezy_desktop_smooth_follow_enabled ? "enabled" : "disabled");
         
+        publish_hot_state();
         update_smooth_follow_params();
     }
 }
 
 static void smooth_follow_handle_state_func() {
-    if (was_sbs_mode_enabled != state()->sbs_mode_enabled) {
+    if (was_sbs_mode_enabled != hot_state()->sbs_mode_enabled) {
         update_smooth_follow_params();
     }
 }
 
 static void handle_device_disconnect() {
-    last_timestamp_ms = -1;
+    last_timestamp_ns = -1;
     follow_state = FOLLOW_STATE_NONE;
     follow_wait_time_start_ms = -1;
-    start_snap_back_timestamp_ms = -1;
+    start_snap_back_timestamp_ns = -1;
 
     free_and_clear(&origin_pose);
     free_and_clear(&state()->smooth_follow_origin);
@@ -509,7 +510,11 @@ static void smooth_follow_handle_reference_pose_updated_func(imu_pose_type old_r
 
     follow_state = FOLLOW_STATE_NONE;
     follow_wait_time_start_ms = -1;
-    start_snap_back_timestamp_ms = -1;
+    start_snap_back_timestamp_ns = -1;
+}
+
+static bool smooth_follow_is_active_func() {
+    return sf_params && (smooth_follow_enabled || origin_pose);
 }
 
 const plugin_type smooth_follow_plugin = {
@@ -523,5 +528,6 @@ const plugin_type smooth_follow_plugin = {
     .modify_reference_pose = smooth_follow_modify_reference_pose_func,
     .handle_reference_pose_updated = smooth_follow_handle_reference_pose_updated_func,
     .handle_device_connect = update_smooth_follow_params,
-    .handle_device_disconnect = handle_device_disconnect
+    .handle_device_disconnect = handle_device_disconnect,
+    .is_active = smooth_follow_is_active_func
 };
\ No newline at end of file
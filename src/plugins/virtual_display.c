@@ -81,7 +81,8 @@ void set_virtual_display_ipc_values() {
                             (vd_config->enabled ||
                             vd_config->follow_mode_enabled &&
                             vd_config->passthrough_smooth_follow_enabled);
-        bool show_banner = enabled && state()->calibration_state == CALIBRATING;
+        driver_hot_state_type* hot = hot_state_acquire();
+        bool show_banner = enabled && hot->calibration_state == CALIBRATING;
 
         float look_ahead_constant = vd_config->look_ahead_override == 0 ?
                                         device->look_ahead_constant :
@@ -92,8 +93,8 @@ void set_virtual_display_ipc_values() {
         float look_ahead_cfg[4] = {look_ahead_constant, look_ahead_ftm, device->look_ahead_scanline_adjust, device->look_ahead_ms_cap};
 
         // computed values based on display config/state
-        bool pose_has_position = state()->connected_device_pose_has_position;
-        float display_north_offset = (pose_has_position || state()->sbs_mode_enabled)
+        bool pose_has_position = hot->connected_device_pose_has_position;
+        float display_north_offset = (pose_has_position || hot->sbs_mode_enabled)
                                          ? vd_config->display_distance
                                          : 1.0;
         float display_aspect_ratio = (float)device->resolution_w / (float)device->resolution_h;
@@ -119,7 +120,7 @@ void set_virtual_display_ipc_values() {
         // if this is true it tells the shader to consider the real width of the content to be half of the texture width
         bool sbs_mode_stretched = !is_gamescope_reshade_ipc_connected() && vd_config->sbs_mode_stretched;
 
-        if (state()->sbs_mode_enabled) {
+        if (hot->sbs_mode_enabled) {
             lens_vector[1] = device->lens_distance_ratio / 3.0;
             lens_vector_r[1] = -lens_vector[1];
             if (vd_config->sbs_content) {
@@ -136,6 +137,8 @@ void set_virtual_display_ipc_values() {
                 texcoord_x_limits_r[1] = 0.75;
             }
         }
+        hot_state_release();
+
         if (virtual_display_ipc_values) {
             *virtual_display_ipc_values->enabled                = enabled && !is_gamescope_reshade_ipc_connected();
             *virtual_display_ipc_values->show_banner            = show_banner;
@@ -205,7 +208,7 @@ void virtual_display_set_config_func(void* config) {
                 log_message("Curved display has been %s\n", temp_config->curved_display ? "enabled" : "disabled");
         }
 
-        free(vd_config);
+        plugins_retire_config(vd_config, free);
     }
     vd_config = temp_config;
 
@@ -257,7 +260,7 @@ bool virtual_display_setup_ipc_func() {
 }
 
 void virtual_display_handle_state_func() {
-    bool sbs_enabled = state()->sbs_mode_enabled && is_sbs_granted();
+    bool sbs_enabled = hot_state()->sbs_mode_enabled && is_sbs_granted();
     if (virtual_display_ipc_values) *virtual_display_ipc_values->sbs_enabled = sbs_enabled;
     set_gamescope_reshade_effect_uniform_variable("sbs_enabled", &sbs_enabled, 1, sizeof(bool), true);
 
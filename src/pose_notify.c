@@ -0,0 +1,241 @@
+#include "files.h"
+#include "logging.h"
+#include "memory.h"
+#include "pose_notify.h"
+#include "pose_shm.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+const char* pose_notify_socket_filename = "pose_notify.sock";
+
+// clients that have connected but not sent their request yet also take up a connection
+#define MAX_CONNECTIONS (POSE_NOTIFY_MAX_SUBSCRIBERS * 2)
+
+enum subscriber_state_t {
+    SUBSCRIBER_EMPTY = 0,
+    SUBSCRIBER_ACTIVE,
+
+    // the publisher is writing to the eventfd, it can't be closed until this goes back to active
+    SUBSCRIBER_SIGNALING
+};
+
+// Filled in by the notify thread while empty and then handed to the publisher by the release store of
+// SUBSCRIBER_ACTIVE. poses_until_signal is only touched by the publisher after that.
+struct subscriber_t {
+    _Atomic int state;
+    int eventfd;
+    uint32_t every_n_poses;
+    uint32_t poses_until_signal;
+};
+
+static struct subscriber_t subscribers[POSE_NOTIFY_MAX_SUBSCRIBERS];
+
+// lets the publisher skip the subscriber scan entirely in the usual case of there being none
+static atomic_int active_subscribers = 0;
+
+struct notify_connection_t {
+    int fd;
+
+    // index into subscribers, or -1 while the client's request hasn't arrived yet
+    int subscriber;
+};
+
+static int listen_fd = -1;
+static pthread_t notify_thread;
+
+void pose_notify_publish() {
+    pose_shm_notify();
+
+    if (atomic_load_explicit(&active_subscribers, memory_order_relaxed) == 0) return;
+
+    for (int i = 0; i < POSE_NOTIFY_MAX_SUBSCRIBERS; i++) {
+        struct subscriber_t* subscriber = &subscribers[i];
+        int expected = SUBSCRIBER_ACTIVE;
+        if (!atomic_compare_exchange_strong_explicit(&subscriber->state, &expected, SUBSCRIBER_SIGNALING,
+                                                     memory_order_acquire, memory_order_relaxed))
+            continue;
+
+        if (--subscriber->poses_until_signal == 0) {
+            subscriber->poses_until_signal = subscriber->every_n_poses;
+
+            // non-blocking, a full counter just means the client has stopped reading
+            uint64_t one = 1;
+            if (write(subscriber->eventfd, &one, sizeof(one)) == -1 && errno != EAGAIN)
+                log_debug("Pose notify: eventfd write failed: %s\n", strerror(errno));
+        }
+
+        atomic_store_explicit(&subscriber->state, SUBSCRIBER_ACTIVE, memory_order_release);
+    }
+}
+
+static void unsubscribe(int index) {
+    struct subscriber_t* subscriber = &subscribers[index];
+
+    // the publisher only holds a subscriber for the length of one eventfd write
+    int expected = SUBSCRIBER_ACTIVE;
+    while (!atomic_compare_exchange_weak_explicit(&subscriber->state, &expected, SUBSCRIBER_EMPTY,
+                                                  memory_order_acquire, memory_order_relaxed)) {
+        expected = SUBSCRIBER_ACTIVE;
+        sched_yield();
+    }
+    atomic_fetch_sub_explicit(&active_subscribers, 1, memory_order_relaxed);
+
+    close(subscriber->eventfd);
+    subscriber->eventfd = -1;
+}
+
+static void send_status(int fd, uint8_t status, int eventfd) {
+    struct iovec iov = { .iov_base = &status, .iov_len = sizeof(status) };
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1 };
+    if (eventfd != -1) {
+        msg.msg_control = control.buffer;
+        msg.msg_controllen = sizeof(control.buffer);
+
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &eventfd, sizeof(int));
+    }
+
+    if (sendmsg(fd, &msg, MSG_NOSIGNAL) == -1)
+        log_debug("Pose notify: could not reply to client: %s\n", strerror(errno));
+}
+
+// returns the subscriber index, or -1 if the client was turned away
+static int subscribe(int fd, uint32_t every_n_poses) {
+    int index = -1;
+    for (int i = 0; i < POSE_NOTIFY_MAX_SUBSCRIBERS && index == -1; i++) {
+        if (atomic_load_explicit(&subscribers[i].state, memory_order_relaxed) == SUBSCRIBER_EMPTY) index = i;
+    }
+    if (index == -1) {
+        log_error("Pose notify: too many subscribers, turning one away\n");
+        send_status(fd, POSE_NOTIFY_STATUS_FULL, -1);
+        return -1;
+    }
+
+    int eventfd_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (eventfd_fd == -1) {
+        log_error("Pose notify: could not create eventfd: %s\n", strerror(errno));
+        send_status(fd, POSE_NOTIFY_STATUS_ERROR, -1);
+        return -1;
+    }
+
+    struct subscriber_t* subscriber = &subscribers[index];
+    subscriber->eventfd = eventfd_fd;
+    subscriber->every_n_poses = every_n_poses > 0 ? every_n_poses : 1;
+    subscriber->poses_until_signal = subscriber->every_n_poses;
+    atomic_fetch_add_explicit(&active_subscribers, 1, memory_order_relaxed);
+    atomic_store_explicit(&subscriber->state, SUBSCRIBER_ACTIVE, memory_order_release);
+
+    // the client gets its own reference to the eventfd, ours stays with the subscriber
+    send_status(fd, POSE_NOTIFY_STATUS_OK, eventfd_fd);
+    return index;
+}
+
+static void* notify_thread_func(void* arg) {
+    (void)arg;
+
+    struct notify_connection_t connections[MAX_CONNECTIONS];
+    int connection_count = 0;
+    struct pollfd poll_fds[MAX_CONNECTIONS + 1];
+
+    while (true) {
+        poll_fds[0] = (struct pollfd){ .fd = listen_fd, .events = connection_count < MAX_CONNECTIONS ? POLLIN : 0 };
+        for (int i = 0; i < connection_count; i++)
+            poll_fds[i + 1] = (struct pollfd){ .fd = connections[i].fd, .events = POLLIN };
+
+        if (poll(poll_fds, connection_count + 1, -1) == -1) {
+            if (errno == EINTR) continue;
+
+            log_error("Pose notify: poll failed, no longer accepting subscribers: %s\n", strerror(errno));
+            break;
+        }
+
+        // walk backwards so removing a connection doesn't disturb the ones not visited yet
+        for (int i = connection_count - 1; i >= 0; i--) {
+            if (!poll_fds[i + 1].revents) continue;
+
+            struct notify_connection_t* connection = &connections[i];
+            bool drop = false;
+            if (connection->subscriber == -1) {
+                uint32_t every_n_poses = 0;
+                ssize_t bytes = recv(connection->fd, &every_n_poses, sizeof(every_n_poses), MSG_DONTWAIT);
+                if (bytes == sizeof(every_n_poses)) {
+                    connection->subscriber = subscribe(connection->fd, every_n_poses);
+                    drop = connection->subscriber == -1;
+                } else if (bytes != -1 || (errno != EAGAIN && errno != EINTR)) {
+                    // closed or a short request, there's no partial read handling for a 4-byte message
+                    drop = true;
+                }
+            } else {
+                // subscribed clients have nothing more to say, anything readable is either a hangup or noise
+                char discard[64];
+                ssize_t bytes = recv(connection->fd, discard, sizeof(discard), MSG_DONTWAIT);
+                drop = bytes == 0 || (bytes == -1 && errno != EAGAIN && errno != EINTR);
+            }
+
+            if (drop) {
+                if (connection->subscriber != -1) unsubscribe(connection->subscriber);
+                close(connection->fd);
+                connections[i] = connections[--connection_count];
+            }
+        }
+
+        if (poll_fds[0].revents & POLLIN) {
+            int fd = accept(listen_fd, NULL, NULL);
+            if (fd == -1) {
+                if (errno != EAGAIN && errno != EINTR)
+                    log_error("Pose notify: accept failed: %s\n", strerror(errno));
+            } else {
+                fcntl(fd, F_SETFD, FD_CLOEXEC);
+                connections[connection_count++] = (struct notify_connection_t){ .fd = fd, .subscriber = -1 };
+            }
+        }
+    }
+
+    for (int i = 0; i < connection_count; i++) {
+        if (connections[i].subscriber != -1) unsubscribe(connections[i].subscriber);
+        close(connections[i].fd);
+    }
+    close(listen_fd);
+    listen_fd = -1;
+
+    return NULL;
+}
+
+void pose_notify_init() {
+    if (listen_fd != -1) return;
+
+    char* path = NULL;
+    int fd = listen_on_runtime_socket(pose_notify_socket_filename, SOCK_STREAM, POSE_NOTIFY_MAX_SUBSCRIBERS, &path);
+    if (fd == -1) {
+        log_error("Could not listen on pose notify socket %s: %s\n", path, strerror(errno));
+        free_and_clear(&path);
+        return;
+    }
+    free_and_clear(&path);
+
+    for (int i = 0; i < POSE_NOTIFY_MAX_SUBSCRIBERS; i++) subscribers[i].eventfd = -1;
+    listen_fd = fd;
+
+    pthread_create(&notify_thread, NULL, notify_thread_func, NULL);
+    pthread_detach(notify_thread);
+}
@@ -0,0 +1,163 @@
+#include "epoch.h"
+#include "imu.h"
+#include "pose_prediction.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// Smoothing time constants. Velocity needs to follow the head closely, acceleration is noisier (it's a
+// second difference) so it's smoothed more heavily.
+#define VELOCITY_TAU_S 0.008f
+#define ACCELERATION_TAU_S 0.025f
+
+// larger gaps between samples than this make the old estimates meaningless
+#define MAX_SAMPLE_GAP_NS (100 * NS_PER_MS)
+
+// faster than any head can turn, so this is a recenter or a change of reference pose, not movement
+#define MAX_ANGULAR_SPEED_RAD_S 20.0f
+
+static inline imu_vec3_type vec3_scale(imu_vec3_type v, float s) {
+    return (imu_vec3_type){ .x = v.x * s, .y = v.y * s, .z = v.z * s };
+}
+
+static inline imu_vec3_type vec3_add(imu_vec3_type a, imu_vec3_type b) {
+    return (imu_vec3_type){ .x = a.x + b.x, .y = a.y + b.y, .z = a.z + b.z };
+}
+
+static inline imu_vec3_type vec3_sub(imu_vec3_type a, imu_vec3_type b) {
+    return (imu_vec3_type){ .x = a.x - b.x, .y = a.y - b.y, .z = a.z - b.z };
+}
+
+// moves "from" towards "to" by alpha
+static inline imu_vec3_type vec3_ema(imu_vec3_type from, imu_vec3_type to, float alpha) {
+    return vec3_add(from, vec3_scale(vec3_sub(to, from), alpha));
+}
+
+static inline float vec3_length(imu_vec3_type v) {
+    return sqrtf(v.x * v.x + v.y * v.y + v.z * v.z);
+}
+
+// rotation vector (axis * angle) of the shortest rotation represented by unit quaternion q
+static imu_vec3_type quat_to_rotation_vector(imu_quat_type q) {
+    if (q.w < 0.0f) {
+        q.x = -q.x;
+        q.y = -q.y;
+        q.z = -q.z;
+        q.w = -q.w;
+    }
+
+    imu_vec3_type v = { .x = q.x, .y = q.y, .z = q.z };
+    float sin_half = vec3_length(v);
+
+    // for tiny angles 2 * atan2(s, w) / s approaches 2 / w, and w is ~1
+    float scale = sin_half > 1e-6f ? 2.0f * atan2f(sin_half, q.w) / sin_half : 2.0f;
+    return vec3_scale(v, scale);
+}
+
+static imu_quat_type rotation_vector_to_quat(imu_vec3_type v) {
+    float angle = vec3_length(v);
+    if (angle < 1e-6f) {
+        // first order, renormalized by the multiply it's used in
+        return (imu_quat_type){ .x = v.x * 0.5f, .y = v.y * 0.5f, .z = v.z * 0.5f, .w = 1.0f };
+    }
+
+    float scale = sinf(angle * 0.5f) / angle;
+    return (imu_quat_type){ .x = v.x * scale, .y = v.y * scale, .z = v.z * scale, .w = cosf(angle * 0.5f) };
+}
+
+// Host receive times pick up USB jitter, and samples that arrive in the same transfer are stamped almost at
+// once, so the device's clock gives much steadier differences when both poses have it. Returns 0 if the
+// poses are out of order.
+static uint64_t sample_spacing_ns(const pose_predictor_type *predictor, imu_pose_type pose) {
+    if (pose.device_timestamp_ns != 0 && predictor->last_device_timestamp_ns != 0 &&
+            pose.device_timestamp_ns > predictor->last_device_timestamp_ns)
+        return pose.device_timestamp_ns - predictor->last_device_timestamp_ns;
+
+    if (pose.timestamp_ns <= predictor->last_timestamp_ns) return 0;
+    return pose.timestamp_ns - predictor->last_timestamp_ns;
+}
+
+void pose_predictor_reset(pose_predictor_type *predictor) {
+    memset(predictor, 0, sizeof(*predictor));
+}
+
+void pose_predictor_observe(pose_predictor_type *predictor, imu_pose_type pose) {
+    if (!pose.has_orientation) return;
+
+    if (predictor->samples > 0) {
+        // the host gap still decides whether the estimates are too old, the device clock may have been reset
+        uint64_t host_elapsed_ns = pose.timestamp_ns - predictor->last_timestamp_ns;
+        uint64_t elapsed_ns = sample_spacing_ns(predictor, pose);
+        if (pose.timestamp_ns < predictor->last_timestamp_ns || host_elapsed_ns > MAX_SAMPLE_GAP_NS ||
+                elapsed_ns == 0 || elapsed_ns > MAX_SAMPLE_GAP_NS) {
+            pose_predictor_reset(predictor);
+        } else {
+            float dt_s = (float)elapsed_ns / (float)NS_PER_SEC;
+
+            // body-frame delta, so the prediction is applied by multiplying on the right
+            imu_quat_type delta = multiply_quaternions_unnormalized(conjugate(predictor->last_orientation),
+                                                                    pose.orientation);
+            imu_vec3_type angular_velocity = vec3_scale(quat_to_rotation_vector(delta), 1.0f / dt_s);
+            if (vec3_length(angular_velocity) > MAX_ANGULAR_SPEED_RAD_S) {
+                pose_predictor_reset(predictor);
+            } else {
+                imu_vec3_type linear_velocity = vec3_scale(vec3_sub(pose.position, predictor->last_position),
+                                                           1.0f / dt_s);
+                if (predictor->samples == 1) {
+                    predictor->angular_velocity = angular_velocity;
+                    predictor->linear_velocity = linear_velocity;
+                } else {
+                    float velocity_alpha = dt_s / (VELOCITY_TAU_S + dt_s);
+                    float acceleration_alpha = dt_s / (ACCELERATION_TAU_S + dt_s);
+
+                    imu_vec3_type smoothed_angular = vec3_ema(predictor->angular_velocity, angular_velocity,
+                                                              velocity_alpha);
+                    imu_vec3_type smoothed_linear = vec3_ema(predictor->linear_velocity, linear_velocity,
+                                                             velocity_alpha);
+
+                    imu_vec3_type angular_acceleration =
+                        vec3_scale(vec3_sub(smoothed_angular, predictor->angular_velocity), 1.0f / dt_s);
+                    imu_vec3_type linear_acceleration =
+                        vec3_scale(vec3_sub(smoothed_linear, predictor->linear_velocity), 1.0f / dt_s);
+                    predictor->angular_acceleration = vec3_ema(predictor->angular_acceleration,
+                                                               angular_acceleration, acceleration_alpha);
+                    predictor->linear_acceleration = vec3_ema(predictor->linear_acceleration,
+                                                              linear_acceleration, acceleration_alpha);
+
+                    predictor->angular_velocity = smoothed_angular;
+                    predictor->linear_velocity = smoothed_linear;
+                }
+            }
+        }
+    }
+
+    predictor->last_timestamp_ns = pose.timestamp_ns;
+    predictor->last_device_timestamp_ns = pose.device_timestamp_ns;
+    predictor->last_orientation = pose.orientation;
+    predictor->last_position = pose.position;
+    if (predictor->samples < 2) predictor->samples++;
+}
+
+imu_pose_type pose_predictor_predict(const pose_predictor_type *predictor, imu_pose_type pose,
+                                     uint64_t look_ahead_ns) {
+    if (predictor->samples < 2 || look_ahead_ns == 0 || !pose.has_orientation) return pose;
+
+    float t = (float)look_ahead_ns / (float)NS_PER_SEC;
+    float half_t_squared = 0.5f * t * t;
+
+    imu_vec3_type rotation = vec3_add(vec3_scale(predictor->angular_velocity, t),
+                                      vec3_scale(predictor->angular_acceleration, half_t_squared));
+    pose.orientation = multiply_quaternions(pose.orientation, rotation_vector_to_quat(rotation));
+    imu_pose_sync_euler_from_orientation(&pose);
+
+    if (pose.has_position) {
+        imu_vec3_type translation = vec3_add(vec3_scale(predictor->linear_velocity, t),
+                                             vec3_scale(predictor->linear_acceleration, half_t_squared));
+        pose.position = vec3_add(pose.position, translation);
+    }
+
+    pose.timestamp_ns += look_ahead_ns;
+    return pose;
+}
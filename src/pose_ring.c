@@ -0,0 +1,67 @@
+#include "logging.h"
+#include "pose_ring.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define POSE_RING_MASK (POSE_RING_CAPACITY - 1)
+
+_Static_assert((POSE_RING_CAPACITY & POSE_RING_MASK) == 0, "POSE_RING_CAPACITY must be a power of 2");
+
+pose_ring_type* pose_ring_create() {
+    pose_ring_type* ring = aligned_alloc(POSE_RING_CACHE_LINE, sizeof(pose_ring_type));
+    if (!ring) {
+        log_error("Error allocating pose ring\n");
+        exit(1);
+    }
+    memset(ring, 0, sizeof(pose_ring_type));
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->overruns, 0);
+
+    return ring;
+}
+
+void pose_ring_free(pose_ring_type* ring) {
+    free(ring);
+}
+
+bool pose_ring_push(pose_ring_type* ring, const imu_pose_type* pose) {
+    bool dropped = false;
+    uint_fast64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint_fast64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    while (head - tail >= POSE_RING_CAPACITY) {
+        // full, latest wins: claim the oldest slot out from under the consumer. If the consumer claims it
+        // first, the CAS fails with the updated tail and the loop sees that there's room now.
+        if (atomic_compare_exchange_weak_explicit(&ring->tail, &tail, tail + 1,
+                                                  memory_order_acq_rel, memory_order_acquire)) {
+            atomic_fetch_add_explicit(&ring->overruns, 1, memory_order_relaxed);
+            dropped = true;
+            break;
+        }
+    }
+
+    ring->slots[head & POSE_RING_MASK] = *pose;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+    return !dropped;
+}
+
+bool pose_ring_pop(pose_ring_type* ring, imu_pose_type* out_pose) {
+    uint_fast64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    while (true) {
+        uint_fast64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (tail == head) return false;
+
+        // copy first, then claim the slot. If the producer overran us mid-copy, it will have moved the tail
+        // past this slot, so the CAS fails and the (possibly torn) copy is thrown away.
+        *out_pose = ring->slots[tail & POSE_RING_MASK];
+        if (atomic_compare_exchange_weak_explicit(&ring->tail, &tail, tail + 1,
+                                                  memory_order_acq_rel, memory_order_acquire))
+            return true;
+    }
+}
+
+uint64_t pose_ring_overruns(pose_ring_type* ring) {
+    return atomic_load_explicit(&ring->overruns, memory_order_relaxed);
+}
@@ -0,0 +1,310 @@
+#include "files.h"
+#include "logging.h"
+#include "memory.h"
+#include "pose_shm.h"
+#include "state.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <linux/memfd.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// from linux/fcntl.h, which clashes with glibc's fcntl.h; glibc only declares these with _GNU_SOURCE
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS 1033
+#define F_SEAL_SEAL 0x0001
+#define F_SEAL_SHRINK 0x0002
+#define F_SEAL_GROW 0x0004
+#endif
+#ifndef F_SEAL_FUTURE_WRITE
+#define F_SEAL_FUTURE_WRITE 0x0010
+#endif
+
+const char* pose_shm_socket_filename = "pose_shm.sock";
+const char* pose_history_filename = "xr_driver_pose_history";
+
+// where the pose region used to live, removed so old readers don't keep finding a frozen pose
+static const char* legacy_pose_shm_filename = "xr_driver_pose";
+
+static pose_shm_region_type* region = NULL;
+
+// only the writer's own, the copy in the region is never read back
+static uint64_t region_sequence = 0;
+
+static pose_shm_notify_type* notify = NULL;
+
+// what clients are handed: a read-only fd for the region and a read-write one for the notify word
+static int client_fds[2] = { -1, -1 };
+
+static int listen_fd = -1;
+static pthread_t region_thread;
+
+static pose_history_region_type* history_region = NULL;
+static uint32_t history_capacity = 0;
+
+// like region_sequence, the head in the ring's header is only ever written
+static uint64_t history_head = 0;
+
+static void send_region_fd(int fd) {
+    uint8_t version = POSE_SHM_VERSION;
+    struct iovec iov = { .iov_base = &version, .iov_len = sizeof(version) };
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(client_fds))];
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buffer,
+        .msg_controllen = sizeof(control.buffer)
+    };
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(client_fds));
+    memcpy(CMSG_DATA(cmsg), client_fds, sizeof(client_fds));
+
+    if (sendmsg(fd, &msg, MSG_NOSIGNAL) == -1)
+        log_debug("Pose region: could not send to client: %s\n", strerror(errno));
+}
+
+// hands every client the region's and notify word's memfds and hangs up, there's nothing else to say
+static void* region_thread_func(void* arg) {
+    (void)arg;
+
+    while (true) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+
+            log_error("Pose region: accept failed, no longer handing out the region: %s\n", strerror(errno));
+            break;
+        }
+
+        send_region_fd(fd);
+        close(fd);
+    }
+
+    return NULL;
+}
+
+// a sealed memfd of size bytes, mapped read-write into *mapped; returns the fd, or -1 after logging why not
+static int create_sealed_memfd(const char* name, size_t size, void** mapped) {
+    // a memfd rather than a /dev/shm file, so sandboxed consumers that can't see /dev/shm can still be handed it
+    int fd = syscall(SYS_memfd_create, name, MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd == -1) {
+        log_error("Could not create %s memfd: %s\n", name, strerror(errno));
+        return -1;
+    }
+
+    // with the size sealed, nothing a consumer does with its copy of the fd can make our mapping fault
+    if (ftruncate(fd, size) == -1 || fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW) == -1) {
+        log_error("Could not size and seal %s memfd: %s\n", name, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    *mapped = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (*mapped == MAP_FAILED) {
+        log_error("Could not map %s memfd: %s\n", name, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+// A read-only fd for the region. F_SEAL_FUTURE_WRITE (Linux 5.1) keeps anyone from writing to it or mapping it
+// writable from here on, our own mapping included, which is already in place. Without it, a read-only file
+// description at least keeps clients from mapping it writable by accident.
+static int seal_region_for_clients(int fd) {
+    if (fcntl(fd, F_ADD_SEALS, F_SEAL_FUTURE_WRITE | F_SEAL_SEAL) == -1) {
+        log_debug("Pose region: F_SEAL_FUTURE_WRITE not supported, handing out a read-only fd instead: %s\n",
+                  strerror(errno));
+        fcntl(fd, F_ADD_SEALS, F_SEAL_SEAL);
+    }
+
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+    int read_only_fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (read_only_fd == -1) {
+        log_error("Could not reopen pose region memfd read-only: %s\n", strerror(errno));
+        return -1;
+    }
+
+    close(fd);
+    return read_only_fd;
+}
+
+void pose_shm_init() {
+    if (region) return;
+
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", state_files_directory, legacy_pose_shm_filename);
+    unlink(path);
+
+    void* mapped = NULL;
+    int fd = create_sealed_memfd("xr_driver_pose", sizeof(pose_shm_region_type), &mapped);
+    if (fd == -1) return;
+
+    pose_shm_region_type* new_region = (pose_shm_region_type*)mapped;
+    new_region->version = POSE_SHM_VERSION;
+    new_region->header_size = offsetof(pose_shm_region_type, sample);
+    new_region->sample_size = sizeof(pose_shm_sample_type);
+
+    // readers check the magic last, once everything else is in place
+    atomic_thread_fence(memory_order_release);
+    new_region->magic = POSE_SHM_MAGIC;
+
+    void* notify_mapped = NULL;
+    int notify_fd = create_sealed_memfd("xr_driver_pose_notify", sizeof(pose_shm_notify_type), &notify_mapped);
+    if (notify_fd != -1) fcntl(notify_fd, F_ADD_SEALS, F_SEAL_SEAL);
+
+    int region_fd = seal_region_for_clients(fd);
+    if (notify_fd == -1 || region_fd == -1) {
+        munmap(mapped, sizeof(pose_shm_region_type));
+        if (notify_fd != -1) {
+            munmap(notify_mapped, sizeof(pose_shm_notify_type));
+            close(notify_fd);
+        }
+        if (region_fd != -1) close(region_fd);
+        return;
+    }
+
+    region = new_region;
+    notify = (pose_shm_notify_type*)notify_mapped;
+    client_fds[0] = region_fd;
+    client_fds[1] = notify_fd;
+
+    char* socket_path = NULL;
+    listen_fd = listen_on_runtime_socket(pose_shm_socket_filename, SOCK_STREAM, 16, &socket_path);
+    if (listen_fd == -1) {
+        log_error("Could not listen on pose region socket %s: %s\n", socket_path, strerror(errno));
+    } else {
+        pthread_create(&region_thread, NULL, region_thread_func, NULL);
+        pthread_detach(region_thread);
+    }
+    free_and_clear(&socket_path);
+}
+
+void pose_shm_publish(const pose_shm_sample_type *sample) {
+    if (!region) return;
+
+    atomic_store_explicit(&region->sequence, ++region_sequence, memory_order_relaxed);
+
+    // the odd sequence must be visible before any of the sample changes
+    atomic_thread_fence(memory_order_release);
+    memcpy(&region->sample, sample, sizeof(pose_shm_sample_type));
+
+    atomic_store_explicit(&region->sequence, ++region_sequence, memory_order_release);
+}
+
+void pose_shm_notify() {
+    if (!notify) return;
+
+    // pairs with the sequentially consistent operations in pose_shm_wait; a waiter that died while blocked
+    // leaves the waiter count raised, which only costs a wasted wake per pose
+    atomic_fetch_add(&notify->count, 1);
+    if (atomic_load(&notify->waiters) > 0)
+        syscall(SYS_futex, (uint32_t*)&notify->count, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+static size_t history_region_size(uint32_t capacity) {
+    return sizeof(pose_history_region_type) + capacity * sizeof(pose_history_entry_type);
+}
+
+static void history_close() {
+    if (!history_region) return;
+
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", state_files_directory, pose_history_filename);
+
+    // readers that still have the old file mapped need to know to re-open it, since the capacity changed
+    atomic_store_explicit(&history_region->stale, 1, memory_order_release);
+    munmap(history_region, history_region_size(history_region->capacity));
+    unlink(path);
+
+    history_region = NULL;
+}
+
+static void history_open(uint32_t capacity) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", state_files_directory, pose_history_filename);
+
+    // a new inode rather than resizing, a reader's mapping of a shrunk file would fault
+    unlink(path);
+    mode_t old_umask = umask(0);
+    int fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    umask(old_umask);
+    if (fd == -1) {
+        log_error("Could not create pose history file %s: %s\n", path, strerror(errno));
+        return;
+    }
+
+    size_t size = history_region_size(capacity);
+    if (ftruncate(fd, size) == -1) {
+        log_error("Could not size pose history file: %s\n", strerror(errno));
+        close(fd);
+        unlink(path);
+        return;
+    }
+
+    void* mapped = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        log_error("Could not map pose history file: %s\n", strerror(errno));
+        unlink(path);
+        return;
+    }
+
+    pose_history_region_type* new_region = (pose_history_region_type*)mapped;
+    new_region->version = POSE_HISTORY_VERSION;
+    new_region->header_size = offsetof(pose_history_region_type, entries);
+    new_region->entry_size = sizeof(pose_history_entry_type);
+    new_region->capacity = capacity;
+
+    atomic_thread_fence(memory_order_release);
+    new_region->magic = POSE_HISTORY_MAGIC;
+
+    history_region = new_region;
+    history_head = 0;
+}
+
+void pose_history_publish(uint32_t capacity, const pose_history_entry_type *entry) {
+    if (capacity > POSE_HISTORY_MAX_CAPACITY) capacity = POSE_HISTORY_MAX_CAPACITY;
+    if (capacity != history_capacity) {
+        history_close();
+        if (capacity > 0) history_open(capacity);
+
+        // not retried if opening failed, until the capacity changes again
+        history_capacity = capacity;
+    }
+    if (!history_region) return;
+
+    uint64_t index = history_head++;
+    pose_history_entry_type* slot = &history_region->entries[index % history_region->capacity];
+    atomic_store_explicit(&slot->sequence, 2 * index + 1, memory_order_relaxed);
+
+    // the odd sequence must be visible before any of the entry changes
+    atomic_thread_fence(memory_order_release);
+    slot->host_timestamp_ns = entry->host_timestamp_ns;
+    slot->device_timestamp_ns = entry->device_timestamp_ns;
+    memcpy(slot->orientation, entry->orientation, sizeof(slot->orientation));
+    memcpy(slot->position, entry->position, sizeof(slot->position));
+    slot->flags = entry->flags;
+
+    atomic_store_explicit(&slot->sequence, 2 * index + 2, memory_order_release);
+    atomic_store_explicit(&history_region->head, index + 1, memory_order_release);
+}
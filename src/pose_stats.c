@@ -0,0 +1,113 @@
+#include "logging.h"
+#include "pose_stats.h"
+#include "state.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const char* pose_stats_filename = "xr_driver_stats";
+
+static pose_stats_block_type* stats_block = NULL;
+
+// checked by every pose_stats_record, stats_block is set before this is first turned on
+static atomic_bool recording = ATOMIC_VAR_INIT(false);
+
+static const char* stage_names[POSE_STATS_STAGE_COUNT] = {
+    [POSE_STATS_INGEST] = "ingest",
+    [POSE_STATS_PIPELINE_WAIT] = "pipeline_wait",
+    [POSE_STATS_REFERENCE_POSE] = "reference_pose",
+    [POSE_STATS_MODIFY_POSE] = "modify_pose",
+    [POSE_STATS_DEAD_ZONE] = "dead_zone",
+    [POSE_STATS_SHM_PUBLISH] = "shm_publish",
+    [POSE_STATS_GAMESCOPE_FLUSH] = "gamescope_flush",
+    [POSE_STATS_GAMESCOPE_SEND] = "gamescope_send",
+    [POSE_STATS_END_TO_END] = "end_to_end"
+};
+
+static void create_stats_block() {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", state_files_directory, pose_stats_filename);
+
+    mode_t old_umask = umask(0);
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    umask(old_umask);
+    if (fd == -1) {
+        log_error("Could not create pose stats file %s: %s\n", path, strerror(errno));
+        return;
+    }
+
+    // truncating first zeroes out anything left from a previous run
+    if (ftruncate(fd, 0) == -1 || ftruncate(fd, sizeof(pose_stats_block_type)) == -1) {
+        log_error("Could not size pose stats file: %s\n", strerror(errno));
+        close(fd);
+        return;
+    }
+
+    void* mapped = mmap(NULL, sizeof(pose_stats_block_type), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        log_error("Could not map pose stats file: %s\n", strerror(errno));
+        return;
+    }
+
+    pose_stats_block_type* block = (pose_stats_block_type*)mapped;
+    block->header_size = offsetof(pose_stats_block_type, stages);
+    block->stage_size = sizeof(pose_stats_histogram_type);
+    block->stage_count = POSE_STATS_STAGE_COUNT;
+    block->bucket_count = POSE_STATS_BUCKETS;
+    block->version = POSE_STATS_VERSION;
+    for (int i = 0; i < POSE_STATS_STAGE_COUNT; i++) {
+        if (stage_names[i]) strncpy(block->stages[i].name, stage_names[i], POSE_STATS_NAME_LENGTH - 1);
+    }
+
+    // readers check the magic last, once everything else is in place
+    atomic_thread_fence(memory_order_release);
+    block->magic = POSE_STATS_MAGIC;
+
+    stats_block = block;
+}
+
+void pose_stats_set_enabled(bool enabled) {
+    if (enabled == atomic_load_explicit(&recording, memory_order_relaxed)) return;
+
+    if (enabled && !stats_block) {
+        create_stats_block();
+        if (!stats_block) return;
+    }
+
+    atomic_store_explicit(&recording, enabled, memory_order_release);
+}
+
+void pose_stats_set_stage_name(pose_stats_stage_type stage, const char* name) {
+    if (stage >= POSE_STATS_STAGE_COUNT || !name) return;
+
+    stage_names[stage] = name;
+    if (stats_block) strncpy(stats_block->stages[stage].name, name, POSE_STATS_NAME_LENGTH - 1);
+}
+
+static inline int bucket_for(uint64_t elapsed_ns) {
+    if (elapsed_ns == 0) return 0;
+
+    int bucket = 63 - __builtin_clzll(elapsed_ns);
+    return bucket < POSE_STATS_BUCKETS ? bucket : POSE_STATS_BUCKETS - 1;
+}
+
+void pose_stats_record(pose_stats_stage_type stage, uint64_t elapsed_ns) {
+    if (!atomic_load_explicit(&recording, memory_order_acquire)) return;
+
+    pose_stats_histogram_type* histogram = &stats_block->stages[stage];
+    atomic_fetch_add_explicit(&histogram->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->total_ns, elapsed_ns, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->buckets[bucket_for(elapsed_ns)], 1, memory_order_relaxed);
+
+    uint64_t max_ns = atomic_load_explicit(&histogram->max_ns, memory_order_relaxed);
+    while (elapsed_ns > max_ns &&
+           !atomic_compare_exchange_weak_explicit(&histogram->max_ns, &max_ns, elapsed_ns,
+                                                  memory_order_relaxed, memory_order_relaxed));
+}
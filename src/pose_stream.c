@@ -0,0 +1,313 @@
+#include "epoch.h"
+#include "files.h"
+#include "logging.h"
+#include "memory.h"
+#include "pose_stream.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+const char* pose_stream_socket_filename = "pose_stream.sock";
+
+// 64ms of poses at 1000Hz, the stream thread only falls that far behind if it's starved of CPU
+#define STREAM_RING_CAPACITY 64
+
+// clients that have connected but not sent their request yet also take up a connection
+#define MAX_CONNECTIONS (POSE_STREAM_MAX_SUBSCRIBERS * 2)
+
+// Poses are written once into this ring by the pose pipeline and fanned out to every subscriber by the stream
+// thread, so the pipeline's cost doesn't depend on the number of subscribers. Each slot is a seqlock whose
+// sequence also says which pose it holds, as in the shm pose history ring.
+struct stream_slot_t {
+    _Alignas(64) _Atomic uint64_t sequence;
+    pose_stream_sample_type sample;
+};
+
+static struct stream_slot_t ring[STREAM_RING_CAPACITY];
+
+// number of poses ever written to the ring
+static _Atomic uint64_t ring_head = 0;
+
+// written by the stream thread only, lets the pipeline skip the ring while there's no one to send to
+static atomic_int subscriber_count = 0;
+
+// the pipeline only writes to wake_fd while the stream thread says it's about to sleep, see pose_stream_publish
+static int wake_fd = -1;
+static atomic_bool stream_thread_waiting = false;
+
+struct stream_connection_t {
+    int fd;
+    bool subscribed;
+
+    uint32_t fields;
+    uint32_t timestamp_format;
+    uint64_t min_interval_ns;
+    uint64_t next_due_ns;
+    uint32_t dropped;
+};
+
+static int listen_fd = -1;
+static pthread_t stream_thread;
+
+void pose_stream_publish(const pose_stream_sample_type* sample) {
+    if (atomic_load_explicit(&subscriber_count, memory_order_relaxed) == 0) return;
+
+    uint64_t index = atomic_load_explicit(&ring_head, memory_order_relaxed);
+    struct stream_slot_t* slot = &ring[index % STREAM_RING_CAPACITY];
+    atomic_store_explicit(&slot->sequence, 2 * index + 1, memory_order_relaxed);
+
+    // the odd sequence must be visible before any of the sample changes
+    atomic_thread_fence(memory_order_release);
+    memcpy(&slot->sample, sample, sizeof(pose_stream_sample_type));
+    atomic_store_explicit(&slot->sequence, 2 * index + 2, memory_order_release);
+
+    // Both sides use sequentially consistent operations on ring_head and stream_thread_waiting: either this
+    // sees the thread waiting and wakes it, or the thread sees the new head and doesn't go to sleep.
+    atomic_store(&ring_head, index + 1);
+    if (atomic_load(&stream_thread_waiting)) {
+        uint64_t one = 1;
+        if (write(wake_fd, &one, sizeof(one)) == -1 && errno != EAGAIN)
+            log_debug("Pose stream: wake write failed: %s\n", strerror(errno));
+    }
+}
+
+static bool read_slot(uint64_t index, pose_stream_sample_type* out) {
+    struct stream_slot_t* slot = &ring[index % STREAM_RING_CAPACITY];
+    uint64_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+    if (sequence != 2 * index + 2) return false;
+
+    memcpy(out, &slot->sample, sizeof(pose_stream_sample_type));
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&slot->sequence, memory_order_relaxed) == sequence;
+}
+
+static size_t put_floats(uint8_t* buffer, size_t offset, const float* values, int count) {
+    memcpy(buffer + offset, values, count * sizeof(float));
+    return offset + count * sizeof(float);
+}
+
+// returns false if the subscriber has gone away and should be dropped
+static bool send_sample(struct stream_connection_t* connection, uint64_t index,
+                        const pose_stream_sample_type* sample) {
+    if (connection->min_interval_ns) {
+        if (sample->timestamp_ns < connection->next_due_ns) return true;
+
+        // keeps the average rate exact rather than drifting by up to a pose interval per message
+        connection->next_due_ns += connection->min_interval_ns;
+        if (connection->next_due_ns <= sample->timestamp_ns)
+            connection->next_due_ns = sample->timestamp_ns + connection->min_interval_ns;
+    }
+
+    uint8_t buffer[POSE_STREAM_MAX_MESSAGE_SIZE];
+    pose_stream_message_header_type header = {
+        .sequence = index,
+        .fields = connection->fields,
+        .flags = sample->flags,
+        .dropped = connection->dropped
+    };
+    switch (connection->timestamp_format) {
+        case POSE_STREAM_TIMESTAMP_EPOCH_MS:
+            header.timestamp = monotonic_to_epoch_ms(sample->timestamp_ns);
+            break;
+        case POSE_STREAM_TIMESTAMP_DEVICE_NS:
+            header.timestamp = sample->device_timestamp_ns;
+            break;
+        default:
+            header.timestamp = sample->timestamp_ns;
+            break;
+    }
+    memcpy(buffer, &header, sizeof(header));
+
+    size_t length = sizeof(header);
+    if (connection->fields & POSE_STREAM_FIELD_ORIENTATION)
+        length = put_floats(buffer, length, (const float*)&sample->orientation, 4);
+    if (connection->fields & POSE_STREAM_FIELD_POSITION)
+        length = put_floats(buffer, length, (const float*)&sample->position, 3);
+    if (connection->fields & POSE_STREAM_FIELD_EULER)
+        length = put_floats(buffer, length, (const float*)&sample->euler, 3);
+    if (connection->fields & POSE_STREAM_FIELD_VELOCITY)
+        length = put_floats(buffer, length, (const float*)&sample->velocity, 3);
+
+    if (send(connection->fd, buffer, length, MSG_DONTWAIT | MSG_NOSIGNAL) == -1) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) return false;
+
+        // a full socket buffer means the subscriber isn't keeping up, it'll see the count on its next message
+        connection->dropped++;
+    }
+
+    return true;
+}
+
+static void send_response(int fd, uint32_t status) {
+    pose_stream_response_type response = {
+        .version = POSE_STREAM_PROTOCOL_VERSION,
+        .status = status
+    };
+    if (send(fd, &response, sizeof(response), MSG_DONTWAIT | MSG_NOSIGNAL) == -1)
+        log_debug("Pose stream: could not reply to client: %s\n", strerror(errno));
+}
+
+// returns false if the client should be disconnected
+static bool handle_request(struct stream_connection_t* connection) {
+    pose_stream_request_type request = {0};
+    ssize_t bytes = recv(connection->fd, &request, sizeof(request), MSG_DONTWAIT);
+    if (bytes == -1) return errno == EAGAIN || errno == EINTR;
+    if (bytes == 0) return false;
+
+    uint32_t status = POSE_STREAM_STATUS_OK;
+    if (bytes < (ssize_t)sizeof(uint32_t) || request.version != POSE_STREAM_PROTOCOL_VERSION) {
+        status = POSE_STREAM_STATUS_UNSUPPORTED_VERSION;
+    } else if (bytes != sizeof(request) || (request.fields & ~POSE_STREAM_FIELDS_ALL) != 0 ||
+               request.timestamp_format > POSE_STREAM_TIMESTAMP_DEVICE_NS) {
+        status = POSE_STREAM_STATUS_INVALID_REQUEST;
+    } else if (atomic_load_explicit(&subscriber_count, memory_order_relaxed) >= POSE_STREAM_MAX_SUBSCRIBERS) {
+        status = POSE_STREAM_STATUS_FULL;
+    }
+
+    send_response(connection->fd, status);
+    if (status != POSE_STREAM_STATUS_OK) return false;
+
+    connection->subscribed = true;
+    connection->fields = request.fields;
+    connection->timestamp_format = request.timestamp_format;
+    connection->min_interval_ns = request.max_rate_hz ? NS_PER_SEC / request.max_rate_hz : 0;
+    connection->next_due_ns = 0;
+    connection->dropped = 0;
+    atomic_fetch_add_explicit(&subscriber_count, 1, memory_order_relaxed);
+
+    return true;
+}
+
+static void* stream_thread_func(void* arg) {
+    (void)arg;
+
+    struct stream_connection_t connections[MAX_CONNECTIONS];
+    int connection_count = 0;
+    struct pollfd poll_fds[MAX_CONNECTIONS + 2];
+
+    uint64_t next_index = atomic_load(&ring_head);
+    while (true) {
+        poll_fds[0] = (struct pollfd){ .fd = wake_fd, .events = POLLIN };
+        poll_fds[1] = (struct pollfd){ .fd = listen_fd, .events = connection_count < MAX_CONNECTIONS ? POLLIN : 0 };
+        for (int i = 0; i < connection_count; i++)
+            poll_fds[i + 2] = (struct pollfd){ .fd = connections[i].fd, .events = POLLIN };
+
+        atomic_store(&stream_thread_waiting, true);
+        bool caught_up = atomic_load(&ring_head) == next_index;
+        int result = poll(poll_fds, connection_count + 2, caught_up ? -1 : 0);
+        atomic_store(&stream_thread_waiting, false);
+        if (result == -1) {
+            if (errno == EINTR) continue;
+
+            log_error("Pose stream: poll failed, no longer streaming poses: %s\n", strerror(errno));
+            break;
+        }
+
+        if (poll_fds[0].revents & POLLIN) {
+            uint64_t wakes;
+            if (read(wake_fd, &wakes, sizeof(wakes)) == -1 && errno != EAGAIN)
+                log_debug("Pose stream: wake read failed: %s\n", strerror(errno));
+        }
+
+        // walk backwards so removing a connection doesn't disturb the ones not visited yet
+        for (int i = connection_count - 1; i >= 0; i--) {
+            if (!poll_fds[i + 2].revents) continue;
+
+            struct stream_connection_t* connection = &connections[i];
+            bool keep;
+            if (!connection->subscribed) {
+                keep = handle_request(connection);
+            } else {
+                // subscribers have nothing more to say, anything readable is either a hangup or noise
+                char discard[64];
+                ssize_t bytes = recv(connection->fd, discard, sizeof(discard), MSG_DONTWAIT);
+                keep = bytes > 0 || (bytes == -1 && (errno == EAGAIN || errno == EINTR));
+            }
+
+            if (!keep) {
+                if (connection->subscribed) atomic_fetch_sub_explicit(&subscriber_count, 1, memory_order_relaxed);
+                close(connection->fd);
+                connections[i] = connections[--connection_count];
+            }
+        }
+
+        if (poll_fds[1].revents & POLLIN) {
+            int fd = accept(listen_fd, NULL, NULL);
+            if (fd == -1) {
+                if (errno != EAGAIN && errno != EINTR)
+                    log_error("Pose stream: accept failed: %s\n", strerror(errno));
+            } else {
+                fcntl(fd, F_SETFD, FD_CLOEXEC);
+                connections[connection_count++] = (struct stream_connection_t){ .fd = fd };
+            }
+        }
+
+        uint64_t head = atomic_load(&ring_head);
+        if (head - next_index > STREAM_RING_CAPACITY) {
+            // lapped, everything that was overwritten counts as dropped for everyone
+            uint32_t lost = (uint32_t)(head - STREAM_RING_CAPACITY - next_index);
+            for (int i = 0; i < connection_count; i++) connections[i].dropped += lost;
+            next_index = head - STREAM_RING_CAPACITY;
+        }
+
+        for (; next_index < head; next_index++) {
+            pose_stream_sample_type sample;
+            if (!read_slot(next_index, &sample)) {
+                // only happens if the pipeline lapped us mid-read
+                for (int i = 0; i < connection_count; i++) connections[i].dropped++;
+                continue;
+            }
+
+            for (int i = connection_count - 1; i >= 0; i--) {
+                struct stream_connection_t* connection = &connections[i];
+                if (!connection->subscribed || send_sample(connection, next_index, &sample)) continue;
+
+                atomic_fetch_sub_explicit(&subscriber_count, 1, memory_order_relaxed);
+                close(connection->fd);
+                connections[i] = connections[--connection_count];
+            }
+        }
+    }
+
+    for (int i = 0; i < connection_count; i++) close(connections[i].fd);
+    atomic_store(&subscriber_count, 0);
+    close(listen_fd);
+    listen_fd = -1;
+
+    return NULL;
+}
+
+void pose_stream_init() {
+    if (listen_fd != -1) return;
+
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd == -1) {
+        log_error("Could not create pose stream wake eventfd: %s\n", strerror(errno));
+        return;
+    }
+
+    char* path = NULL;
+    int fd = listen_on_runtime_socket(pose_stream_socket_filename, SOCK_SEQPACKET, POSE_STREAM_MAX_SUBSCRIBERS, &path);
+    if (fd == -1) {
+        log_error("Could not listen on pose stream socket %s: %s\n", path, strerror(errno));
+        close(wake_fd);
+        wake_fd = -1;
+        free_and_clear(&path);
+        return;
+    }
+    free_and_clear(&path);
+
+    listen_fd = fd;
+
+    pthread_create(&stream_thread, NULL, stream_thread_func, NULL);
+    pthread_detach(stream_thread);
+}
@@ -0,0 +1,350 @@
+#include "imu.h"
+#include "quat_kernels.h"
+
+#include <math.h>
+#include <stdint.h>
+
+// imu_quat_type is laid out x, y, z, w, so one quaternion fills one 4-lane register as-is
+_Static_assert(sizeof(imu_quat_type) == 4 * sizeof(float), "imu_quat_type must be 4 packed floats");
+_Static_assert(sizeof(imu_vec3_type) == 3 * sizeof(float), "imu_vec3_type must be 3 packed floats");
+
+static void scalar_multiply(const imu_quat_type* a, const imu_quat_type* b, imu_quat_type* out, int count) {
+    for (int i = 0; i < count; i++) out[i] = multiply_quaternions_unnormalized(a[i], b[i]);
+}
+
+static void scalar_renormalize_lazy(imu_quat_type* q, int count) {
+    for (int i = 0; i < count; i++) q[i] = renormalize_quaternion_lazy(q[i]);
+}
+
+static void scalar_nlerp(const imu_quat_type* from, const imu_quat_type* to, const float* t, imu_quat_type* out,
+                         int count) {
+    for (int i = 0; i < count; i++) out[i] = quat_nlerp(from[i], to[i], t[i]);
+}
+
+static void scalar_rotate(const imu_vec3_type* v, const imu_quat_type* q, imu_vec3_type* out, int count) {
+    for (int i = 0; i < count; i++) out[i] = vector_rotate(v[i], q[i]);
+}
+
+#define SCALAR_KERNELS {                            \
+    .name = "scalar",                               \
+    .multiply = scalar_multiply,                    \
+    .renormalize_lazy = scalar_renormalize_lazy,    \
+    .nlerp = scalar_nlerp,                          \
+    .rotate = scalar_rotate                         \
+}
+
+static const quat_kernels_type scalar_kernels = SCALAR_KERNELS;
+quat_kernels_type quat_kernels = SCALAR_KERNELS;
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+
+// compiled for the newer instruction sets per function, only ever called once the CPU has been checked
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+
+// The Hamilton product a * b as a sum of b's components, shuffled and sign-flipped, scaled by each of a's:
+//   a.w * (b.x,  b.y,  b.z,  b.w)
+// + a.x * (b.w, -b.z,  b.y, -b.x)
+// + a.y * (b.z,  b.w, -b.x, -b.y)
+// + a.z * (-b.y, b.x,  b.w, -b.z)
+static inline TARGET_SSE41 __m128 sse_quat_multiply(__m128 a, __m128 b) {
+    const __m128 sign_x = _mm_set_ps(-0.0f, 0.0f, -0.0f, 0.0f);
+    const __m128 sign_y = _mm_set_ps(-0.0f, -0.0f, 0.0f, 0.0f);
+    const __m128 sign_z = _mm_set_ps(-0.0f, 0.0f, 0.0f, -0.0f);
+
+    __m128 b_x = _mm_xor_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 1, 2, 3)), sign_x);
+    __m128 b_y = _mm_xor_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 0, 3, 2)), sign_y);
+    __m128 b_z = _mm_xor_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 3, 0, 1)), sign_z);
+
+    __m128 out = _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3)), b);
+    out = _mm_add_ps(out, _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 0, 0)), b_x));
+    out = _mm_add_ps(out, _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 1, 1, 1)), b_y));
+    return _mm_add_ps(out, _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 2, 2)), b_z));
+}
+
+// t is the same in every lane
+static inline TARGET_SSE41 __m128 sse_quat_nlerp(__m128 from, __m128 to, __m128 t) {
+    const __m128 zero = _mm_setzero_ps();
+
+    // onto from's hemisphere, same as quat_nlerp
+    __m128 dot = _mm_dp_ps(from, to, 0xFF);
+    to = _mm_xor_ps(to, _mm_and_ps(_mm_cmplt_ps(dot, zero), _mm_set1_ps(-0.0f)));
+
+    t = _mm_min_ps(_mm_max_ps(t, zero), _mm_set1_ps(1.0f));
+    __m128 out = _mm_add_ps(from, _mm_mul_ps(_mm_sub_ps(to, from), t));
+
+    __m128 length = _mm_sqrt_ps(_mm_dp_ps(out, out, 0xFF));
+    return _mm_blendv_ps(out, _mm_div_ps(out, length), _mm_cmpgt_ps(length, zero));
+}
+
+// a x b, in the first 3 lanes
+static inline TARGET_SSE41 __m128 sse_cross(__m128 a, __m128 b) {
+    __m128 a_yzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 b_yzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 zxy = _mm_sub_ps(_mm_mul_ps(a, b_yzx), _mm_mul_ps(a_yzx, b));
+    return _mm_shuffle_ps(zxy, zxy, _MM_SHUFFLE(3, 0, 2, 1));
+}
+
+static inline TARGET_SSE41 void sse_rotate_one(const imu_vec3_type* v, const imu_quat_type* q, imu_vec3_type* out) {
+    __m128 vector = _mm_setr_ps(v->x, v->y, v->z, 0.0f);
+    __m128 quat = _mm_loadu_ps(&q->x);
+
+    // same as vector_rotate: t = 2 (q.xyz x v), out = v + q.w t + q.xyz x t
+    __m128 t = _mm_mul_ps(_mm_set1_ps(2.0f), sse_cross(quat, vector));
+    __m128 rotated = _mm_add_ps(vector, _mm_mul_ps(_mm_shuffle_ps(quat, quat, _MM_SHUFFLE(3, 3, 3, 3)), t));
+    rotated = _mm_add_ps(rotated, sse_cross(quat, t));
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, rotated);
+    *out = (imu_vec3_type){ .x = lanes[0], .y = lanes[1], .z = lanes[2] };
+}
+
+static TARGET_SSE41 void sse41_multiply(const imu_quat_type* a, const imu_quat_type* b, imu_quat_type* out,
+                                        int count) {
+    for (int i = 0; i < count; i++)
+        _mm_storeu_ps(&out[i].x, sse_quat_multiply(_mm_loadu_ps(&a[i].x), _mm_loadu_ps(&b[i].x)));
+}
+
+// 4 at a time, transposed so each lane sums one quaternion's squares
+static TARGET_SSE41 void sse41_renormalize_lazy(imu_quat_type* q, int count) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 tolerance = _mm_set1_ps(QUAT_RENORMALIZE_TOLERANCE);
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 q0 = _mm_loadu_ps(&q[i].x);
+        __m128 q1 = _mm_loadu_ps(&q[i + 1].x);
+        __m128 q2 = _mm_loadu_ps(&q[i + 2].x);
+        __m128 q3 = _mm_loadu_ps(&q[i + 3].x);
+        __m128 s0 = _mm_mul_ps(q0, q0);
+        __m128 s1 = _mm_mul_ps(q1, q1);
+        __m128 s2 = _mm_mul_ps(q2, q2);
+        __m128 s3 = _mm_mul_ps(q3, q3);
+        _MM_TRANSPOSE4_PS(s0, s1, s2, s3);
+        __m128 magnitude_squared = _mm_add_ps(_mm_add_ps(s0, s1), _mm_add_ps(s2, s3));
+
+        // NaN compares false, so it's treated as out of tolerance like in renormalize_quaternion_lazy
+        __m128 drift = _mm_and_ps(_mm_sub_ps(magnitude_squared, one), abs_mask);
+        int in_tolerance = _mm_movemask_ps(_mm_cmple_ps(drift, tolerance));
+        if (in_tolerance == 0xF) continue;
+
+        for (int j = 0; j < 4; j++) {
+            if (!(in_tolerance & (1 << j))) q[i + j] = normalize_quaternion(q[i + j]);
+        }
+    }
+    for (; i < count; i++) q[i] = renormalize_quaternion_lazy(q[i]);
+}
+
+static TARGET_SSE41 void sse41_nlerp(const imu_quat_type* from, const imu_quat_type* to, const float* t,
+                                     imu_quat_type* out, int count) {
+    for (int i = 0; i < count; i++) {
+        _mm_storeu_ps(&out[i].x, sse_quat_nlerp(_mm_loadu_ps(&from[i].x), _mm_loadu_ps(&to[i].x),
+                                                _mm_set1_ps(t[i])));
+    }
+}
+
+static TARGET_SSE41 void sse41_rotate(const imu_vec3_type* v, const imu_quat_type* q, imu_vec3_type* out,
+                                      int count) {
+    for (int i = 0; i < count; i++) sse_rotate_one(&v[i], &q[i], &out[i]);
+}
+
+static const quat_kernels_type sse41_kernels = {
+    .name = "sse4.1",
+    .multiply = sse41_multiply,
+    .renormalize_lazy = sse41_renormalize_lazy,
+    .nlerp = sse41_nlerp,
+    .rotate = sse41_rotate
+};
+
+// Two quaternions per register. The permutes and dot products work within each 128-bit half, so this is
+// sse_quat_multiply and sse_quat_nlerp side by side.
+static inline TARGET_AVX2 __m256 avx2_quat_multiply(__m256 a, __m256 b) {
+    const __m256 sign_x = _mm256_set_ps(-0.0f, 0.0f, -0.0f, 0.0f, -0.0f, 0.0f, -0.0f, 0.0f);
+    const __m256 sign_y = _mm256_set_ps(-0.0f, -0.0f, 0.0f, 0.0f, -0.0f, -0.0f, 0.0f, 0.0f);
+    const __m256 sign_z = _mm256_set_ps(-0.0f, 0.0f, 0.0f, -0.0f, -0.0f, 0.0f, 0.0f, -0.0f);
+
+    __m256 b_x = _mm256_xor_ps(_mm256_permute_ps(b, _MM_SHUFFLE(0, 1, 2, 3)), sign_x);
+    __m256 b_y = _mm256_xor_ps(_mm256_permute_ps(b, _MM_SHUFFLE(1, 0, 3, 2)), sign_y);
+    __m256 b_z = _mm256_xor_ps(_mm256_permute_ps(b, _MM_SHUFFLE(2, 3, 0, 1)), sign_z);
+
+    __m256 out = _mm256_mul_ps(_mm256_permute_ps(a, _MM_SHUFFLE(3, 3, 3, 3)), b);
+    out = _mm256_fmadd_ps(_mm256_permute_ps(a, _MM_SHUFFLE(0, 0, 0, 0)), b_x, out);
+    out = _mm256_fmadd_ps(_mm256_permute_ps(a, _MM_SHUFFLE(1, 1, 1, 1)), b_y, out);
+    return _mm256_fmadd_ps(_mm256_permute_ps(a, _MM_SHUFFLE(2, 2, 2, 2)), b_z, out);
+}
+
+static inline TARGET_AVX2 __m256 avx2_quat_nlerp(__m256 from, __m256 to, __m256 t) {
+    const __m256 zero = _mm256_setzero_ps();
+
+    __m256 dot = _mm256_dp_ps(from, to, 0xFF);
+    to = _mm256_xor_ps(to, _mm256_and_ps(_mm256_cmp_ps(dot, zero, _CMP_LT_OQ), _mm256_set1_ps(-0.0f)));
+
+    t = _mm256_min_ps(_mm256_max_ps(t, zero), _mm256_set1_ps(1.0f));
+    __m256 out = _mm256_fmadd_ps(_mm256_sub_ps(to, from), t, from);
+
+    __m256 length = _mm256_sqrt_ps(_mm256_dp_ps(out, out, 0xFF));
+    return _mm256_blendv_ps(out, _mm256_div_ps(out, length), _mm256_cmp_ps(length, zero, _CMP_GT_OQ));
+}
+
+static TARGET_AVX2 void avx2_multiply(const imu_quat_type* a, const imu_quat_type* b, imu_quat_type* out,
+                                      int count) {
+    int i = 0;
+    for (; i + 2 <= count; i += 2)
+        _mm256_storeu_ps(&out[i].x, avx2_quat_multiply(_mm256_loadu_ps(&a[i].x), _mm256_loadu_ps(&b[i].x)));
+    if (i < count)
+        _mm_storeu_ps(&out[i].x, sse_quat_multiply(_mm_loadu_ps(&a[i].x), _mm_loadu_ps(&b[i].x)));
+}
+
+static TARGET_AVX2 void avx2_nlerp(const imu_quat_type* from, const imu_quat_type* to, const float* t,
+                                   imu_quat_type* out, int count) {
+    int i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m256 t_pair = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(t[i])), _mm_set1_ps(t[i + 1]), 1);
+        _mm256_storeu_ps(&out[i].x, avx2_quat_nlerp(_mm256_loadu_ps(&from[i].x), _mm256_loadu_ps(&to[i].x), t_pair));
+    }
+    if (i < count) {
+        _mm_storeu_ps(&out[i].x, sse_quat_nlerp(_mm_loadu_ps(&from[i].x), _mm_loadu_ps(&to[i].x),
+                                                _mm_set1_ps(t[i])));
+    }
+}
+
+// these gain nothing from the wider registers, but are built with the VEX encoding to match the rest of the set
+static TARGET_AVX2 void avx2_renormalize_lazy(imu_quat_type* q, int count) {
+    sse41_renormalize_lazy(q, count);
+}
+
+static TARGET_AVX2 void avx2_rotate(const imu_vec3_type* v, const imu_quat_type* q, imu_vec3_type* out,
+                                    int count) {
+    for (int i = 0; i < count; i++) sse_rotate_one(&v[i], &q[i], &out[i]);
+}
+
+static const quat_kernels_type avx2_kernels = {
+    .name = "avx2",
+    .multiply = avx2_multiply,
+    .renormalize_lazy = avx2_renormalize_lazy,
+    .nlerp = avx2_nlerp,
+    .rotate = avx2_rotate
+};
+
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+
+// same decomposition as sse_quat_multiply, b's shuffles are pairwise reversals and rotations
+static inline float32x4_t neon_quat_multiply(float32x4_t a, float32x4_t b) {
+    const float32x4_t sign_x = { 1.0f, -1.0f, 1.0f, -1.0f };
+    const float32x4_t sign_y = { 1.0f, 1.0f, -1.0f, -1.0f };
+    const float32x4_t sign_z = { -1.0f, 1.0f, 1.0f, -1.0f };
+
+    float32x4_t b_zwxy = vextq_f32(b, b, 2);
+    float32x4_t b_x = vmulq_f32(vrev64q_f32(b_zwxy), sign_x);
+    float32x4_t b_y = vmulq_f32(b_zwxy, sign_y);
+    float32x4_t b_z = vmulq_f32(vrev64q_f32(b), sign_z);
+
+    float32x4_t out = vmulq_laneq_f32(b, a, 3);
+    out = vfmaq_laneq_f32(out, b_x, a, 0);
+    out = vfmaq_laneq_f32(out, b_y, a, 1);
+    return vfmaq_laneq_f32(out, b_z, a, 2);
+}
+
+static void neon_multiply(const imu_quat_type* a, const imu_quat_type* b, imu_quat_type* out, int count) {
+    for (int i = 0; i < count; i++)
+        vst1q_f32(&out[i].x, neon_quat_multiply(vld1q_f32(&a[i].x), vld1q_f32(&b[i].x)));
+}
+
+// vld4q loads 4 quaternions already transposed, one register per component
+static void neon_renormalize_lazy(imu_quat_type* q, int count) {
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t tolerance = vdupq_n_f32(QUAT_RENORMALIZE_TOLERANCE);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4x4_t components = vld4q_f32(&q[i].x);
+        float32x4_t magnitude_squared = vmulq_f32(components.val[0], components.val[0]);
+        magnitude_squared = vfmaq_f32(magnitude_squared, components.val[1], components.val[1]);
+        magnitude_squared = vfmaq_f32(magnitude_squared, components.val[2], components.val[2]);
+        magnitude_squared = vfmaq_f32(magnitude_squared, components.val[3], components.val[3]);
+
+        // NaN compares false, so it's treated as out of tolerance like in renormalize_quaternion_lazy
+        uint32x4_t in_tolerance = vcleq_f32(vabsq_f32(vsubq_f32(magnitude_squared, one)), tolerance);
+        if (vminvq_u32(in_tolerance) == UINT32_MAX) continue;
+
+        uint32_t lanes[4];
+        vst1q_u32(lanes, in_tolerance);
+        for (int j = 0; j < 4; j++) {
+            if (!lanes[j]) q[i + j] = normalize_quaternion(q[i + j]);
+        }
+    }
+    for (; i < count; i++) q[i] = renormalize_quaternion_lazy(q[i]);
+}
+
+static void neon_nlerp(const imu_quat_type* from, const imu_quat_type* to, const float* t, imu_quat_type* out,
+                       int count) {
+    for (int i = 0; i < count; i++) {
+        float32x4_t from_quat = vld1q_f32(&from[i].x);
+        float32x4_t to_quat = vld1q_f32(&to[i].x);
+        if (vaddvq_f32(vmulq_f32(from_quat, to_quat)) < 0.0f) to_quat = vnegq_f32(to_quat);
+
+        float t_clamped = t[i] < 0.0f ? 0.0f : (t[i] > 1.0f ? 1.0f : t[i]);
+        float32x4_t lerped = vfmaq_n_f32(from_quat, vsubq_f32(to_quat, from_quat), t_clamped);
+
+        float length = sqrtf(vaddvq_f32(vmulq_f32(lerped, lerped)));
+        if (length > 0.0f) lerped = vdivq_f32(lerped, vdupq_n_f32(length));
+        vst1q_f32(&out[i].x, lerped);
+    }
+}
+
+// 4 at a time, with vld3q/vld4q doing the transposing, then vector_rotate's arithmetic lane-wise
+static void neon_rotate(const imu_vec3_type* v, const imu_quat_type* q, imu_vec3_type* out, int count) {
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4x3_t vector = vld3q_f32(&v[i].x);
+        float32x4x4_t quat = vld4q_f32(&q[i].x);
+        float32x4_t vx = vector.val[0], vy = vector.val[1], vz = vector.val[2];
+        float32x4_t qx = quat.val[0], qy = quat.val[1], qz = quat.val[2], qw = quat.val[3];
+
+        float32x4_t tx = vmulq_n_f32(vsubq_f32(vmulq_f32(qy, vz), vmulq_f32(qz, vy)), 2.0f);
+        float32x4_t ty = vmulq_n_f32(vsubq_f32(vmulq_f32(qz, vx), vmulq_f32(qx, vz)), 2.0f);
+        float32x4_t tz = vmulq_n_f32(vsubq_f32(vmulq_f32(qx, vy), vmulq_f32(qy, vx)), 2.0f);
+
+        float32x4x3_t rotated;
+        rotated.val[0] = vaddq_f32(vfmaq_f32(vx, qw, tx), vsubq_f32(vmulq_f32(qy, tz), vmulq_f32(qz, ty)));
+        rotated.val[1] = vaddq_f32(vfmaq_f32(vy, qw, ty), vsubq_f32(vmulq_f32(qz, tx), vmulq_f32(qx, tz)));
+        rotated.val[2] = vaddq_f32(vfmaq_f32(vz, qw, tz), vsubq_f32(vmulq_f32(qx, ty), vmulq_f32(qy, tx)));
+        vst3q_f32(&out[i].x, rotated);
+    }
+    for (; i < count; i++) out[i] = vector_rotate(v[i], q[i]);
+}
+
+static const quat_kernels_type neon_kernels = {
+    .name = "neon",
+    .multiply = neon_multiply,
+    .renormalize_lazy = neon_renormalize_lazy,
+    .nlerp = neon_nlerp,
+    .rotate = neon_rotate
+};
+#endif
+
+int quat_kernels_supported(const quat_kernels_type** sets, int max_sets) {
+    int count = 0;
+    if (count < max_sets) sets[count++] = &scalar_kernels;
+
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (count < max_sets && __builtin_cpu_supports("sse4.1")) sets[count++] = &sse41_kernels;
+    if (count < max_sets && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        sets[count++] = &avx2_kernels;
+#elif defined(__aarch64__)
+    // Advanced SIMD is part of the aarch64 baseline, there's nothing to check
+    if (count < max_sets) sets[count++] = &neon_kernels;
+#endif
+
+    return count;
+}
+
+void quat_kernels_init() {
+    const quat_kernels_type* sets[4];
+    int count = quat_kernels_supported(sets, 4);
+    quat_kernels = *sets[count - 1];
+}
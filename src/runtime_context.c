@@ -1,81 +1,218 @@
+#include "config.h"
 #include "devices.h"
+#include "hazard_pointer.h"
+#include "logging.h"
 #include "runtime_context.h"
 
 #include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 runtime_context g_runtime_context;
 
-static int device_ref_count = 0;
+// serializes hot state publishers, so versions are published in order
+static pthread_mutex_t hot_state_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+_Thread_local driver_config_type* held_config = NULL;
+_Thread_local driver_hot_state_type* held_hot_state = NULL;
+static _Thread_local int config_hold_depth = 0;
+static _Thread_local int hot_state_hold_depth = 0;
+
+// The hazard slot keeps protecting the snapshot after the release, like it does after a plain config() call,
+// until the thread's next call moves it on.
+driver_config_type* config_acquire() {
+    if (config_hold_depth++ == 0)
+        held_config = hazard_pointer_protect(HAZARD_SLOT_CONFIG, (void * _Atomic *)&g_runtime_context.config);
+    return held_config;
+}
+
+void config_release() {
+    if (--config_hold_depth == 0) held_config = NULL;
+}
+
+driver_hot_state_type* hot_state_acquire() {
+    if (hot_state_hold_depth++ == 0)
+        held_hot_state = hazard_pointer_protect(HAZARD_SLOT_HOT_STATE,
+                                                (void * _Atomic *)&g_runtime_context.hot_state);
+    return held_hot_state;
+}
+
+void hot_state_release() {
+    if (--hot_state_hold_depth == 0) held_hot_state = NULL;
+}
+
+static void free_config_snapshot(void* ptr) {
+    free_config((driver_config_type*)ptr);
+}
+
+void set_config(driver_config_type *config) {
+    driver_config_type* previous = atomic_exchange(&g_runtime_context.config, config);
+    hazard_pointer_retire(previous, free_config_snapshot);
+}
+
+void set_state(driver_state_type *state) {
+    g_runtime_context.state = state;
+    publish_hot_state();
+}
+
+void publish_hot_state() {
+    driver_hot_state_type* snapshot = malloc(sizeof(driver_hot_state_type));
+    if (snapshot == NULL) {
+        log_error("Error allocating hot state\n");
+        exit(1);
+    }
+
+    pthread_mutex_lock(&hot_state_mutex);
+    driver_state_type* current = g_runtime_context.state;
+    driver_hot_state_type* previous = atomic_load_explicit(&g_runtime_context.hot_state, memory_order_relaxed);
+    snapshot->version = previous ? previous->version + 1 : 1;
+    snapshot->calibration_state = current->calibration_state;
+    snapshot->sbs_mode_enabled = current->sbs_mode_enabled;
+    snapshot->connected_device_pose_has_position = current->connected_device_pose_has_position;
+    snapshot->connected_device_full_distance_cm = current->connected_device_full_distance_cm;
+    snapshot->breezy_desktop_smooth_follow_enabled = current->breezy_desktop_smooth_follow_enabled;
+    snapshot->breezy_desktop_follow_threshold = current->breezy_desktop_follow_threshold;
+    snapshot->breezy_desktop_display_distance = current->breezy_desktop_display_distance;
+    atomic_store_explicit(&g_runtime_context.hot_state, snapshot, memory_order_release);
+    pthread_mutex_unlock(&hot_state_mutex);
+
+    hazard_pointer_retire(previous, free);
+}
+
+// The reference count shares a word with the generation of the device it counts, so checkout and checkin
+// are a single CAS each. A device can only be swapped out once its count has dropped to 0, which bumps the
+// generation, so a reader's CAS can never take a reference to a device that's being released.
+#define DEVICE_REF_COUNT_MASK 0xFFFFFFFFull
+#define DEVICE_REF_GENERATION_SHIFT 32
+
+static _Atomic uint64_t device_ref_state = ATOMIC_VAR_INIT(0);
+
+// vendor and product ids of the current device, so device_checkin can match a device without dereferencing
+// the current device pointer
+static _Atomic uint32_t device_ref_id = ATOMIC_VAR_INIT(0);
+
+// serializes the writers: setting, queueing, and releasing devices. Readers never take it.
 pthread_mutex_t device_ref_count_mutex = PTHREAD_MUTEX_INITIALIZER;
-static device_properties_type* queued_device = NULL;
+static device_properties_type * _Atomic queued_device = NULL;
 static on_device_change_callback on_device_change_callback_func = NULL;
 
+static inline uint32_t ref_count(uint64_t ref_state) {
+    return (uint32_t)(ref_state & DEVICE_REF_COUNT_MASK);
+}
+
+static inline uint64_t next_generation(uint64_t ref_state, uint32_t count) {
+    return (((ref_state >> DEVICE_REF_GENERATION_SHIFT) + 1) << DEVICE_REF_GENERATION_SHIFT) | count;
+}
+
+static inline uint32_t device_id(device_properties_type* device) {
+    return ((uint32_t)device->hid_vendor_id << 16) | (uint16_t)device->hid_product_id;
+}
+
 // the mutex must already be locked when calling this function
 static bool _check_and_set_queued_device() {
-    if (g_runtime_context.device == NULL && queued_device != NULL) {
-        g_runtime_context.device = queued_device;
-        queued_device = NULL;
-        device_ref_count = 1;
+    device_properties_type* queued = atomic_load(&queued_device);
+    if (atomic_load(&g_runtime_context.device) == NULL && queued != NULL) {
+        atomic_store_explicit(&g_runtime_context.device, queued, memory_order_relaxed);
+        atomic_store_explicit(&device_ref_id, device_id(queued), memory_order_relaxed);
+        atomic_store(&queued_device, NULL);
+
+        // publishes the device and its id along with the new generation
+        uint64_t ref_state = atomic_load(&device_ref_state);
+        atomic_store_explicit(&device_ref_state, next_generation(ref_state, 1), memory_order_release);
         return true;
     }
 
     return false;
 }
 
+// called by whichever thread dropped the reference count of this generation to 0
+static void release_device(uint64_t released_state) {
+    device_properties_type* released_device = NULL;
+
+    pthread_mutex_lock(&device_ref_count_mutex);
+    if (atomic_load(&device_ref_state) == released_state) {
+        released_device = atomic_load(&g_runtime_context.device);
+        atomic_store_explicit(&g_runtime_context.device, NULL, memory_order_relaxed);
+        atomic_store_explicit(&device_ref_id, 0, memory_order_relaxed);
+        atomic_store_explicit(&device_ref_state, next_generation(released_state, 0), memory_order_release);
+        _check_and_set_queued_device();
+    }
+    pthread_mutex_unlock(&device_ref_count_mutex);
+
+    if (released_device) {
+        free(released_device);
+        if (on_device_change_callback_func != NULL) on_device_change_callback_func();
+    }
+}
+
 void set_device_and_checkout(device_properties_type* device) {
     bool device_changed = false;
     pthread_mutex_lock(&device_ref_count_mutex);
-    if (!device_equal(device, g_runtime_context.device)) {
-        queued_device = device;
+    bool checked_out = false;
+    if (device_equal(device, atomic_load(&g_runtime_context.device))) {
+        uint64_t ref_state = atomic_load(&device_ref_state);
+        while (!checked_out && ref_count(ref_state) > 0) {
+            checked_out = atomic_compare_exchange_weak(&device_ref_state, &ref_state, ref_state + 1);
+        }
+    }
+
+    // if the current device's count already hit 0, it's about to be released and the queued device will
+    // take its place
+    if (!checked_out) {
+        atomic_store(&queued_device, device);
         device_changed = _check_and_set_queued_device();
-    } else {
-        device_ref_count++;
     }
     pthread_mutex_unlock(&device_ref_count_mutex);
 
-    if (device_changed && on_device_change_callback_func != NULL) on_device_change_callback_func();     
+    if (device_changed && on_device_change_callback_func != NULL) on_device_change_callback_func();
 }
 
 device_properties_type* device_checkout() {
-    device_properties_type* device = NULL;
+    if (atomic_load_explicit(&queued_device, memory_order_acquire) != NULL) return NULL;
 
-    pthread_mutex_lock(&device_ref_count_mutex);
-    if (device_present()) {
-        device_ref_count++;
-        device = g_runtime_context.device;
+    uint64_t ref_state = atomic_load_explicit(&device_ref_state, memory_order_acquire);
+    while (ref_count(ref_state) > 0) {
+        if (atomic_compare_exchange_weak_explicit(&device_ref_state, &ref_state, ref_state + 1,
+                                                  memory_order_acquire, memory_order_acquire)) {
+            // can't change while we hold a reference
+            return atomic_load_explicit(&g_runtime_context.device, memory_order_relaxed);
+        }
     }
-    pthread_mutex_unlock(&device_ref_count_mutex);
 
-    return device;
+    return NULL;
 }
 
 void device_checkin(device_properties_type* device) {
-    bool device_changed = false;
-    
-    pthread_mutex_lock(&device_ref_count_mutex);
-    if (device_ref_count > 0 && device_equal(device, g_runtime_context.device)) {
-        device_ref_count--;
-        if (device_ref_count == 0) {
-            free(g_runtime_context.device);
-            g_runtime_context.device = NULL;
-            _check_and_set_queued_device();
-            device_changed = true;
+    if (device == NULL) return;
+
+    uint32_t id = device_id(device);
+    uint64_t ref_state = atomic_load_explicit(&device_ref_state, memory_order_acquire);
+
+    // if the state changes between reading it and the id, the CAS will fail and we'll re-check both
+    while (ref_count(ref_state) > 0 && atomic_load_explicit(&device_ref_id, memory_order_relaxed) == id) {
+        if (atomic_compare_exchange_weak_explicit(&device_ref_state, &ref_state, ref_state - 1,
+                                                  memory_order_acq_rel, memory_order_acquire)) {
+            if (ref_count(ref_state) == 1) release_device(ref_state - 1);
+            return;
         }
-    } else if (device_equal(device, queued_device)) {
-        free(queued_device);
-        queued_device = NULL;
     }
-    pthread_mutex_unlock(&device_ref_count_mutex);
 
-    if (device_changed && on_device_change_callback_func != NULL) on_device_change_callback_func();
+    pthread_mutex_lock(&device_ref_count_mutex);
+    device_properties_type* queued = atomic_load(&queued_device);
+    if (device_equal(device, queued)) {
+        free(queued);
+        atomic_store(&queued_device, NULL);
+    }
+    pthread_mutex_unlock(&device_ref_count_mutex);
 }
 
 // if a device is queued, the current device is already disconnected, return false until queued device takes over
 bool device_present() {
-    return g_runtime_context.device != NULL && queued_device == NULL;
+    return atomic_load_explicit(&g_runtime_context.device, memory_order_acquire) != NULL &&
+           atomic_load_explicit(&queued_device, memory_order_acquire) == NULL;
 }
 
 void set_on_device_change_callback(on_device_change_callback callback) {
     on_device_change_callback_func = callback;
-}
\ No newline at end of file
+}
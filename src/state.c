@@ -3,18 +3,26 @@
 #include "logging.h"
 #include "memory.h"
 #include "plugins.h"
+#include "runtime_context.h"
 #include "state.h"
+#include "state_shm.h"
 #include "strings.h"
 #include "system.h"
 
 #include <inttypes.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/time.h>
+#include <unistd.h>
 #include <math.h>
 
 const char *calibration_setup_strings[2] = {
@@ -31,6 +39,7 @@ const char *calibration_state_strings[4] = {
 const char* state_files_directory = "/dev/shm";
 const char* state_filename = "xr_driver_state";
 const char* control_flags_filename = "xr_driver_control";
+const char* state_shm_filename = "xr_driver_state_shm";
 
 FILE* get_driver_state_file(const char *filename, char *mode, char **full_path) {
     int full_path_length = strlen(state_files_directory) + strlen(filename) + 2;
@@ -39,11 +48,117 @@ FILE* get_driver_state_file(const char *filename, char *mode, char **full_path)
     return fopen(*full_path, mode ? mode : "r");
 }
 
-pthread_mutex_t state_mutex = PTHREAD_MUTEX_INITIALIZER;
-void write_state(driver_state_type *state) {
-    pthread_mutex_lock(&state_mutex);
-    char *full_path = NULL;
-    FILE* fp = get_driver_state_file(state_filename, "w", &full_path);
+static state_shm_block_type* state_block = NULL;
+
+// what's in the block now and the last text file written, both only touched with state_mutex held
+static state_shm_data_type published_data;
+static char* published_text = NULL;
+static size_t published_text_size = 0;
+
+static void state_shm_init() {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", state_files_directory, state_shm_filename);
+
+    mode_t old_umask = umask(0);
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    umask(old_umask);
+    if (fd == -1) {
+        log_error("Could not create state shm file %s: %s\n", path, strerror(errno));
+        return;
+    }
+
+    // truncating first zeroes out anything left from a previous run, including the change counter
+    if (ftruncate(fd, 0) == -1 || ftruncate(fd, sizeof(state_shm_block_type)) == -1) {
+        log_error("Could not size state shm file: %s\n", strerror(errno));
+        close(fd);
+        return;
+    }
+
+    void* mapped = mmap(NULL, sizeof(state_shm_block_type), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        log_error("Could not map state shm file: %s\n", strerror(errno));
+        return;
+    }
+
+    state_shm_block_type* block = (state_shm_block_type*)mapped;
+    block->version = STATE_SHM_VERSION;
+    block->data_size = sizeof(state_shm_data_type);
+
+    // readers check the magic last, once everything else is in place
+    atomic_thread_fence(memory_order_release);
+    block->magic = STATE_SHM_MAGIC;
+
+    state_block = block;
+}
+
+static void copy_state_string(char* dest, size_t dest_size, const char* src) {
+    if (src) strncpy(dest, src, dest_size - 1);
+}
+
+static void fill_state_shm_data(driver_state_type *state, state_shm_data_type *data) {
+    // zeroed so the whole struct, padding and unused string bytes included, can be compared with memcmp
+    memset(data, 0, sizeof(*data));
+
+    copy_state_string(data->hardware_id, sizeof(data->hardware_id), get_hardware_id());
+    if (state->device_license) {
+        size_t length = strlen(state->device_license);
+        if (length < sizeof(data->device_license)) {
+            memcpy(data->device_license, state->device_license, length);
+            data->device_license_length = length;
+        } else {
+            data->flags |= STATE_SHM_FLAG_DEVICE_LICENSE_TRUNCATED;
+        }
+    }
+
+    if (state->connected_device_model && state->connected_device_brand) {
+        data->flags |= STATE_SHM_FLAG_DEVICE_CONNECTED;
+        copy_state_string(data->connected_device_brand, sizeof(data->connected_device_brand), state->connected_device_brand);
+        copy_state_string(data->connected_device_model, sizeof(data->connected_device_model), state->connected_device_model);
+        data->calibration_setup = state->calibration_setup;
+        data->calibration_state = state->calibration_state;
+        data->connected_device_full_distance_cm = state->connected_device_full_distance_cm;
+        data->connected_device_full_size_cm = state->connected_device_full_size_cm;
+        if (state->sbs_mode_supported) data->flags |= STATE_SHM_FLAG_SBS_MODE_SUPPORTED;
+        if (state->sbs_mode_enabled) data->flags |= STATE_SHM_FLAG_SBS_MODE_ENABLED;
+        if (state->connected_device_pose_has_position) data->flags |= STATE_SHM_FLAG_POSE_HAS_POSITION;
+        if (state->breezy_desktop_smooth_follow_enabled) data->flags |= STATE_SHM_FLAG_SMOOTH_FOLLOW_ENABLED;
+        if (state->is_gamescope_reshade_ipc_connected) data->flags |= STATE_SHM_FLAG_GAMESCOPE_RESHADE_IPC_CONNECTED;
+        if (state->firmware_update_recommended) data->flags |= STATE_SHM_FLAG_FIRMWARE_UPDATE_RECOMMENDED;
+    }
+}
+
+static void publish_state_shm(driver_state_type *state) {
+    if (!state_block) state_shm_init();
+    if (!state_block) return;
+
+    state_shm_data_type data;
+    fill_state_shm_data(state, &data);
+
+    uint64_t change_counter = atomic_load_explicit(&state_block->change_counter, memory_order_relaxed);
+    if (change_counter == 0 || memcmp(&data, &published_data, sizeof(data)) != 0) {
+        atomic_store_explicit(&state_block->change_counter, change_counter + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        memcpy(&state_block->data, &data, sizeof(data));
+        atomic_store_explicit(&state_block->change_counter, change_counter + 2, memory_order_release);
+
+        published_data = data;
+    }
+
+    atomic_store_explicit(&state_block->heartbeat, state->heartbeat, memory_order_relaxed);
+}
+
+// Formats the text state file in memory and only rewrites the file if that differs from what was written
+// last. Text readers go by the heartbeat, so this still happens once a second, but control flag changes that
+// don't affect the state no longer touch the file.
+static void write_state_text(driver_state_type *state) {
+    char *text = NULL;
+    size_t text_size = 0;
+    FILE* fp = open_memstream(&text, &text_size);
+    if (!fp) {
+        log_error("Could not format state file: %s\n", strerror(errno));
+        return;
+    }
 
     fprintf(fp, "heartbeat=%d\n", state->heartbeat);
     if (get_hardware_id()) fprintf(fp, "hardware_id=%s\n", get_hardware_id());
@@ -64,8 +179,35 @@ void write_state(driver_state_type *state) {
             fprintf(fp, "is_gamescope_reshade_ipc_connected=true\n");
         fprintf(fp, "firmware_update_recommended=%s\n", state->firmware_update_recommended ? "true" : "false");
     }
+    fclose(fp);
+
+    if (published_text && text_size == published_text_size && memcmp(text, published_text, text_size) == 0) {
+        free(text);
+        return;
+    }
 
+    char *full_path = NULL;
+    fp = get_driver_state_file(state_filename, "w", &full_path);
+    if (!fp) {
+        log_error("Could not write state file %s: %s\n", full_path, strerror(errno));
+        free(full_path);
+        free(text);
+        return;
+    }
+    fwrite(text, 1, text_size, fp);
     fclose(fp);
+    free(full_path);
+
+    free(published_text);
+    published_text = text;
+    published_text_size = text_size;
+}
+
+pthread_mutex_t state_mutex = PTHREAD_MUTEX_INITIALIZER;
+void write_state(driver_state_type *state) {
+    pthread_mutex_lock(&state_mutex);
+    publish_state_shm(state);
+    write_state_text(state);
     pthread_mutex_unlock(&state_mutex);
 }
 
@@ -76,9 +218,9 @@ void read_control_flags(FILE *fp, control_flags_type *flags) {
             char *key = strtok(line, "=");
             char *value = strtok(NULL, "\n");
             if (strcmp(key, "recenter_screen") == 0) {
-                flags->recenter_screen = strcmp(value, "true") == 0;
+                atomic_store(&flags->recenter_screen, strcmp(value, "true") == 0);
             } else if (strcmp(key, "recalibrate") == 0) {
-                flags->recalibrate = strcmp(value, "true") == 0;
+                atomic_store(&flags->recalibrate, strcmp(value, "true") == 0);
             } else if (strcmp(key, "sbs_mode") == 0) {
                 if (strcmp(value, "unset") == 0) {
                     flags->sbs_mode = SBS_CONTROL_UNSET;
@@ -153,5 +295,7 @@ void update_state_from_device(driver_state_type *state, device_properties_type *
         }
     }
 
+    publish_hot_state();
+
     pthread_mutex_unlock(&state_mutex);
 }
\ No newline at end of file